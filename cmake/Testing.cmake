@@ -18,14 +18,35 @@ function(auto_test subsystem module)
     COMMAND ${TEST_CROSSCOMPILING_EMULATOR} test_${module})
 endfunction()
 
+auto_test(audio audiodsp)
+auto_test(audio audioframequeue)
+auto_test(audio audiojitterbuffer)
+auto_test(audio audiomixer)
+auto_test(core coreloopstats)
+auto_test(core filetransferio)
+auto_test(core grouppeertable)
+auto_test(core outgoingmessagequeue)
+auto_test(core poweroftwohistogram)
 auto_test(core toxpk)
 auto_test(core toxid)
 auto_test(core toxstring)
+auto_test(core transferscheduler)
 auto_test(chatlog textformatter)
 auto_test(net toxmedata)
 auto_test(net bsu)
 auto_test(persistence paths)
+auto_test(persistence settings)
+auto_test(persistence settingsserializer)
 
 if (UNIX)
   auto_test(platform posixsignalnotifier)
 endif()
+
+# Benchmarks are not tests, they are run manually and only report numbers
+if (BENCHMARKS)
+  add_executable(bench_videoframe
+    test/video/videoframe_bench.cpp)
+  target_link_libraries(bench_videoframe
+    ${PROJECT_NAME}_static
+    ${ALL_LIBRARIES})
+endif()
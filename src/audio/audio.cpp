@@ -50,7 +50,9 @@
  * uint32_t sampling_rate);
  *
  * When there are input subscribers, we regularly emit captured audio frames with this signal
- * Always connect with a blocking queued connection lambda, else the behaviour is undefined
+ * It is emitted from a dedicated sending thread, not the audio thread, so slots may block on
+ * encoding. Always connect with a blocking queued connection lambda, else the behaviour is
+ * undefined
  *
  * @var Audio::AUDIO_SAMPLE_RATE
  * @brief The next best Opus would take is 24k
@@ -99,15 +101,12 @@
  *
  * If the input device has no more subscriptions, it will be closed.
  *
- * @fn void Audio::playMono16Sound(const QString& path)
- * @brief Play a 44100Hz mono 16bit PCM sound from a file
+ * @fn void Audio::playSound(Sound sound)
+ * @brief Play one of the preloaded sounds once.
  *
- * @param[in] path the path to the sound file
+ * Sounds can overlap, the call returns immediately and never touches the audio device.
  *
- * @fn void Audio::playMono16Sound(const QByteArray& data)
- * @brief Play a 44100Hz mono 16bit PCM sound
- *
- * @param[in] data 44100Hz mono 16bit PCM data in host byte order
+ * @param[in] sound the sound to play
  *
  * @fn void Audio::playAudioBuffer(uint sourceId, const int16_t* data, int samples,
  *                                  unsigned channels, int sampleRate)
@@ -147,11 +146,13 @@
  * param[out] sid contains 0 if source deletion was successful,
  *                unchanged otherwise
  *
- * @fn void Audio::startLoop()
- * @brief starts looping the sound played with playMono16Sound()
+ * @fn void Audio::startLoop(Sound sound)
+ * @brief starts looping one of the preloaded sounds until stopLoop() is called
+ *
+ * @param[in] sound the sound to loop
  *
  * @fn void Audio::stopLoop()
- * @brief stops looping the sound played with playMono16Sound()
+ * @brief stops all sounds started with startLoop()
  *
  * @fn qreal Audio::inputGain() const
  * @brief get the current input gain
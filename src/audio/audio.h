@@ -30,6 +30,8 @@
 
 #include <cassert>
 
+class AudioMixer;
+
 class Audio : public QObject
 {
     Q_OBJECT
@@ -94,13 +96,15 @@ public:
     virtual void subscribeOutput(uint& sourceId) = 0;
     virtual void unsubscribeOutput(uint& sourceId) = 0;
 
+    virtual void subscribeMixer(AudioMixer& mixer) = 0;
+    virtual void unsubscribeMixer(AudioMixer& mixer) = 0;
+
     virtual void subscribeInput() = 0;
     virtual void unsubscribeInput() = 0;
 
-    virtual void startLoop() = 0;
+    virtual void playSound(Sound sound) = 0;
+    virtual void startLoop(Sound sound) = 0;
     virtual void stopLoop() = 0;
-    virtual void playMono16Sound(const QByteArray& data) = 0;
-    virtual void playMono16Sound(const QString& path) = 0;
 
     virtual void stopActive() = 0;
 
@@ -0,0 +1,122 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "audioframequeue.h"
+
+#include <cassert>
+#include <cstring>
+
+/**
+ * @class AudioFrameQueue
+ * @brief Lock-free single-producer/single-consumer queue of audio frames.
+ *
+ * Frames are copied into preallocated slots, so neither pushing nor popping allocates or
+ * blocks. The producer is the real-time audio thread, the consumer reads frames in place with
+ * front() and releases them with pop().
+ *
+ * @struct AudioFrameQueue::Frame
+ * @brief A queued frame, pcm stays valid until the frame is popped.
+ */
+
+/**
+ * @brief Creates the queue and preallocates all slots.
+ * @param maxFrameSamples Largest frame in interleaved samples (samples per channel * channels)
+ * @param capacity Number of frames the queue can hold
+ */
+AudioFrameQueue::AudioFrameQueue(size_t maxFrameSamples, size_t capacity)
+    : maxFrameSamples{maxFrameSamples}
+    , capacity{capacity}
+    , data{new int16_t[maxFrameSamples * capacity]}
+    , slots{new Slot[capacity]}
+{
+}
+
+/**
+ * @brief Copies a frame into the queue.
+ * @param pcm Interleaved samples
+ * @param samples Samples per channel
+ * @param channels Channel count
+ * @param sampleRate Sample rate of the frame
+ * @return False if the queue was full and the frame was dropped
+ * @note Call from the producer thread only.
+ */
+bool AudioFrameQueue::push(const int16_t* pcm, size_t samples, uint8_t channels,
+                           uint32_t sampleRate)
+{
+    const size_t total = samples * channels;
+    assert(total <= maxFrameSamples);
+
+    const size_t write = writePos.load(std::memory_order_relaxed);
+    if (write - readPos.load(std::memory_order_acquire) >= capacity) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const size_t index = write % capacity;
+    memcpy(data.get() + index * maxFrameSamples, pcm, total * sizeof(int16_t));
+    slots[index] = Slot{samples, channels, sampleRate};
+
+    writePos.store(write + 1, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Gives access to the oldest queued frame without copying it.
+ * @param frame Receives the frame
+ * @return False if the queue is empty
+ * @note Call from the consumer thread only.
+ */
+bool AudioFrameQueue::front(Frame& frame) const
+{
+    const size_t read = readPos.load(std::memory_order_relaxed);
+    if (read == writePos.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    const size_t index = read % capacity;
+    const Slot& slot = slots[index];
+    frame = Frame{data.get() + index * maxFrameSamples, slot.samples, slot.channels,
+                  slot.sampleRate};
+    return true;
+}
+
+/**
+ * @brief Releases the oldest queued frame, must follow a successful front().
+ * @note Call from the consumer thread only.
+ */
+void AudioFrameQueue::pop()
+{
+    readPos.store(readPos.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Number of frames waiting to be consumed.
+ */
+size_t AudioFrameQueue::size() const
+{
+    return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Number of frames dropped because the consumer fell behind.
+ */
+uint64_t AudioFrameQueue::getDropped() const
+{
+    return dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,68 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIOFRAMEQUEUE_H
+#define AUDIOFRAMEQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class AudioFrameQueue
+{
+public:
+    struct Frame
+    {
+        const int16_t* pcm;
+        size_t samples;
+        uint8_t channels;
+        uint32_t sampleRate;
+    };
+
+    AudioFrameQueue(size_t maxFrameSamples, size_t capacity);
+
+    AudioFrameQueue(const AudioFrameQueue& other) = delete;
+    AudioFrameQueue& operator=(const AudioFrameQueue& other) = delete;
+
+    bool push(const int16_t* pcm, size_t samples, uint8_t channels, uint32_t sampleRate);
+    bool front(Frame& frame) const;
+    void pop();
+
+    size_t size() const;
+    uint64_t getDropped() const;
+
+private:
+    struct Slot
+    {
+        size_t samples;
+        uint8_t channels;
+        uint32_t sampleRate;
+    };
+
+    const size_t maxFrameSamples;
+    const size_t capacity;
+    std::unique_ptr<int16_t[]> data;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<size_t> writePos{0};
+    std::atomic<size_t> readPos{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+#endif // AUDIOFRAMEQUEUE_H
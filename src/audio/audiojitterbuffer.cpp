@@ -0,0 +1,327 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "audiojitterbuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+/**
+ * @class AudioJitterBuffer
+ * @brief Adaptive playout buffer for the decoded audio of one call participant.
+ *
+ * Frames arrive from toxav at irregular intervals and are played by the audio thread at a
+ * steady rate. The buffer measures the arrival jitter and only starts playing once it holds
+ * enough audio to ride out the expected gaps.
+ *
+ * When it runs dry anyway the last frame is repeated with a fade-out for a few frames, audio
+ * that arrives after its slot was concealed is dropped again. Excess latency, e.g. after a
+ * burst of delayed frames, is drained by playing slightly faster instead of skipping audio.
+ *
+ * The buffer plays with a fixed channel count, frames with another channel count are up- or
+ * downmixed on push. Positions and depths always count samples per channel.
+ *
+ * There is exactly one producer thread calling push() and one consumer thread calling pull(),
+ * both sides only communicate through atomics.
+ *
+ * @var AudioJitterBuffer::SAMPLE_RATE
+ * @brief Playout sample rate, other rates are resampled on push
+ *
+ * @var AudioJitterBuffer::MAX_FRAME_SAMPLES
+ * @brief Largest frame pull() can produce, the longest Opus frame
+ *
+ * @var AudioJitterBuffer::MAX_CHANNELS
+ * @brief Largest channel count a buffer can play
+ *
+ * @var AudioJitterBuffer::RING_SAMPLES
+ * @brief Capacity of the ring buffer in samples per channel, must be a power of two
+ *
+ * @var AudioJitterBuffer::MIN_TARGET_SAMPLES
+ * @brief Buffer depth on a jitter free link
+ *
+ * @var AudioJitterBuffer::MAX_TARGET_SAMPLES
+ * @brief Upper bound of the buffer depth, no matter how bad the link is
+ *
+ * @var AudioJitterBuffer::MAX_EXCESS_SAMPLES
+ * @brief Latency above the target that is skipped instead of being played faster
+ *
+ * @var AudioJitterBuffer::MAX_CONCEALED_FRAMES
+ * @brief Number of missing frames concealed before playback pauses to rebuffer
+ *
+ * @var AudioJitterBuffer::STRETCH_DIVISOR
+ * @brief Excess latency is drained by consuming up to 1/STRETCH_DIVISOR more samples per frame
+ */
+
+namespace {
+int64_t now()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+}
+
+/**
+ * @brief Creates an empty buffer.
+ * @param channels Channel count of the played audio, 1 or 2
+ */
+AudioJitterBuffer::AudioJitterBuffer(unsigned channels)
+    : channels{channels}
+    , ring{new int16_t[RING_SAMPLES * channels]}
+{
+    assert(channels == 1 || channels == 2);
+    static_assert((RING_SAMPLES & (RING_SAMPLES - 1)) == 0, "RING_SAMPLES must be a power of two");
+    static_assert(MAX_TARGET_SAMPLES + MAX_EXCESS_SAMPLES + MAX_FRAME_SAMPLES <= RING_SAMPLES,
+                  "ring buffer too small for the maximum latency");
+}
+
+void AudioJitterBuffer::write(size_t pos, const int16_t* data, size_t count)
+{
+    const size_t offset = pos & (RING_SAMPLES - 1);
+    const size_t first = std::min(count, RING_SAMPLES - offset);
+    memcpy(ring.get() + offset * channels, data, first * channels * sizeof(int16_t));
+    memcpy(ring.get(), data + first * channels, (count - first) * channels * sizeof(int16_t));
+}
+
+void AudioJitterBuffer::read(size_t pos, int16_t* out, size_t count) const
+{
+    const size_t offset = pos & (RING_SAMPLES - 1);
+    const size_t first = std::min(count, RING_SAMPLES - offset);
+    memcpy(out, ring.get() + offset * channels, first * channels * sizeof(int16_t));
+    memcpy(out + first * channels, ring.get(), (count - first) * channels * sizeof(int16_t));
+}
+
+/**
+ * @brief Updates the arrival jitter estimate and the resulting target depth.
+ * @param samples Duration of the arrived frame in samples
+ *
+ * Uses the interarrival jitter estimator of RFC 3550, the target depth covers three times the
+ * estimated jitter on top of the minimum depth.
+ */
+void AudioJitterBuffer::updateJitter(size_t samples)
+{
+    const int64_t arrival = now();
+    if (lastArrival >= 0) {
+        const float expected = samples * 1000000.0f / SAMPLE_RATE;
+        const float deviation = std::fabs(static_cast<float>(arrival - lastArrival) - expected);
+        jitter += (deviation - jitter) / 16;
+    }
+    lastArrival = arrival;
+
+    const size_t jitterSamples = static_cast<size_t>(jitter * SAMPLE_RATE / 1000000.0f);
+    const size_t maxTarget = MAX_TARGET_SAMPLES;
+    const size_t target = std::min(MIN_TARGET_SAMPLES + 3 * jitterSamples, maxTarget);
+    targetSamples.store(target, std::memory_order_relaxed);
+    jitterUs.store(static_cast<int>(jitter), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Queues a decoded frame, converted to the buffer's channel count and 48 kHz.
+ * @param data Interleaved samples
+ * @param samples Samples per channel
+ * @param frameChannels Channel count of the frame, 1 or 2
+ * @param sampleRate Sample rate of the frame
+ * @return False if the frame was dropped because the buffer is full
+ * @note Call from the producer thread only, never blocks.
+ */
+bool AudioJitterBuffer::push(const int16_t* data, size_t samples, unsigned frameChannels,
+                             uint32_t sampleRate)
+{
+    assert(frameChannels == 1 || frameChannels == 2);
+    if (!samples || !sampleRate) {
+        return false;
+    }
+
+    const size_t outSamples = static_cast<size_t>(static_cast<uint64_t>(samples) * SAMPLE_RATE / sampleRate);
+    updateJitter(outSamples);
+
+    const size_t pos = writePos.load(std::memory_order_relaxed);
+    if (RING_SAMPLES - (pos - readPos.load(std::memory_order_acquire)) < outSamples) {
+        overruns.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // mono is duplicated to both channels, stereo downmixed to the average
+    const unsigned outChannels = channels;
+    auto sampleAt = [data, frameChannels, outChannels](size_t i, unsigned channel) -> int {
+        if (frameChannels == 1) {
+            return data[i];
+        }
+
+        return outChannels == 2 ? data[2 * i + channel] : (data[2 * i] + data[2 * i + 1]) / 2;
+    };
+
+    int16_t frame[MAX_CHANNELS];
+    if (sampleRate == SAMPLE_RATE) {
+        if (frameChannels == channels) {
+            write(pos, data, samples);
+        } else {
+            for (size_t i = 0; i < samples; ++i) {
+                for (unsigned c = 0; c < channels; ++c) {
+                    frame[c] = static_cast<int16_t>(sampleAt(i, c));
+                }
+                write(pos + i, frame, 1);
+            }
+        }
+    } else {
+        // linear interpolation is plenty for the voice rates Opus decodes to
+        const float step = static_cast<float>(sampleRate) / SAMPLE_RATE;
+        for (size_t i = 0; i < outSamples; ++i) {
+            const float src = i * step;
+            const size_t index = static_cast<size_t>(src);
+            const size_t next = std::min(index + 1, samples - 1);
+            const float frac = src - index;
+            for (unsigned c = 0; c < channels; ++c) {
+                const int first = sampleAt(index, c);
+                const float value = first + (sampleAt(next, c) - first) * frac;
+                frame[c] = static_cast<int16_t>(std::lrint(value));
+            }
+            write(pos + i, frame, 1);
+        }
+    }
+
+    writePos.store(pos + outSamples, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Produces the next frame for playout.
+ * @param out Buffer receiving count interleaved samples per channel
+ * @param count Samples per channel to produce, at most MAX_FRAME_SAMPLES
+ * @return False while buffering or after concealment gave up, out is left untouched then
+ * @note Call from the consumer thread only, never blocks.
+ */
+bool AudioJitterBuffer::pull(int16_t* out, size_t count)
+{
+    assert(count <= MAX_FRAME_SAMPLES);
+
+    const size_t end = writePos.load(std::memory_order_acquire);
+    size_t pos = readPos.load(std::memory_order_relaxed);
+    size_t available = end - pos;
+    const size_t target = std::max(targetSamples.load(std::memory_order_relaxed), count);
+
+    if (!playing) {
+        if (available < target) {
+            return false;
+        }
+        playing = true;
+    }
+
+    // audio we already concealed arrived late, drop it to keep the latency down
+    if (lateSamples && available > target) {
+        const size_t drop = std::min(lateSamples, available - target);
+        pos += drop;
+        available -= drop;
+        lateSamples -= drop;
+        lateDrops.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (available < count) {
+        if (concealedRun == 0) {
+            underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (concealedRun < MAX_CONCEALED_FRAMES && lastCount == count) {
+            // repeat the last frame, fading out further with every missing frame
+            ++concealedRun;
+            const float gain = 1.0f / (1 << concealedRun);
+            for (size_t i = 0; i < count * channels; ++i) {
+                out[i] = static_cast<int16_t>(lastFrame[i] * gain);
+            }
+            lateSamples += count;
+            concealed.fetch_add(1, std::memory_order_relaxed);
+            readPos.store(pos, std::memory_order_release);
+            return true;
+        }
+
+        // give up and rebuffer, everything concealed so far is not expected anymore
+        playing = false;
+        concealedRun = 0;
+        lateSamples = 0;
+        readPos.store(pos, std::memory_order_release);
+        return false;
+    }
+
+    concealedRun = 0;
+
+    const size_t excess = available - std::min(available, target);
+    if (excess > MAX_EXCESS_SAMPLES) {
+        // too far behind to catch up smoothly
+        pos = end - target;
+        available = target;
+        lateDrops.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const size_t extra = std::min(available - count, count / STRETCH_DIVISOR);
+    if (excess > count / 2 && extra > 1) {
+        // play slightly faster to drain the excess latency without audible skips
+        const size_t consumed = count + extra;
+        read(pos, stretchBuffer.data(), consumed);
+        const float step = static_cast<float>(consumed - 1) / (count - 1);
+        for (size_t i = 0; i < count; ++i) {
+            const float src = i * step;
+            const size_t index = std::min(static_cast<size_t>(src), consumed - 2);
+            const float frac = src - index;
+            for (unsigned c = 0; c < channels; ++c) {
+                const int16_t first = stretchBuffer[index * channels + c];
+                const int16_t second = stretchBuffer[(index + 1) * channels + c];
+                const float value = first + (second - first) * frac;
+                out[i * channels + c] = static_cast<int16_t>(std::lrint(value));
+            }
+        }
+        pos += consumed;
+        stretched.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        read(pos, out, count);
+        pos += count;
+    }
+
+    memcpy(lastFrame.data(), out, count * channels * sizeof(int16_t));
+    lastCount = count;
+    readPos.store(pos, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Current depth and counters of the buffer, safe to call from any thread.
+ */
+AudioJitterBuffer::Stats AudioJitterBuffer::getStats() const
+{
+    const size_t depth = writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);
+    Stats stats;
+    stats.depthMs = static_cast<int>(depth * 1000 / SAMPLE_RATE);
+    stats.targetMs = static_cast<int>(targetSamples.load(std::memory_order_relaxed) * 1000 / SAMPLE_RATE);
+    stats.jitterMs = jitterUs.load(std::memory_order_relaxed) / 1000;
+    stats.underruns = underruns.load(std::memory_order_relaxed);
+    stats.concealed = concealed.load(std::memory_order_relaxed);
+    stats.lateDrops = lateDrops.load(std::memory_order_relaxed);
+    stats.overruns = overruns.load(std::memory_order_relaxed);
+    stats.stretched = stretched.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ * @brief Channel count of the audio produced by pull().
+ */
+unsigned AudioJitterBuffer::getChannels() const
+{
+    return channels;
+}
@@ -0,0 +1,99 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIOJITTERBUFFER_H
+#define AUDIOJITTERBUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class AudioJitterBuffer
+{
+public:
+    struct Stats
+    {
+        int depthMs;
+        int targetMs;
+        int jitterMs;
+        uint64_t underruns;
+        uint64_t concealed;
+        uint64_t lateDrops;
+        uint64_t overruns;
+        uint64_t stretched;
+    };
+
+    explicit AudioJitterBuffer(unsigned channels = 1);
+
+    AudioJitterBuffer(const AudioJitterBuffer& other) = delete;
+    AudioJitterBuffer& operator=(const AudioJitterBuffer& other) = delete;
+
+    bool push(const int16_t* data, size_t samples, unsigned frameChannels, uint32_t sampleRate);
+    bool pull(int16_t* out, size_t count);
+
+    Stats getStats() const;
+    unsigned getChannels() const;
+
+    static constexpr uint32_t SAMPLE_RATE = 48000;
+    static constexpr size_t MAX_FRAME_SAMPLES = SAMPLE_RATE * 60 / 1000;
+    static constexpr unsigned MAX_CHANNELS = 2;
+
+private:
+    static constexpr size_t RING_SAMPLES = 32768;
+    static constexpr size_t MIN_TARGET_SAMPLES = SAMPLE_RATE * 20 / 1000;
+    static constexpr size_t MAX_TARGET_SAMPLES = SAMPLE_RATE * 200 / 1000;
+    static constexpr size_t MAX_EXCESS_SAMPLES = SAMPLE_RATE * 200 / 1000;
+    static constexpr int MAX_CONCEALED_FRAMES = 3;
+    static constexpr int STRETCH_DIVISOR = 10;
+
+    void write(size_t pos, const int16_t* data, size_t count);
+    void read(size_t pos, int16_t* out, size_t count) const;
+    void updateJitter(size_t samples);
+
+private:
+    const unsigned channels;
+    std::unique_ptr<int16_t[]> ring;
+    std::atomic<size_t> writePos{0};
+    std::atomic<size_t> readPos{0};
+    std::atomic<size_t> targetSamples{MIN_TARGET_SAMPLES};
+    std::atomic<int> jitterUs{0};
+
+    // producer side
+    int64_t lastArrival{-1};
+    float jitter{0};
+
+    // consumer side
+    bool playing{false};
+    int concealedRun{0};
+    size_t lateSamples{0};
+    size_t lastCount{0};
+    std::array<int16_t, MAX_FRAME_SAMPLES * MAX_CHANNELS> lastFrame;
+    std::array<int16_t, (MAX_FRAME_SAMPLES + MAX_FRAME_SAMPLES / STRETCH_DIVISOR) * MAX_CHANNELS>
+        stretchBuffer;
+
+    std::atomic<uint64_t> underruns{0};
+    std::atomic<uint64_t> concealed{0};
+    std::atomic<uint64_t> lateDrops{0};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> stretched{0};
+};
+
+#endif // AUDIOJITTERBUFFER_H
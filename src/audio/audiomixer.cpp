@@ -0,0 +1,273 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "audiomixer.h"
+#include "src/audio/dsp/audiodsp.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cassert>
+
+/**
+ * @class AudioMixer
+ * @brief Mixes the audio of all peers of a call into a single stream.
+ *
+ * Instead of giving every peer its own OpenAL source, received frames are pushed into a
+ * per-peer AudioJitterBuffer and the audio backend pulls one mixed frame at a time for a
+ * single output source. The mixed stream has the channel count the mixer was created with,
+ * peers sending another channel count are converted by their jitter buffer.
+ *
+ * The mixer has exactly one producer thread, the one calling push() and managing peers (the
+ * Tox thread), and one consumer thread calling mix() (the audio thread). Both sides
+ * communicate only through atomics, so neither side ever blocks the other.
+ *
+ * @var AudioMixer::MAX_MIX_SAMPLES
+ * @brief Largest frame mix() can produce at once, the longest Opus frame
+ *
+ * @var AudioMixer::MAX_STREAMS
+ * @brief Number of peers that can be mixed at the same time
+ */
+
+/**
+ * @brief Creates a mixer without peers.
+ * @param channels Channel count of the mixed stream, 1 or 2
+ */
+AudioMixer::AudioMixer(unsigned channels)
+    : channels{channels}
+    , kernels{AudioDsp::getKernels(AudioDsp::getBestIsa())}
+{
+}
+
+/**
+ * @brief Destroys the mixer.
+ * @note The mixer must be unsubscribed from the audio backend before it is destroyed.
+ */
+AudioMixer::~AudioMixer() = default;
+
+/**
+ * @brief Starts mixing a peer.
+ * @param peer Peer number in the group
+ * @note Call from the producer thread.
+ */
+void AudioMixer::addPeer(int peer)
+{
+    if (peerStreams.contains(peer)) {
+        return;
+    }
+
+    for (size_t i = 0; i < MAX_STREAMS; ++i) {
+        PeerStream& stream = streams[i];
+        if (stream.state.load(std::memory_order_acquire) != Free) {
+            continue;
+        }
+
+        // the consumer doesn't look at free streams, so the buffer can be replaced safely
+        stream.buffer.reset(new AudioJitterBuffer{channels});
+        stream.gain.store(1.0f, std::memory_order_relaxed);
+        stream.muted.store(false, std::memory_order_relaxed);
+        stream.state.store(Active, std::memory_order_release);
+        peerStreams.insert(peer, i);
+        return;
+    }
+
+    qWarning() << "Can't mix more than" << MAX_STREAMS << "peers, ignoring peer" << peer;
+}
+
+/**
+ * @brief Stops mixing a peer, its buffered audio is discarded.
+ * @param peer Peer number in the group
+ * @note Call from the producer thread.
+ */
+void AudioMixer::removePeer(int peer)
+{
+    auto it = peerStreams.find(peer);
+    if (it == peerStreams.end()) {
+        return;
+    }
+
+    // the consumer stops pulling from the stream and marks it free again
+    streams[it.value()].state.store(Removed, std::memory_order_release);
+    peerStreams.erase(it);
+}
+
+/**
+ * @brief Checks if a peer is currently mixed.
+ * @param peer Peer number in the group
+ * @return True if audio pushed for the peer will be played
+ */
+bool AudioMixer::hasPeer(int peer) const
+{
+    return peerStreams.contains(peer);
+}
+
+/**
+ * @brief Stops mixing all peers.
+ * @note Call from the producer thread.
+ */
+void AudioMixer::clearPeers()
+{
+    for (size_t index : peerStreams) {
+        streams[index].state.store(Removed, std::memory_order_release);
+    }
+
+    peerStreams.clear();
+}
+
+const AudioMixer::PeerStream* AudioMixer::findStream(int peer) const
+{
+    auto it = peerStreams.constFind(peer);
+    if (it == peerStreams.constEnd()) {
+        return nullptr;
+    }
+
+    return &streams[it.value()];
+}
+
+AudioMixer::PeerStream* AudioMixer::findStream(int peer)
+{
+    auto it = peerStreams.constFind(peer);
+    if (it == peerStreams.constEnd()) {
+        return nullptr;
+    }
+
+    return &streams[it.value()];
+}
+
+/**
+ * @brief Sets the linear gain applied to a peer before mixing.
+ * @param peer Peer number in the group
+ * @param gain Gain factor, 1 leaves the audio unchanged
+ */
+void AudioMixer::setPeerGain(int peer, float gain)
+{
+    PeerStream* stream = findStream(peer);
+    if (stream) {
+        stream->gain.store(gain, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Mutes or unmutes a peer, a muted peer keeps consuming its audio.
+ * @param peer Peer number in the group
+ * @param muted True to mute, false to unmute
+ */
+void AudioMixer::setPeerMuted(int peer, bool muted)
+{
+    PeerStream* stream = findStream(peer);
+    if (stream) {
+        stream->muted.store(muted, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Reads the jitter buffer statistics of a peer.
+ * @param peer Peer number in the group
+ * @param stats Receives the statistics
+ * @return False if the peer is not mixed
+ */
+bool AudioMixer::getPeerStats(int peer, AudioJitterBuffer::Stats& stats) const
+{
+    const PeerStream* stream = findStream(peer);
+    if (!stream) {
+        return false;
+    }
+
+    stats = stream->buffer->getStats();
+    return true;
+}
+
+/**
+ * @brief Queues a received frame for a peer.
+ * @param peer Peer number in the group, must have been added before
+ * @param data Interleaved samples
+ * @param samples Samples per channel
+ * @param channels Channel count, 1 or 2
+ * @param sampleRate Sample rate of the frame
+ * @return False if the frame was dropped
+ * @note Call from the producer thread, never blocks.
+ */
+bool AudioMixer::push(int peer, const int16_t* data, size_t samples, unsigned channels,
+                      uint32_t sampleRate)
+{
+    PeerStream* stream = findStream(peer);
+    if (!stream) {
+        return false;
+    }
+
+    return stream->buffer->push(data, samples, channels, sampleRate);
+}
+
+/**
+ * @brief Mixes the next frame of all playing peers.
+ * @param out Buffer receiving count interleaved samples per channel
+ * @param count Samples per channel to mix, at most MAX_MIX_SAMPLES
+ * @return False if no peer had audio to play, out is left untouched then
+ * @note Call from the consumer thread, never blocks.
+ */
+bool AudioMixer::mix(int16_t* out, size_t count)
+{
+    assert(count <= MAX_MIX_SAMPLES);
+
+    const size_t total = count * channels;
+    bool mixed = false;
+    for (PeerStream& stream : streams) {
+        const int state = stream.state.load(std::memory_order_acquire);
+        if (state == Free) {
+            continue;
+        }
+
+        if (state == Removed) {
+            stream.state.store(Free, std::memory_order_release);
+            continue;
+        }
+
+        // muted peers keep playing out their buffer, so unmuting doesn't replay stale audio
+        if (!stream.buffer->pull(scratch.data(), count)
+            || stream.muted.load(std::memory_order_relaxed)) {
+            continue;
+        }
+
+        const float gain = stream.gain.load(std::memory_order_relaxed);
+        if (gain != 1.0f) {
+            kernels->applyGain(scratch.data(), total, gain);
+        }
+
+        if (!mixed) {
+            std::fill(accumulator.begin(), accumulator.begin() + total, 0);
+            mixed = true;
+        }
+
+        kernels->mixAccumulate(accumulator.data(), scratch.data(), total);
+    }
+
+    if (mixed) {
+        kernels->mixSaturate(accumulator.data(), out, total);
+    }
+
+    return mixed;
+}
+
+/**
+ * @brief Channel count of the frames produced by mix().
+ */
+unsigned AudioMixer::getChannels() const
+{
+    return channels;
+}
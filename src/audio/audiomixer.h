@@ -0,0 +1,95 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIOMIXER_H
+#define AUDIOMIXER_H
+
+#include "src/audio/audiojitterbuffer.h"
+
+#include <QHash>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace AudioDsp {
+struct Kernels;
+}
+
+class AudioMixer
+{
+public:
+    explicit AudioMixer(unsigned channels = 1);
+    ~AudioMixer();
+
+    AudioMixer(const AudioMixer& other) = delete;
+    AudioMixer& operator=(const AudioMixer& other) = delete;
+
+    void addPeer(int peer);
+    void removePeer(int peer);
+    bool hasPeer(int peer) const;
+    void clearPeers();
+
+    void setPeerGain(int peer, float gain);
+    void setPeerMuted(int peer, bool muted);
+    bool getPeerStats(int peer, AudioJitterBuffer::Stats& stats) const;
+
+    bool push(int peer, const int16_t* data, size_t samples, unsigned channels,
+              uint32_t sampleRate);
+    bool mix(int16_t* out, size_t count);
+    unsigned getChannels() const;
+
+    static constexpr size_t MAX_MIX_SAMPLES = AudioJitterBuffer::MAX_FRAME_SAMPLES;
+    static constexpr size_t MAX_STREAMS = 128;
+
+private:
+    enum StreamState
+    {
+        Free,
+        Active,
+        Removed
+    };
+
+    struct PeerStream
+    {
+        std::atomic<int> state{Free};
+        std::unique_ptr<AudioJitterBuffer> buffer;
+        std::atomic<float> gain{1.0f};
+        std::atomic<bool> muted{false};
+    };
+
+    const PeerStream* findStream(int peer) const;
+    PeerStream* findStream(int peer);
+
+private:
+    // producer side, only touched from the thread that pushes audio
+    QHash<int, size_t> peerStreams;
+    std::array<PeerStream, MAX_STREAMS> streams;
+
+    const unsigned channels;
+
+    // consumer side, only touched from the audio thread
+    const AudioDsp::Kernels* kernels;
+    std::array<int32_t, MAX_MIX_SAMPLES * AudioJitterBuffer::MAX_CHANNELS> accumulator;
+    std::array<int16_t, MAX_MIX_SAMPLES * AudioJitterBuffer::MAX_CHANNELS> scratch;
+};
+
+#endif // AUDIOMIXER_H
@@ -18,8 +18,8 @@
 */
 
 #include "openal.h"
-#include "src/core/core.h"
-#include "src/core/coreav.h"
+#include "src/audio/audiomixer.h"
+#include "src/audio/dsp/audiodsp.h"
 #include "src/persistence/settings.h"
 
 #include <QDebug>
@@ -30,20 +30,9 @@
 #include <QWaitCondition>
 #include <QtMath>
 
+#include <algorithm>
 #include <cassert>
 
-namespace {
-    void applyGain(int16_t* buffer, uint32_t bufferSize, qreal gainFactor)
-    {
-        for (quint32 i = 0; i < bufferSize; ++i) {
-            // gain amplification with clipping to 16-bit boundaries
-            buffer[i] = qBound<int16_t>(std::numeric_limits<int16_t>::min(),
-                                   qRound(buffer[i] * gainFactor),
-                                   std::numeric_limits<int16_t>::max());
-        }
-    }
-}
-
 /**
  * @class OpenAL
  * @brief Provides the OpenAL audio backend
@@ -53,13 +42,34 @@ namespace {
  *
  * @var AUDIO_CHANNELS
  * @brief Ideally, we'd auto-detect, but that's a sane default
+ *
+ * @var CAPTURE_QUEUE_FRAMES
+ * @brief Captured frames buffered for sending before the oldest get dropped
+ *
+ * @var CAPTURE_RING_FRAMES
+ * @brief Size of OpenAL's capture ring buffer in frames, covers late wakeups of the audio thread
+ *
+ * @var OpenAL::MIXER_BUFFER_COUNT
+ * @brief Number of mixed frames kept queued on a mixer's source
+ *
+ * @var OpenAL::EFFECT_SOURCE_COUNT
+ * @brief Number of sounds that can play at the same time
+ *
+ * @var OpenAL::soundData
+ * @brief PCM data of each Audio::Sound, loaded once when the audio thread starts
+ *
+ * @var OpenAL::soundBuffers
+ * @brief AL buffers of the sounds, uploaded on first use and kept while output is open
  */
 
 static const unsigned int BUFFER_COUNT = 16;
 static const uint32_t AUDIO_CHANNELS = 2;
+static const size_t CAPTURE_QUEUE_FRAMES = 8;
+static const int CAPTURE_RING_FRAMES = 8;
 
 OpenAL::OpenAL()
     : audioThread{new QThread}
+    , captureQueue{AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL * AUDIO_CHANNELS, CAPTURE_QUEUE_FRAMES}
 {
     // initialize OpenAL error stack
     alGetError();
@@ -68,7 +78,7 @@ OpenAL::OpenAL()
     audioThread->setObjectName("qTox Audio");
     QObject::connect(audioThread, &QThread::finished, &voiceTimer, &QTimer::stop);
     QObject::connect(audioThread, &QThread::finished, &captureTimer, &QTimer::stop);
-    QObject::connect(audioThread, &QThread::finished, &playMono16Timer, &QTimer::stop);
+    QObject::connect(audioThread, &QThread::finished, &soundTimer, &QTimer::stop);
     QObject::connect(audioThread, &QThread::finished, audioThread, &QThread::deleteLater);
 
     moveToThread(audioThread);
@@ -79,21 +89,36 @@ OpenAL::OpenAL()
     connect(&voiceTimer, &QTimer::timeout, this, &Audio::stopActive);
 
     connect(&captureTimer, &QTimer::timeout, this, &OpenAL::doAudio);
+    // rescheduled by doAudio to fire as soon as the next captured frame is complete
     captureTimer.setInterval(AUDIO_FRAME_DURATION / 2);
-    captureTimer.setSingleShot(false);
+    captureTimer.setTimerType(Qt::PreciseTimer);
+    captureTimer.setSingleShot(true);
     captureTimer.moveToThread(audioThread);
     // TODO for Qt 5.6+: use qOverload
     connect(audioThread, &QThread::started, &captureTimer, static_cast<void (QTimer::*)(void)>(&QTimer::start));
 
-    connect(&playMono16Timer, &QTimer::timeout, this, &OpenAL::playMono16SoundCleanup);
-    playMono16Timer.setSingleShot(true);
-    playMono16Timer.moveToThread(audioThread);
+    connect(&soundTimer, &QTimer::timeout, this, &OpenAL::soundCleanup);
+    soundTimer.setSingleShot(true);
+    soundTimer.moveToThread(audioThread);
+
+    // runs on the audio thread before any queued sound request
+    connect(audioThread, &QThread::started, this, &OpenAL::loadSounds);
+
+    audioThread->start(QThread::TimeCriticalPriority);
 
-    audioThread->start();
+    // no context object, so sendFrames runs on sendThread itself
+    sendThread.setObjectName("qTox Audio Send");
+    connect(&sendThread, &QThread::started, [this] { sendFrames(); });
+    sendThread.start(QThread::HighPriority);
 }
 
 OpenAL::~OpenAL()
 {
+    sending = false;
+    capturedFrames.release();
+    sendThread.quit();
+    sendThread.wait();
+
     audioThread->exit();
     audioThread->wait();
     cleanupInput();
@@ -302,8 +327,8 @@ bool OpenAL::initInput(const QString& deviceName, uint32_t channels)
     this->channels = channels;
     int stereoFlag = channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
     const int bytesPerSample = 2;
-    const int safetyFactor = 2; // internal OpenAL ring buffer. must be larger than our inputBuffer to avoid the ring
-                                // from overwriting itself between captures.
+    const int safetyFactor = CAPTURE_RING_FRAMES; // internal OpenAL ring buffer. must be larger than our inputBuffer
+                                                  // to avoid the ring from overwriting itself between captures.
     AUDIO_FRAME_SAMPLE_COUNT_TOTAL = AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL * channels;
     const ALCsizei ringBufSize = AUDIO_FRAME_SAMPLE_COUNT_TOTAL * bytesPerSample * safetyFactor;
 
@@ -359,61 +384,150 @@ bool OpenAL::initOutput(const QString& deviceName)
         return false;
     }
 
-    alGenSources(1, &alMainSource);
+    alGenSources(EFFECT_SOURCE_COUNT, effectSources);
     checkAlError();
 
     // init master volume
     alListenerf(AL_GAIN, Settings::getInstance().getOutVolume() * 0.01f);
     checkAlError();
 
-    Core* core = Core::getInstance();
-    if (core) {
-        // reset each call's audio source
-        core->getAv()->invalidateCallSources();
-    }
-
     outputInitialized = true;
     return true;
 }
 
 /**
- * @brief Play a 48kHz mono 16bit PCM sound from a file
- *
- * @param[in] path the path to the sound file
+ * @brief Reads all sounds into memory, so playing them never touches the disk.
  */
-void OpenAL::playMono16Sound(const QString& path)
+void OpenAL::loadSounds()
+{
+    static_assert(SOUND_COUNT == 5, "update the list of sounds");
+    const Sound sounds[] = {Sound::NewMessage, Sound::Test, Sound::IncomingCall,
+                            Sound::OutgoingCall, Sound::CallEnd};
+
+    for (Sound sound : sounds) {
+        QFile sndFile(getSound(sound));
+        if (!sndFile.open(QIODevice::ReadOnly)) {
+            qWarning() << "Failed to load sound" << sndFile.fileName();
+            continue;
+        }
+
+        soundData[static_cast<int>(sound)] = sndFile.readAll();
+    }
+}
+
+/**
+ * @brief Returns the AL buffer of a sound, uploading it if needed.
+ * @param sound Index of the sound
+ * @return The buffer, 0 if the sound couldn't be loaded
+ */
+ALuint OpenAL::getSoundBuffer(int sound)
+{
+    const QByteArray& data = soundData[sound];
+    if (!soundBuffers[sound] && !data.isEmpty()) {
+        alGenBuffers(1, &soundBuffers[sound]);
+        alBufferData(soundBuffers[sound], AL_FORMAT_MONO16, data.constData(), data.size(),
+                     AUDIO_SAMPLE_RATE);
+        checkAlError();
+    }
+
+    return soundBuffers[sound];
+}
+
+void OpenAL::playSound(Sound sound)
+{
+    QMetaObject::invokeMethod(this, "doPlaySound", Qt::QueuedConnection,
+                              Q_ARG(int, static_cast<int>(sound)), Q_ARG(bool, false));
+}
+
+void OpenAL::startLoop(Sound sound)
+{
+    QMetaObject::invokeMethod(this, "doPlaySound", Qt::QueuedConnection,
+                              Q_ARG(int, static_cast<int>(sound)), Q_ARG(bool, true));
+}
+
+void OpenAL::stopLoop()
 {
-    QFile sndFile(path);
-    sndFile.open(QIODevice::ReadOnly);
-    playMono16Sound(QByteArray(sndFile.readAll()));
+    QMetaObject::invokeMethod(this, "doStopLoop", Qt::QueuedConnection);
 }
 
 /**
- * @brief Play a 48kHz mono 16bit PCM sound
+ * @brief Plays a sound on a free effect source, runs on the audio thread.
+ * @param sound Index of the sound
+ * @param loop True to loop the sound until doStopLoop()
+ *
+ * If all sources are busy, the one that started playing first is reused. Looping sounds are
+ * never cut off, the sound is dropped if they occupy every source.
  */
-void OpenAL::playMono16Sound(const QByteArray& data)
+void OpenAL::doPlaySound(int sound, bool loop)
 {
     QMutexLocker locker(&audioLock);
 
     if (!autoInitOutput())
         return;
 
-    if (!alMainBuffer)
-        alGenBuffers(1, &alMainBuffer);
+    const ALuint buffer = getSoundBuffer(sound);
+    if (!buffer)
+        return;
+
+    int index = -1;
+    int oldest = -1;
+    for (int i = 0; i < EFFECT_SOURCE_COUNT; ++i) {
+        ALint state;
+        alGetSourcei(effectSources[i], AL_SOURCE_STATE, &state);
+        if (state != AL_PLAYING) {
+            index = i;
+            break;
+        }
 
-    ALint state;
-    alGetSourcei(alMainSource, AL_SOURCE_STATE, &state);
-    if (state == AL_PLAYING) {
-        alSourceStop(alMainSource);
-        alSourcei(alMainSource, AL_BUFFER, AL_NONE);
+        ALint looping = AL_FALSE;
+        alGetSourcei(effectSources[i], AL_LOOPING, &looping);
+        if (!looping && (oldest < 0 || effectStarted[i] < effectStarted[oldest])) {
+            oldest = i;
+        }
+    }
+
+    if (index < 0) {
+        if (oldest < 0) {
+            qWarning() << "All effect sources are looping, not playing sound" << sound;
+            return;
+        }
+
+        index = oldest;
+        alSourceStop(effectSources[index]);
     }
 
-    alBufferData(alMainBuffer, AL_FORMAT_MONO16, data.constData(), data.size(), AUDIO_SAMPLE_RATE);
-    alSourcei(alMainSource, AL_BUFFER, static_cast<ALint>(alMainBuffer));
-    alSourcePlay(alMainSource);
+    const ALuint source = effectSources[index];
+    effectStarted[index] = ++effectCounter;
+    alSourcei(source, AL_BUFFER, static_cast<ALint>(buffer));
+    alSourcei(source, AL_LOOPING, loop ? AL_TRUE : AL_FALSE);
+    alSourcePlay(source);
+
+    const int durationMs = soundData[sound].size() * 1000 / 2 / AUDIO_SAMPLE_RATE;
+    if (!soundTimer.isActive() || soundTimer.remainingTime() < durationMs)
+        soundTimer.start(durationMs + 50);
+}
+
+/**
+ * @brief Stops all looping sounds, runs on the audio thread.
+ */
+void OpenAL::doStopLoop()
+{
+    QMutexLocker locker(&audioLock);
+
+    if (!outputInitialized)
+        return;
+
+    for (ALuint source : effectSources) {
+        ALint looping = AL_FALSE;
+        alGetSourcei(source, AL_LOOPING, &looping);
+        if (looping) {
+            alSourcei(source, AL_LOOPING, AL_FALSE);
+            alSourceStop(source);
+            alSourcei(source, AL_BUFFER, AL_NONE);
+        }
+    }
 
-    int durationMs = data.size() * 1000 / 2 / AUDIO_SAMPLE_RATE;
-    QMetaObject::invokeMethod(&playMono16Timer, "start", Q_ARG(int, durationMs + 50));
+    soundTimer.start(0);
 }
 
 void OpenAL::playAudioBuffer(uint sourceId, const int16_t* data, int samples, unsigned channels,
@@ -483,13 +597,21 @@ void OpenAL::cleanupOutput()
     outputInitialized = false;
 
     if (alOutDev) {
-        alSourcei(alMainSource, AL_LOOPING, AL_FALSE);
-        alSourceStop(alMainSource);
-        alDeleteSources(1, &alMainSource);
+        // mixers stay subscribed, their sources are recreated once output is back
+        for (MixerOutput& output : mixerOutputs) {
+            releaseMixerOutput(output);
+        }
 
-        if (alMainBuffer) {
-            alDeleteBuffers(1, &alMainBuffer);
-            alMainBuffer = 0;
+        alSourceStopv(EFFECT_SOURCE_COUNT, effectSources);
+        alDeleteSources(EFFECT_SOURCE_COUNT, effectSources);
+        std::fill(effectSources, effectSources + EFFECT_SOURCE_COUNT, 0);
+
+        // the buffers belong to the context, they are uploaded again once output is reopened
+        for (ALuint& buffer : soundBuffers) {
+            if (buffer) {
+                alDeleteBuffers(1, &buffer);
+                buffer = 0;
+            }
         }
 
         if (!alcMakeContextCurrent(nullptr)) {
@@ -509,25 +631,28 @@ void OpenAL::cleanupOutput()
 }
 
 /**
- * @brief Called after a mono16 sound stopped playing
+ * @brief Called after the last sound should have stopped playing
  */
-void OpenAL::playMono16SoundCleanup()
+void OpenAL::soundCleanup()
 {
     QMutexLocker locker(&audioLock);
 
-    ALint state;
-    alGetSourcei(alMainSource, AL_SOURCE_STATE, &state);
-    if (state == AL_STOPPED) {
-        alSourcei(alMainSource, AL_BUFFER, AL_NONE);
-        alDeleteBuffers(1, &alMainBuffer);
-        alMainBuffer = 0;
-        // close the audio device if no other sources active
-        if (peerSources.isEmpty()) {
-            cleanupOutput();
+    if (!outputInitialized)
+        return;
+
+    for (ALuint source : effectSources) {
+        ALint state;
+        alGetSourcei(source, AL_SOURCE_STATE, &state);
+        if (state == AL_PLAYING) {
+            // a sound didn't finish or is looping, try again later
+            soundTimer.start(100);
+            return;
         }
-    } else {
-        // the audio didn't finish, try again later
-        playMono16Timer.start(10);
+    }
+
+    // close the audio device if no other sources active
+    if (peerSources.isEmpty() && mixerOutputs.isEmpty()) {
+        cleanupOutput();
     }
 }
 
@@ -543,12 +668,7 @@ float OpenAL::getVolume()
     const quint32 samples = AUDIO_FRAME_SAMPLE_COUNT_TOTAL;
     const float rootTwo = 1.414213562; // sqrt(2), but sqrt is not constexpr
     // calculate volume as the root mean squared of amplitudes in the sample
-    float sumOfSquares = 0;
-    for (quint32 i = 0; i < samples; i++) {
-        float sample = static_cast<float>(inputBuffer[i]) / std::numeric_limits<int16_t>::max();
-        sumOfSquares += std::pow(sample , 2);
-    }
-    const float rms = std::sqrt(sumOfSquares/samples);
+    const float rms = AudioDsp::rms(inputBuffer, samples) / std::numeric_limits<int16_t>::max();
     // our calculated normalized volume could possibly be above 1 because our RMS assumes a sinusoidal wave
     const float normalizedVolume = std::min(rms * rootTwo, 1.0f);
     return normalizedVolume;
@@ -564,18 +684,32 @@ void OpenAL::stopActive()
 
 /**
  * @brief handles recording of audio frames
+ *
+ * Drains every complete frame the device captured, so a late wakeup never leaves frames behind
+ * to be picked up one tick later.
  */
 void OpenAL::doInput()
 {
     ALint curSamples = 0;
     alcGetIntegerv(alInDev, ALC_CAPTURE_SAMPLES, sizeof(curSamples), &curSamples);
-    if (curSamples < static_cast<ALint>(AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL)) {
-        return;
+
+    while (curSamples >= static_cast<ALint>(AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL)) {
+        captureFrame();
+        curSamples -= AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL;
     }
 
+    pendingCaptureSamples = curSamples;
+}
+
+/**
+ * @brief Captures, amplifies and queues a single frame for sending.
+ */
+void OpenAL::captureFrame()
+{
     captureSamples(alInDev, inputBuffer, AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL);
 
-    applyGain(inputBuffer, AUDIO_FRAME_SAMPLE_COUNT_TOTAL, gainFactor);
+    // gain amplification with clipping to 16-bit boundaries
+    AudioDsp::applyGain(inputBuffer, AUDIO_FRAME_SAMPLE_COUNT_TOTAL, static_cast<float>(gainFactor));
 
     float volume = getVolume();
     if (volume >= inputThreshold) {
@@ -590,7 +724,28 @@ void OpenAL::doInput()
         return;
     }
 
-    emit Audio::frameAvailable(inputBuffer, AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL, channels, AUDIO_SAMPLE_RATE);
+    // encoding and sending can block on toxav, never do it on the audio thread
+    if (captureQueue.push(inputBuffer, AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL, channels, AUDIO_SAMPLE_RATE)) {
+        capturedFrames.release();
+    }
+}
+
+/**
+ * @brief Emits captured frames until the backend is destroyed.
+ *
+ * Runs on sendThread so that subscribers of frameAvailable, which encode and send the frame,
+ * don't delay capturing and playback.
+ */
+void OpenAL::sendFrames()
+{
+    AudioFrameQueue::Frame frame;
+    while (sending) {
+        capturedFrames.acquire();
+        while (captureQueue.front(frame)) {
+            emit Audio::frameAvailable(frame.pcm, frame.samples, frame.channels, frame.sampleRate);
+            captureQueue.pop();
+        }
+    }
 }
 
 void OpenAL::doOutput()
@@ -598,6 +753,73 @@ void OpenAL::doOutput()
     // Nothing
 }
 
+/**
+ * @brief Queues freshly mixed frames on the source of each subscribed mixer.
+ *
+ * Every mixer plays through a single source with a fixed set of buffers, processed buffers are
+ * refilled and requeued instead of being deleted and generated again.
+ */
+void OpenAL::doMixerOutput()
+{
+    int16_t frame[AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL * AudioJitterBuffer::MAX_CHANNELS];
+
+    for (MixerOutput& output : mixerOutputs) {
+        if (!output.source) {
+            alGenSources(1, &output.source);
+            alSourcei(output.source, AL_LOOPING, AL_FALSE);
+            alGenBuffers(MIXER_BUFFER_COUNT, output.buffers);
+            std::copy(output.buffers, output.buffers + MIXER_BUFFER_COUNT, output.freeBuffers);
+            output.freeCount = MIXER_BUFFER_COUNT;
+            checkAlError();
+        }
+
+        ALint processed = 0;
+        alGetSourcei(output.source, AL_BUFFERS_PROCESSED, &processed);
+        if (processed > 0) {
+            alSourceUnqueueBuffers(output.source, processed, output.freeBuffers + output.freeCount);
+            output.freeCount += processed;
+        }
+
+        const unsigned channels = output.mixer->getChannels();
+        const ALenum format = channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+        const ALsizei size =
+            static_cast<ALsizei>(AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL * channels * sizeof(int16_t));
+        bool queued = false;
+        while (output.freeCount > 0 && output.mixer->mix(frame, AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL)) {
+            ALuint bufid = output.freeBuffers[--output.freeCount];
+            alBufferData(bufid, format, frame, size, AUDIO_SAMPLE_RATE);
+            alSourceQueueBuffers(output.source, 1, &bufid);
+            queued = true;
+        }
+
+        if (queued) {
+            ALint state;
+            alGetSourcei(output.source, AL_SOURCE_STATE, &state);
+            if (state != AL_PLAYING) {
+                alSourcePlay(output.source);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Deletes the source and buffers of a mixer, the mixer itself stays subscribed.
+ * @param output Mixer output to release
+ */
+void OpenAL::releaseMixerOutput(MixerOutput& output)
+{
+    if (!output.source) {
+        return;
+    }
+
+    alSourceStop(output.source);
+    alSourcei(output.source, AL_BUFFER, AL_NONE);
+    alDeleteSources(1, &output.source);
+    alDeleteBuffers(MIXER_BUFFER_COUNT, output.buffers);
+    output.source = 0;
+    output.freeCount = 0;
+}
+
 /**
  * @brief Called on the captureTimer events to capture audio
  */
@@ -606,14 +828,23 @@ void OpenAL::doAudio()
     QMutexLocker lock(&audioLock);
 
     // Output section
-    if (outputInitialized && !peerSources.isEmpty()) {
+    if (outputInitialized && !(peerSources.isEmpty() && mixerOutputs.isEmpty())) {
+        doMixerOutput();
         doOutput();
     }
 
     // Input section
+    int interval = AUDIO_FRAME_DURATION / 2;
     if (alInDev && inSubscriptions) {
         doInput();
+
+        // sleep until the device has the next frame ready instead of polling at a fixed rate,
+        // output still gets serviced at least every half frame
+        const int missing = static_cast<int>(AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL) - pendingCaptureSamples;
+        interval = qBound(1, missing * 1000 / static_cast<int>(AUDIO_SAMPLE_RATE), interval);
     }
+
+    captureTimer.start(interval);
 }
 
 void OpenAL::captureSamples(ALCdevice* device, int16_t* buffer, ALCsizei samples)
@@ -707,29 +938,49 @@ void OpenAL::unsubscribeOutput(uint& sid)
         sid = 0;
     }
 
-    if (peerSources.isEmpty())
+    if (peerSources.isEmpty() && mixerOutputs.isEmpty())
         cleanupOutput();
 }
 
-void OpenAL::startLoop()
+/**
+ * @brief Plays the output of a mixer until it is unsubscribed.
+ * @param mixer Mixer to pull frames from on the audio thread
+ */
+void OpenAL::subscribeMixer(AudioMixer& mixer)
 {
     QMutexLocker locker(&audioLock);
-    alSourcei(alMainSource, AL_LOOPING, AL_TRUE);
+
+    if (!autoInitOutput()) {
+        qWarning("Failed to subscribe to audio output device.");
+        return;
+    }
+
+    MixerOutput output;
+    output.mixer = &mixer;
+    mixerOutputs << output;
+
+    qDebug() << "Audio mixer subscribed. Mixers active:" << mixerOutputs.size();
 }
 
-void OpenAL::stopLoop()
+/**
+ * @brief Stops playing a mixer, it is not accessed anymore once this returns.
+ * @param mixer Mixer to stop playing
+ */
+void OpenAL::unsubscribeMixer(AudioMixer& mixer)
 {
     QMutexLocker locker(&audioLock);
-    alSourcei(alMainSource, AL_LOOPING, AL_FALSE);
-    alSourceStop(alMainSource);
 
-    ALint state;
-    alGetSourcei(alMainSource, AL_SOURCE_STATE, &state);
-    if (state == AL_STOPPED) {
-        alSourcei(alMainSource, AL_BUFFER, AL_NONE);
-        alDeleteBuffers(1, &alMainBuffer);
-        alMainBuffer = 0;
+    for (int i = 0; i < mixerOutputs.size(); ++i) {
+        if (mixerOutputs[i].mixer == &mixer) {
+            releaseMixerOutput(mixerOutputs[i]);
+            mixerOutputs.remove(i);
+            qDebug() << "Audio mixer unsubscribed. Mixers active:" << mixerOutputs.size();
+            break;
+        }
     }
+
+    if (peerSources.isEmpty() && mixerOutputs.isEmpty())
+        cleanupOutput();
 }
 
 qreal OpenAL::inputGain() const
@@ -22,13 +22,17 @@
 #define OPENAL_H
 
 #include "src/audio/audio.h"
+#include "src/audio/audioframequeue.h"
 
 #include <atomic>
 #include <cmath>
 
 #include <QMutex>
 #include <QObject>
+#include <QSemaphore>
+#include <QThread>
 #include <QTimer>
+#include <QVector>
 
 #include <cassert>
 
@@ -79,19 +83,34 @@ public:
     void subscribeOutput(uint& sourceId);
     void unsubscribeOutput(uint& sourceId);
 
+    void subscribeMixer(AudioMixer& mixer);
+    void unsubscribeMixer(AudioMixer& mixer);
+
     void subscribeInput();
     void unsubscribeInput();
 
-    void startLoop();
+    void playSound(Sound sound);
+    void startLoop(Sound sound);
     void stopLoop();
-    void playMono16Sound(const QByteArray& data);
-    void playMono16Sound(const QString& path);
     void stopActive();
 
     void playAudioBuffer(uint sourceId, const int16_t* data, int samples, unsigned channels,
                          int sampleRate);
 
 protected:
+    static constexpr int MIXER_BUFFER_COUNT = 3;
+    static constexpr int EFFECT_SOURCE_COUNT = 4;
+    static constexpr int SOUND_COUNT = static_cast<int>(Sound::CallEnd) + 1;
+
+    struct MixerOutput
+    {
+        AudioMixer* mixer = nullptr;
+        ALuint source = 0;
+        ALuint buffers[MIXER_BUFFER_COUNT] = {0};
+        ALuint freeBuffers[MIXER_BUFFER_COUNT] = {0};
+        int freeCount = 0;
+    };
+
     static void checkAlError() noexcept;
     static void checkAlcError(ALCdevice* device) noexcept;
 
@@ -107,30 +126,44 @@ protected:
     void doAudio();
 
     virtual void doInput();
+    void captureFrame();
+    void sendFrames();
     virtual void doOutput();
+    void doMixerOutput();
+    void releaseMixerOutput(MixerOutput& output);
     virtual void captureSamples(ALCdevice* device, int16_t* buffer, ALCsizei samples);
 
 private:
     virtual bool initInput(const QString& deviceName);
     virtual bool initOutput(const QString& outDevDescr);
-    void playMono16SoundCleanup();
+    void loadSounds();
+    ALuint getSoundBuffer(int sound);
+    void soundCleanup();
     float getVolume();
 
+private slots:
+    void doPlaySound(int sound, bool loop);
+    void doStopLoop();
+
 protected:
     QThread* audioThread;
     mutable QMutex audioLock;
 
     ALCdevice* alInDev = nullptr;
     quint32 inSubscriptions = 0;
-    QTimer captureTimer, playMono16Timer;
+    QTimer captureTimer, soundTimer;
 
     ALCdevice* alOutDev = nullptr;
     ALCcontext* alOutContext = nullptr;
-    ALuint alMainSource = 0;
-    ALuint alMainBuffer = 0;
+    ALuint effectSources[EFFECT_SOURCE_COUNT] = {0};
+    quint64 effectStarted[EFFECT_SOURCE_COUNT] = {0};
+    quint64 effectCounter = 0;
+    QByteArray soundData[SOUND_COUNT];
+    ALuint soundBuffers[SOUND_COUNT] = {0};
     bool outputInitialized = false;
 
     QList<ALuint> peerSources;
+    QVector<MixerOutput> mixerOutputs;
     int channels = 0;
     qreal gain = 0;
     qreal gainFactor = 1;
@@ -143,6 +176,12 @@ protected:
     const qreal minInThreshold = 0.0;
     const qreal maxInThreshold = 0.4;
     int16_t* inputBuffer = nullptr;
+    ALint pendingCaptureSamples = 0;
+
+    AudioFrameQueue captureQueue;
+    QSemaphore capturedFrames;
+    std::atomic<bool> sending{true};
+    QThread sendThread;
 };
 
 #endif // OPENAL_H
@@ -18,8 +18,6 @@
 */
 
 #include "openal2.h"
-#include "src/core/core.h"
-#include "src/core/coreav.h"
 #include "src/persistence/settings.h"
 
 #include <QDebug>
@@ -47,7 +45,7 @@ extern "C" {
  *              \               |               |                            |
  *               -> alProxyDev -> filter_audio -> alProxySource -> alOutDev -> Soundcard
  *              /
- * alMainSource
+ * effectSources[]
  *
  * Without echo cancelling the pipeline is simplified through alProxyDev = alOutDev
  * and alProxyContext = alOutContext
@@ -57,7 +55,7 @@ extern "C" {
  *              \             |
  *               -> alOutDev -> Soundcard
  *              /
- * alMainSource
+ * effectSources[]
  *
  * To keep all functions in writing to the correct context, all functions changing
  * the context MUST exit with alProxyContext as active context and MUST not be
@@ -243,19 +241,13 @@ bool OpenAL2::initOutput(const QString& deviceName)
         alProxyContext = alOutContext;
     }
 
-    alGenSources(1, &alMainSource);
+    alGenSources(EFFECT_SOURCE_COUNT, effectSources);
     checkAlError();
 
     // init master volume
     alListenerf(AL_GAIN, Settings::getInstance().getOutVolume() * 0.01f);
     checkAlError();
 
-    Core* core = Core::getInstance();
-    if (core) {
-        // reset each call's audio source
-        core->getAv()->invalidateCallSources();
-    }
-
     // ensure alProxyContext is active
     alcMakeContextCurrent(alProxyContext);
     outputInitialized = true;
@@ -59,7 +59,6 @@ protected:
     bool initInput(const QString& deviceName) override;
     bool initOutput(const QString& outDevDescr) override;
     void cleanupOutput() override;
-    void playMono16SoundCleanup();
     void doOutput() override;
     bool loadOpenALExtensions(ALCdevice* dev);
     bool initOutputEchoCancel();
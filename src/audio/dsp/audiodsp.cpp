@@ -0,0 +1,252 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "audiodsp.h"
+#include "audiodspkernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+/**
+ * @namespace AudioDsp
+ * @brief Vectorized helpers for the per-frame work on 16 bit PCM audio.
+ *
+ * Every operation has a scalar reference implementation and SSE2, AVX2 and NEON variants. The
+ * fastest variant supported by the CPU is picked once at runtime. All variants use the same
+ * arithmetic (single precision, round to nearest even, saturation to the 16 bit range), so they
+ * are bit-exact with the scalar path.
+ *
+ * @struct AudioDsp::Kernels
+ * @brief Table of the implementations for one instruction set.
+ *
+ * @var AudioDsp::Kernels::applyGain
+ * @brief Multiplies samples by a gain, rounding and clipping to the 16 bit range.
+ * @var AudioDsp::Kernels::sumOfSquares
+ * @brief Exact sum of the squared samples.
+ * @var AudioDsp::Kernels::peak
+ * @brief Largest absolute sample value, 0 to 32768.
+ * @var AudioDsp::Kernels::toFloat
+ * @brief Converts samples to floats in [-1, 1).
+ * @var AudioDsp::Kernels::fromFloat
+ * @brief Converts floats back to samples, rounding and clipping.
+ * @var AudioDsp::Kernels::mixAccumulate
+ * @brief Adds samples to a 32 bit accumulator.
+ * @var AudioDsp::Kernels::mixSaturate
+ * @brief Clips an accumulator back to 16 bit samples.
+ */
+
+namespace AudioDsp {
+
+namespace {
+const float sampleScale = 32768.0f;
+const float minSample = std::numeric_limits<int16_t>::min();
+const float maxSample = std::numeric_limits<int16_t>::max();
+
+// Mix buffer size, larger inputs are mixed in chunks
+const size_t mixChunk = 1024;
+
+inline int16_t roundAndClip(float value)
+{
+    value = std::min(std::max(value, minSample), maxSample);
+    return static_cast<int16_t>(std::lrint(value));
+}
+
+const Kernels scalar = {Scalar::applyGain,   Scalar::sumOfSquares,  Scalar::peak,
+                        Scalar::toFloat,     Scalar::fromFloat,     Scalar::mixAccumulate,
+                        Scalar::mixSaturate};
+
+const Kernels& best()
+{
+    static const Kernels& kernels = *getKernels(getBestIsa());
+    return kernels;
+}
+} // namespace
+
+namespace Scalar {
+void applyGain(int16_t* buffer, size_t count, float gain)
+{
+    for (size_t i = 0; i < count; ++i) {
+        buffer[i] = roundAndClip(buffer[i] * gain);
+    }
+}
+
+uint64_t sumOfSquares(const int16_t* buffer, size_t count)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sum += static_cast<uint64_t>(static_cast<int32_t>(buffer[i]) * buffer[i]);
+    }
+    return sum;
+}
+
+int peak(const int16_t* buffer, size_t count)
+{
+    int result = 0;
+    for (size_t i = 0; i < count; ++i) {
+        result = std::max(result, std::abs(static_cast<int>(buffer[i])));
+    }
+    return result;
+}
+
+void toFloat(const int16_t* in, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = in[i] * (1.0f / sampleScale);
+    }
+}
+
+void fromFloat(const float* in, int16_t* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = roundAndClip(in[i] * sampleScale);
+    }
+}
+
+void mixAccumulate(int32_t* acc, const int16_t* in, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        acc[i] += in[i];
+    }
+}
+
+void mixSaturate(const int32_t* acc, int16_t* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<int16_t>(std::min<int32_t>(std::max<int32_t>(acc[i], INT16_MIN), INT16_MAX));
+    }
+}
+} // namespace Scalar
+
+/**
+ * @brief Get the kernels for an instruction set.
+ * @param isa Instruction set to get the kernels for.
+ * @return Kernel table, nullptr if the build or the CPU doesn't support the instruction set.
+ */
+const Kernels* getKernels(Isa isa)
+{
+    switch (isa) {
+    case Isa::Scalar:
+        return &scalar;
+    case Isa::Sse2:
+        return sse2Kernels();
+    case Isa::Avx2:
+        return avx2Kernels();
+    case Isa::Neon:
+        return neonKernels();
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Finds the fastest instruction set usable on this CPU.
+ */
+Isa getBestIsa()
+{
+    for (Isa isa : {Isa::Avx2, Isa::Neon, Isa::Sse2}) {
+        if (getKernels(isa)) {
+            return isa;
+        }
+    }
+
+    return Isa::Scalar;
+}
+
+const char* getIsaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::Scalar:
+        return "scalar";
+    case Isa::Sse2:
+        return "SSE2";
+    case Isa::Avx2:
+        return "AVX2";
+    case Isa::Neon:
+        return "NEON";
+    }
+
+    return "unknown";
+}
+
+/**
+ * @brief Amplifies samples in place.
+ * @param buffer Samples to amplify.
+ * @param count Number of samples.
+ * @param gain Linear gain factor, results are clipped to the 16 bit range.
+ */
+void applyGain(int16_t* buffer, size_t count, float gain)
+{
+    best().applyGain(buffer, count, gain);
+}
+
+/**
+ * @brief Calculates the root mean square of samples.
+ * @return RMS in sample units, 0 for an empty buffer.
+ */
+float rms(const int16_t* buffer, size_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    return std::sqrt(static_cast<float>(best().sumOfSquares(buffer, count)) / count);
+}
+
+/**
+ * @brief Finds the largest absolute sample value.
+ * @return Peak in sample units, 0 to 32768.
+ */
+int peak(const int16_t* buffer, size_t count)
+{
+    return best().peak(buffer, count);
+}
+
+void toFloat(const int16_t* in, float* out, size_t count)
+{
+    best().toFloat(in, out, count);
+}
+
+void fromFloat(const float* in, int16_t* out, size_t count)
+{
+    best().fromFloat(in, out, count);
+}
+
+/**
+ * @brief Sums several streams into one, clipping only the final result.
+ * @param out Mixed samples, may alias one of the inputs.
+ * @param inputs Streams to mix, each holding at least count samples.
+ * @param inputCount Number of streams.
+ * @param count Number of samples per stream.
+ */
+void mix(int16_t* out, const int16_t* const* inputs, size_t inputCount, size_t count)
+{
+    const Kernels& k = best();
+    int32_t acc[mixChunk];
+
+    for (size_t offset = 0; offset < count; offset += mixChunk) {
+        const size_t n = std::min(mixChunk, count - offset);
+        std::fill(acc, acc + n, 0);
+        for (size_t i = 0; i < inputCount; ++i) {
+            k.mixAccumulate(acc, inputs[i] + offset, n);
+        }
+        k.mixSaturate(acc, out + offset, n);
+    }
+}
+} // namespace AudioDsp
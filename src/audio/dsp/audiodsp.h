@@ -0,0 +1,59 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIODSP_H
+#define AUDIODSP_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace AudioDsp {
+
+enum class Isa
+{
+    Scalar,
+    Sse2,
+    Avx2,
+    Neon
+};
+
+struct Kernels
+{
+    void (*applyGain)(int16_t* buffer, size_t count, float gain);
+    uint64_t (*sumOfSquares)(const int16_t* buffer, size_t count);
+    int (*peak)(const int16_t* buffer, size_t count);
+    void (*toFloat)(const int16_t* in, float* out, size_t count);
+    void (*fromFloat)(const float* in, int16_t* out, size_t count);
+    void (*mixAccumulate)(int32_t* acc, const int16_t* in, size_t count);
+    void (*mixSaturate)(const int32_t* acc, int16_t* out, size_t count);
+};
+
+const Kernels* getKernels(Isa isa);
+Isa getBestIsa();
+const char* getIsaName(Isa isa);
+
+void applyGain(int16_t* buffer, size_t count, float gain);
+float rms(const int16_t* buffer, size_t count);
+int peak(const int16_t* buffer, size_t count);
+void toFloat(const int16_t* in, float* out, size_t count);
+void fromFloat(const float* in, int16_t* out, size_t count);
+void mix(int16_t* out, const int16_t* const* inputs, size_t inputCount, size_t count);
+}
+
+#endif // AUDIODSP_H
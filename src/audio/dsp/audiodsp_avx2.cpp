@@ -0,0 +1,170 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "audiodspkernels.h"
+
+// Compiled for the AVX2 target per function rather than with -mavx2 for the whole file, so the
+// compiler can't leak AVX2 instructions into code that runs before the CPU check.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+namespace AudioDsp {
+namespace {
+AVX2_TARGET inline __m256 widen(__m128i s)
+{
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s));
+}
+
+AVX2_TARGET inline __m256i packSaturate(__m256i lo, __m256i hi)
+{
+    // packs works per 128 bit lane, restore the sample order afterwards
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+}
+
+AVX2_TARGET inline __m256i roundAndClip(__m256 lo, __m256 hi)
+{
+    const __m256 minSample = _mm256_set1_ps(-32768.0f);
+    const __m256 maxSample = _mm256_set1_ps(32767.0f);
+    lo = _mm256_min_ps(_mm256_max_ps(lo, minSample), maxSample);
+    hi = _mm256_min_ps(_mm256_max_ps(hi, minSample), maxSample);
+    return packSaturate(_mm256_cvtps_epi32(lo), _mm256_cvtps_epi32(hi));
+}
+
+AVX2_TARGET void applyGain(int16_t* buffer, size_t count, float gain)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + i));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + i + 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(buffer + i),
+                            roundAndClip(_mm256_mul_ps(widen(lo), g), _mm256_mul_ps(widen(hi), g)));
+    }
+    Scalar::applyGain(buffer + i, count - i, gain);
+}
+
+AVX2_TARGET uint64_t sumOfSquares(const int16_t* buffer, size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + i));
+        // pairs of squares sum up to at most 2^31, which fits unsigned 32 bit lanes
+        const __m256i sq = _mm256_madd_epi16(s, s);
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(sq, zero));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(sq, zero));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3]
+           + Scalar::sumOfSquares(buffer + i, count - i);
+}
+
+AVX2_TARGET int peak(const int16_t* buffer, size_t count)
+{
+    __m256i maxv = _mm256_setzero_si256();
+    __m256i minv = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + i));
+        maxv = _mm256_max_epi16(maxv, s);
+        minv = _mm256_min_epi16(minv, s);
+    }
+
+    int16_t maxLanes[16], minLanes[16];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxLanes), maxv);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(minLanes), minv);
+    int result = Scalar::peak(buffer + i, count - i);
+    for (int l = 0; l < 16; ++l) {
+        result = maxLanes[l] > result ? maxLanes[l] : result;
+        result = -minLanes[l] > result ? -minLanes[l] : result;
+    }
+    return result;
+}
+
+AVX2_TARGET void toFloat(const int16_t* in, float* out, size_t count)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(widen(s), scale));
+    }
+    Scalar::toFloat(in + i, out + i, count - i);
+}
+
+AVX2_TARGET void fromFloat(const float* in, int16_t* out, size_t count)
+{
+    const __m256 scale = _mm256_set1_ps(32768.0f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256 lo = _mm256_mul_ps(_mm256_loadu_ps(in + i), scale);
+        const __m256 hi = _mm256_mul_ps(_mm256_loadu_ps(in + i + 8), scale);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), roundAndClip(lo, hi));
+    }
+    Scalar::fromFloat(in + i, out + i, count - i);
+}
+
+AVX2_TARGET void mixAccumulate(int32_t* acc, const int16_t* in, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m256i* a = reinterpret_cast<__m256i*>(acc + i);
+        _mm256_storeu_si256(a, _mm256_add_epi32(_mm256_loadu_si256(a), _mm256_cvtepi16_epi32(s)));
+    }
+    Scalar::mixAccumulate(acc + i, in + i, count - i);
+}
+
+AVX2_TARGET void mixSaturate(const int32_t* acc, int16_t* out, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i* a = reinterpret_cast<const __m256i*>(acc + i);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            packSaturate(_mm256_loadu_si256(a), _mm256_loadu_si256(a + 1)));
+    }
+    Scalar::mixSaturate(acc + i, out + i, count - i);
+}
+
+const Kernels kernels = {applyGain, sumOfSquares,  peak,       toFloat,
+                         fromFloat, mixAccumulate, mixSaturate};
+} // namespace
+
+/**
+ * @brief AVX2 kernels, only if the CPU we're running on supports them.
+ */
+const Kernels* avx2Kernels()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported ? &kernels : nullptr;
+}
+} // namespace AudioDsp
+
+#else
+
+const AudioDsp::Kernels* AudioDsp::avx2Kernels()
+{
+    return nullptr;
+}
+
+#endif
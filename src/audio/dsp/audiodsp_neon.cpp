@@ -0,0 +1,148 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "audiodspkernels.h"
+
+// Limited to AArch64, where NEON is mandatory and has the round-to-nearest conversion
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+
+namespace AudioDsp {
+namespace {
+inline int16x8_t roundAndClip(float32x4_t lo, float32x4_t hi)
+{
+    const float32x4_t minSample = vdupq_n_f32(-32768.0f);
+    const float32x4_t maxSample = vdupq_n_f32(32767.0f);
+    lo = vminq_f32(vmaxq_f32(lo, minSample), maxSample);
+    hi = vminq_f32(vmaxq_f32(hi, minSample), maxSample);
+    return vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(lo)), vqmovn_s32(vcvtnq_s32_f32(hi)));
+}
+
+inline float32x4_t widenLo(int16x8_t s)
+{
+    return vcvtq_f32_s32(vmovl_s16(vget_low_s16(s)));
+}
+
+inline float32x4_t widenHi(int16x8_t s)
+{
+    return vcvtq_f32_s32(vmovl_s16(vget_high_s16(s)));
+}
+
+void applyGain(int16_t* buffer, size_t count, float gain)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t s = vld1q_s16(buffer + i);
+        vst1q_s16(buffer + i, roundAndClip(vmulq_n_f32(widenLo(s), gain),
+                                           vmulq_n_f32(widenHi(s), gain)));
+    }
+    Scalar::applyGain(buffer + i, count - i, gain);
+}
+
+uint64_t sumOfSquares(const int16_t* buffer, size_t count)
+{
+    int64x2_t acc = vdupq_n_s64(0);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t s = vld1q_s16(buffer + i);
+        acc = vpadalq_s32(acc, vmull_s16(vget_low_s16(s), vget_low_s16(s)));
+        acc = vpadalq_s32(acc, vmull_high_s16(s, s));
+    }
+
+    return static_cast<uint64_t>(vaddvq_s64(acc)) + Scalar::sumOfSquares(buffer + i, count - i);
+}
+
+int peak(const int16_t* buffer, size_t count)
+{
+    int16x8_t maxv = vdupq_n_s16(0);
+    int16x8_t minv = vdupq_n_s16(0);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t s = vld1q_s16(buffer + i);
+        maxv = vmaxq_s16(maxv, s);
+        minv = vminq_s16(minv, s);
+    }
+
+    int result = Scalar::peak(buffer + i, count - i);
+    const int maxSample = vmaxvq_s16(maxv);
+    const int minSample = -static_cast<int>(vminvq_s16(minv));
+    result = maxSample > result ? maxSample : result;
+    return minSample > result ? minSample : result;
+}
+
+void toFloat(const int16_t* in, float* out, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t s = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_n_f32(widenLo(s), 1.0f / 32768.0f));
+        vst1q_f32(out + i + 4, vmulq_n_f32(widenHi(s), 1.0f / 32768.0f));
+    }
+    Scalar::toFloat(in + i, out + i, count - i);
+}
+
+void fromFloat(const float* in, int16_t* out, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const float32x4_t lo = vmulq_n_f32(vld1q_f32(in + i), 32768.0f);
+        const float32x4_t hi = vmulq_n_f32(vld1q_f32(in + i + 4), 32768.0f);
+        vst1q_s16(out + i, roundAndClip(lo, hi));
+    }
+    Scalar::fromFloat(in + i, out + i, count - i);
+}
+
+void mixAccumulate(int32_t* acc, const int16_t* in, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t s = vld1q_s16(in + i);
+        vst1q_s32(acc + i, vaddw_s16(vld1q_s32(acc + i), vget_low_s16(s)));
+        vst1q_s32(acc + i + 4, vaddw_s16(vld1q_s32(acc + i + 4), vget_high_s16(s)));
+    }
+    Scalar::mixAccumulate(acc + i, in + i, count - i);
+}
+
+void mixSaturate(const int32_t* acc, int16_t* out, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vld1q_s32(acc + i)),
+                                        vqmovn_s32(vld1q_s32(acc + i + 4))));
+    }
+    Scalar::mixSaturate(acc + i, out + i, count - i);
+}
+
+const Kernels kernels = {applyGain, sumOfSquares,  peak,       toFloat,
+                         fromFloat, mixAccumulate, mixSaturate};
+} // namespace
+
+const Kernels* neonKernels()
+{
+    return &kernels;
+}
+} // namespace AudioDsp
+
+#else
+
+const AudioDsp::Kernels* AudioDsp::neonKernels()
+{
+    return nullptr;
+}
+
+#endif
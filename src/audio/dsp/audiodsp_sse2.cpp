@@ -0,0 +1,166 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "audiodspkernels.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+namespace AudioDsp {
+namespace {
+inline __m128 widenLo(__m128i s)
+{
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+}
+
+inline __m128 widenHi(__m128i s)
+{
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+}
+
+inline __m128i roundAndClip(__m128 lo, __m128 hi)
+{
+    const __m128 minSample = _mm_set1_ps(-32768.0f);
+    const __m128 maxSample = _mm_set1_ps(32767.0f);
+    lo = _mm_min_ps(_mm_max_ps(lo, minSample), maxSample);
+    hi = _mm_min_ps(_mm_max_ps(hi, minSample), maxSample);
+    return _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+}
+
+void applyGain(int16_t* buffer, size_t count, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i* p = reinterpret_cast<__m128i*>(buffer + i);
+        const __m128i s = _mm_loadu_si128(p);
+        _mm_storeu_si128(p, roundAndClip(_mm_mul_ps(widenLo(s), g), _mm_mul_ps(widenHi(s), g)));
+    }
+    Scalar::applyGain(buffer + i, count - i, gain);
+}
+
+uint64_t sumOfSquares(const int16_t* buffer, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + i));
+        // pairs of squares sum up to at most 2^31, which fits unsigned 32 bit lanes
+        const __m128i sq = _mm_madd_epi16(s, s);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
+    }
+
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    return lanes[0] + lanes[1] + Scalar::sumOfSquares(buffer + i, count - i);
+}
+
+int peak(const int16_t* buffer, size_t count)
+{
+    __m128i maxv = _mm_setzero_si128();
+    __m128i minv = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + i));
+        maxv = _mm_max_epi16(maxv, s);
+        minv = _mm_min_epi16(minv, s);
+    }
+
+    int16_t maxLanes[8], minLanes[8];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maxLanes), maxv);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(minLanes), minv);
+    int result = Scalar::peak(buffer + i, count - i);
+    for (int l = 0; l < 8; ++l) {
+        result = maxLanes[l] > result ? maxLanes[l] : result;
+        result = -minLanes[l] > result ? -minLanes[l] : result;
+    }
+    return result;
+}
+
+void toFloat(const int16_t* in, float* out, size_t count)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_ps(out + i, _mm_mul_ps(widenLo(s), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(widenHi(s), scale));
+    }
+    Scalar::toFloat(in + i, out + i, count - i);
+}
+
+void fromFloat(const float* in, int16_t* out, size_t count)
+{
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128 lo = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+        const __m128 hi = _mm_mul_ps(_mm_loadu_ps(in + i + 4), scale);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), roundAndClip(lo, hi));
+    }
+    Scalar::fromFloat(in + i, out + i, count - i);
+}
+
+void mixAccumulate(int32_t* acc, const int16_t* in, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a),
+                                          _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1),
+                                              _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)));
+    }
+    Scalar::mixAccumulate(acc + i, in + i, count - i);
+}
+
+void mixSaturate(const int32_t* acc, int16_t* out, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i* a = reinterpret_cast<const __m128i*>(acc + i);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_packs_epi32(_mm_loadu_si128(a), _mm_loadu_si128(a + 1)));
+    }
+    Scalar::mixSaturate(acc + i, out + i, count - i);
+}
+
+const Kernels kernels = {applyGain, sumOfSquares,  peak,       toFloat,
+                         fromFloat, mixAccumulate, mixSaturate};
+} // namespace
+
+/**
+ * @brief SSE2 is part of x86-64, so it's available whenever we were built with it.
+ */
+const Kernels* sse2Kernels()
+{
+    return &kernels;
+}
+} // namespace AudioDsp
+
+#else
+
+const AudioDsp::Kernels* AudioDsp::sse2Kernels()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIODSPKERNELS_H
+#define AUDIODSPKERNELS_H
+
+#include "audiodsp.h"
+
+/*
+ * Internal interface between the dispatcher and the per-instruction-set kernels.
+ * The SIMD kernels handle the bulk of a buffer and hand the remaining tail to the
+ * scalar kernels, so all implementations produce bit-identical results.
+ */
+
+namespace AudioDsp {
+namespace Scalar {
+void applyGain(int16_t* buffer, size_t count, float gain);
+uint64_t sumOfSquares(const int16_t* buffer, size_t count);
+int peak(const int16_t* buffer, size_t count);
+void toFloat(const int16_t* in, float* out, size_t count);
+void fromFloat(const float* in, int16_t* out, size_t count);
+void mixAccumulate(int32_t* acc, const int16_t* in, size_t count);
+void mixSaturate(const int32_t* acc, int16_t* out, size_t count);
+}
+
+const Kernels* sse2Kernels();
+const Kernels* avx2Kernels();
+const Kernels* neonKernels();
+}
+
+#endif // AUDIODSPKERNELS_H
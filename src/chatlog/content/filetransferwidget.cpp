@@ -20,15 +20,14 @@
 #include "filetransferwidget.h"
 #include "ui_filetransferwidget.h"
 
+#include "src/chatlog/filetransferregistry.h"
+#include "src/chatlog/thumbnailcache.h"
 #include "src/core/core.h"
 #include "src/persistence/settings.h"
 #include "src/widget/gui.h"
 #include "src/widget/style.h"
 #include "src/widget/widget.h"
 
-#include <libexif/exif-loader.h>
-
-#include <QBuffer>
 #include <QDebug>
 #include <QDesktopServices>
 #include <QDesktopWidget>
@@ -37,6 +36,7 @@
 #include <QMessageBox>
 #include <QMouseEvent>
 #include <QPainter>
+#include <QToolTip>
 #include <QVariantAnimation>
 
 #include <cassert>
@@ -85,8 +85,8 @@ FileTransferWidget::FileTransferWidget(QWidget* parent, ToxFile file)
         update();
     });
 
-    connect(Core::getInstance(), &Core::fileTransferInfo, this,
-            &FileTransferWidget::onFileTransferInfo);
+    connect(Core::getInstance(), &Core::fileTransferOffered, this,
+            &FileTransferWidget::onFileTransferOffered);
     connect(Core::getInstance(), &Core::fileTransferAccepted, this,
             &FileTransferWidget::onFileTransferAccepted);
     connect(Core::getInstance(), &Core::fileTransferCancelled, this,
@@ -103,6 +103,15 @@ FileTransferWidget::FileTransferWidget(QWidget* parent, ToxFile file)
     connect(ui->rightButton, &QPushButton::clicked, this, &FileTransferWidget::onRightButtonClicked);
     connect(ui->previewButton, &QPushButton::clicked, this,
             &FileTransferWidget::onPreviewButtonClicked);
+    connect(&ThumbnailCache::getInstance(), &ThumbnailCache::thumbnailReady, this,
+            &FileTransferWidget::onThumbnailReady);
+    connect(&ThumbnailCache::getInstance(), &ThumbnailCache::previewReady, this,
+            &FileTransferWidget::onPreviewReady);
+    ui->previewButton->installEventFilter(this);
+
+    if (file.status != ToxFile::FINISHED && file.status != ToxFile::CANCELED) {
+        FileTransferRegistry::getInstance().subscribe(file.friendId, file.fileNum, this);
+    }
 
     // Set lastStatus to anything but the file's current value, this forces an update
     lastStatus = file.status == ToxFile::FINISHED ? ToxFile::INITIALIZING : ToxFile::FINISHED;
@@ -113,6 +122,7 @@ FileTransferWidget::FileTransferWidget(QWidget* parent, ToxFile file)
 
 FileTransferWidget::~FileTransferWidget()
 {
+    FileTransferRegistry::getInstance().unsubscribe(fileInfo.friendId, fileInfo.fileNum, this);
     delete ui;
 }
 
@@ -260,7 +270,24 @@ void FileTransferWidget::paintEvent(QPaintEvent*)
     }
 }
 
-void FileTransferWidget::onFileTransferInfo(ToxFile file)
+/**
+ * @brief Update the progress of a running transfer, called by FileTransferRegistry.
+ */
+void FileTransferWidget::onFileTransferProgress(const ToxFileProgressInfo& progress)
+{
+    fileInfo.bytesSent = progress.bytesSent;
+    fileInfo.filesize = progress.filesize;
+
+    // If we repainted on every packet our gui would be *very* slow
+    if (fileInfo.status != ToxFile::TRANSMITTING || !fileProgress.needsUpdate()) {
+        return;
+    }
+
+    updateFileProgress(fileInfo);
+    update();
+}
+
+void FileTransferWidget::onFileTransferOffered(ToxFile file)
 {
     updateWidget(file);
 }
@@ -301,10 +328,8 @@ void FileTransferWidget::fileTransferRemotePausedUnpaused(ToxFile file, bool pau
 
 void FileTransferWidget::fileTransferBrokenUnbroken(ToxFile file, bool broken)
 {
-    // TODO: Handle broken transfer differently once we have resuming code
-    if (broken) {
-        onFileTransferCancelled(file);
-    }
+    Q_UNUSED(broken);
+    updateWidget(file);
 }
 
 QString FileTransferWidget::getHumanReadableSize(qint64 size)
@@ -371,6 +396,9 @@ void FileTransferWidget::updateWidgetText(ToxFile const& file)
         ui->progressLabel->setText(tr("Resuming...", "file transfer widget"));
         break;
     case ToxFile::BROKEN:
+        ui->etaLabel->setText("");
+        ui->progressLabel->setText(tr("Connection lost", "file transfer widget"));
+        break;
     case ToxFile::CANCELED:
         break;
     case ToxFile::FINISHED:
@@ -412,6 +440,7 @@ void FileTransferWidget::updateFileProgress(ToxFile const& file)
     case ToxFile::INITIALIZING:
         break;
     case ToxFile::PAUSED:
+    case ToxFile::BROKEN:
         fileProgress.resetSpeed();
         break;
     case ToxFile::TRANSMITTING: {
@@ -439,7 +468,6 @@ void FileTransferWidget::updateFileProgress(ToxFile const& file)
         ui->progressLabel->setText(getHumanReadableSize(speed) + "/s");
         break;
     }
-    case ToxFile::BROKEN:
     case ToxFile::CANCELED:
     case ToxFile::FINISHED: {
         ui->progressBar->hide();
@@ -461,11 +489,11 @@ void FileTransferWidget::updateSignals(ToxFile const& file)
 
     switch (file.status) {
     case ToxFile::CANCELED:
-    case ToxFile::BROKEN:
     case ToxFile::FINISHED:
         active = false;
         disconnect(Core::getInstance(), nullptr, this, nullptr);
         break;
+    case ToxFile::BROKEN:
     case ToxFile::INITIALIZING:
     case ToxFile::PAUSED:
     case ToxFile::TRANSMITTING:
@@ -487,6 +515,7 @@ void FileTransferWidget::setupButtons(ToxFile const& file)
         ui->leftButton->setIcon(QIcon(Style::getImagePath("fileTransferInstance/pause.svg")));
         ui->leftButton->setObjectName("pause");
         ui->leftButton->setToolTip(tr("Pause transfer"));
+        ui->leftButton->show();
 
         ui->rightButton->setIcon(QIcon(Style::getImagePath("fileTransferInstance/no.svg")));
         ui->rightButton->setObjectName("cancel");
@@ -505,6 +534,7 @@ void FileTransferWidget::setupButtons(ToxFile const& file)
             ui->leftButton->setObjectName("pause");
             ui->leftButton->setToolTip(tr("Pause transfer"));
         }
+        ui->leftButton->show();
 
         ui->rightButton->setIcon(QIcon(Style::getImagePath("fileTransferInstance/no.svg")));
         ui->rightButton->setObjectName("cancel");
@@ -527,9 +557,18 @@ void FileTransferWidget::setupButtons(ToxFile const& file)
             ui->leftButton->setObjectName("accept");
             ui->leftButton->setToolTip(tr("Accept transfer"));
         }
+        ui->leftButton->show();
         break;
-    case ToxFile::CANCELED:
     case ToxFile::BROKEN:
+        // resumed when the friend is back, until then it can only be cancelled
+        ui->leftButton->hide();
+        ui->rightButton->setIcon(QIcon(Style::getImagePath("fileTransferInstance/no.svg")));
+        ui->rightButton->setObjectName("cancel");
+        ui->rightButton->setToolTip(tr("Cancel transfer"));
+
+        setButtonColor(Style::getColor(Style::LightGrey));
+        break;
+    case ToxFile::CANCELED:
         ui->leftButton->hide();
         ui->rightButton->hide();
         break;
@@ -593,140 +632,73 @@ void FileTransferWidget::showPreview(const QString& filename)
                                                   "PNG", "JPEG", "JPG", "GIF", "SVG"};
 
     if (previewExtensions.contains(QFileInfo(filename).suffix())) {
+        previewPath = filename;
         // Subtract to make border visible
         const int size = qMax(ui->previewButton->width(), ui->previewButton->height()) - 4;
 
-        QFile imageFile(filename);
-        if (!imageFile.open(QIODevice::ReadOnly)) {
-            return;
-        }
-        const QByteArray imageFileData = imageFile.readAll();
-        QImage image = QImage::fromData(imageFileData);
-        const int exifOrientation =
-            getExifOrientation(imageFileData.constData(), imageFileData.size());
-        if (exifOrientation) {
-            applyTransformation(exifOrientation, image);
+        // a thumbnail that isn't cached yet is shown by onThumbnailReady
+        const QPixmap thumbnail = ThumbnailCache::getInstance().getThumbnail(filename, size);
+        if (!thumbnail.isNull()) {
+            onThumbnailReady(filename, thumbnail);
         }
+    }
+}
 
-        const QPixmap iconPixmap = scaleCropIntoSquare(QPixmap::fromImage(image), size);
+bool FileTransferWidget::eventFilter(QObject* object, QEvent* event)
+{
+    if (object != ui->previewButton || event->type() != QEvent::ToolTip
+        || !ui->previewButton->toolTip().isEmpty()) {
+        return QWidget::eventFilter(object, event);
+    }
 
-        ui->previewButton->setIcon(QIcon(iconPixmap));
-        ui->previewButton->setIconSize(iconPixmap.size());
-        ui->previewButton->show();
-        // Show mouseover preview, but make sure it's not larger than 50% of the screen
-        // width/height
+    // The mouseover preview is only created when first needed, and shown by onPreviewReady
+    if (!previewRequested) {
+        previewRequested = true;
+        // Make sure it's not larger than 50% of the screen width/height
         const QRect desktopSize = QApplication::desktop()->screenGeometry();
-        const int maxPreviewWidth{desktopSize.width() / 2};
-        const int maxPreviewHeight{desktopSize.height() / 2};
-        const QImage previewImage = [&image, maxPreviewWidth, maxPreviewHeight]() {
-            if (image.width() > maxPreviewWidth || image.height() > maxPreviewHeight) {
-                return image.scaled(maxPreviewWidth, maxPreviewHeight, Qt::KeepAspectRatio,
-                                    Qt::SmoothTransformation);
-            } else {
-                return image;
-            }
-        }();
-
-        QByteArray imageData;
-        QBuffer buffer(&imageData);
-        buffer.open(QIODevice::WriteOnly);
-        previewImage.save(&buffer, "PNG");
-        buffer.close();
-        ui->previewButton->setToolTip("<img src=data:image/png;base64," + imageData.toBase64() + "/>");
+        const QSize maxPreviewSize{desktopSize.width() / 2, desktopSize.height() / 2};
+        ThumbnailCache::getInstance().requestPreview(previewPath, maxPreviewSize);
     }
-}
 
-void FileTransferWidget::onLeftButtonClicked()
-{
-    handleButton(ui->leftButton);
+    return true;
 }
 
-void FileTransferWidget::onRightButtonClicked()
+void FileTransferWidget::onThumbnailReady(const QString& path, const QPixmap& thumbnail)
 {
-    handleButton(ui->rightButton);
-}
+    if (path != previewPath) {
+        return;
+    }
 
-void FileTransferWidget::onPreviewButtonClicked()
-{
-    handleButton(ui->previewButton);
+    ui->previewButton->setIcon(QIcon(thumbnail));
+    ui->previewButton->setIconSize(thumbnail.size());
+    ui->previewButton->show();
 }
 
-QPixmap FileTransferWidget::scaleCropIntoSquare(const QPixmap& source, const int targetSize)
+void FileTransferWidget::onPreviewReady(const QString& path, const QString& html)
 {
-    QPixmap result;
-
-    // Make sure smaller-than-icon images (at least one dimension is smaller) will not be
-    // upscaled
-    if (source.width() < targetSize || source.height() < targetSize) {
-        result = source;
-    } else {
-        result = source.scaled(targetSize, targetSize, Qt::KeepAspectRatioByExpanding,
-                               Qt::SmoothTransformation);
+    if (path != previewPath || html.isEmpty()) {
+        return;
     }
 
-    // Then, image has to be cropped (if needed) so it will not overflow rectangle
-    // Only one dimension will be bigger after Qt::KeepAspectRatioByExpanding
-    if (result.width() > targetSize) {
-        return result.copy((result.width() - targetSize) / 2, 0, targetSize, targetSize);
-    } else if (result.height() > targetSize) {
-        return result.copy(0, (result.height() - targetSize) / 2, targetSize, targetSize);
+    ui->previewButton->setToolTip(html);
+    if (ui->previewButton->underMouse()) {
+        QToolTip::showText(QCursor::pos(), html, ui->previewButton);
     }
-
-    // Picture was rectangle in the first place, no cropping
-    return result;
 }
 
-int FileTransferWidget::getExifOrientation(const char* data, const int size)
+void FileTransferWidget::onLeftButtonClicked()
 {
-    ExifData* exifData = exif_data_new_from_data(reinterpret_cast<const unsigned char*>(data), size);
-
-    if (!exifData) {
-        return 0;
-    }
+    handleButton(ui->leftButton);
+}
 
-    int orientation = 0;
-    const ExifByteOrder byteOrder = exif_data_get_byte_order(exifData);
-    const ExifEntry* const exifEntry = exif_data_get_entry(exifData, EXIF_TAG_ORIENTATION);
-    if (exifEntry) {
-        orientation = exif_get_short(exifEntry->data, byteOrder);
-    }
-    exif_data_free(exifData);
-    return orientation;
+void FileTransferWidget::onRightButtonClicked()
+{
+    handleButton(ui->rightButton);
 }
 
-void FileTransferWidget::applyTransformation(const int orientation, QImage& image)
+void FileTransferWidget::onPreviewButtonClicked()
 {
-    QTransform exifTransform;
-    switch (static_cast<ExifOrientation>(orientation)) {
-    case ExifOrientation::TopLeft:
-        break;
-    case ExifOrientation::TopRight:
-        image = image.mirrored(1, 0);
-        break;
-    case ExifOrientation::BottomRight:
-        exifTransform.rotate(180);
-        break;
-    case ExifOrientation::BottomLeft:
-        image = image.mirrored(0, 1);
-        break;
-    case ExifOrientation::LeftTop:
-        exifTransform.rotate(90);
-        image = image.mirrored(0, 1);
-        break;
-    case ExifOrientation::RightTop:
-        exifTransform.rotate(-90);
-        break;
-    case ExifOrientation::RightBottom:
-        exifTransform.rotate(-90);
-        image = image.mirrored(0, 1);
-        break;
-    case ExifOrientation::LeftBottom:
-        exifTransform.rotate(90);
-        break;
-    default:
-        qWarning() << "Invalid exif orientation passed to applyTransformation!";
-    }
-    image = image.transformed(exifTransform);
+    handleButton(ui->previewButton);
 }
 
 void FileTransferWidget::updateWidget(ToxFile const& file)
@@ -735,6 +707,12 @@ void FileTransferWidget::updateWidget(ToxFile const& file)
         return;
     }
 
+    // resuming a broken transfer changes its number
+    if (fileInfo.fileNum != file.fileNum) {
+        FileTransferRegistry::getInstance().unsubscribe(fileInfo.friendId, fileInfo.fileNum, this);
+        FileTransferRegistry::getInstance().subscribe(file.friendId, file.fileNum, this);
+    }
+
     fileInfo = file;
 
     // If we repainted on every packet our gui would be *very* slow
@@ -749,6 +727,10 @@ void FileTransferWidget::updateWidget(ToxFile const& file)
 
     lastStatus = file.status;
 
+    if (file.status == ToxFile::FINISHED || file.status == ToxFile::CANCELED) {
+        FileTransferRegistry::getInstance().unsubscribe(file.friendId, file.fileNum, this);
+    }
+
     // trigger repaint
     switch (file.status) {
     case ToxFile::TRANSMITTING:
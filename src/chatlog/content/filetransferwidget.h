@@ -44,9 +44,10 @@ public:
     virtual ~FileTransferWidget();
     void autoAcceptTransfer(const QString& path);
     bool isActive() const;
+    void onFileTransferProgress(const ToxFileProgressInfo& progress);
 
 protected slots:
-    void onFileTransferInfo(ToxFile file);
+    void onFileTransferOffered(ToxFile file);
     void onFileTransferAccepted(ToxFile file);
     void onFileTransferCancelled(ToxFile file);
     void onFileTransferPaused(ToxFile file);
@@ -72,16 +73,16 @@ protected:
     bool drawButtonAreaNeeded() const;
 
     virtual void paintEvent(QPaintEvent*) final override;
+    bool eventFilter(QObject* object, QEvent* event) override;
 
 private slots:
     void onLeftButtonClicked();
     void onRightButtonClicked();
     void onPreviewButtonClicked();
+    void onThumbnailReady(const QString& path, const QPixmap& thumbnail);
+    void onPreviewReady(const QString& path, const QString& html);
 
 private:
-    static QPixmap scaleCropIntoSquare(const QPixmap& source, int targetSize);
-    static int getExifOrientation(const char* data, const int size);
-    static void applyTransformation(const int oritentation, QImage& image);
     static bool tryRemoveFile(const QString &filepath);
 
     void updateWidget(ToxFile const& file);
@@ -98,25 +99,8 @@ private:
 
     bool active;
     ToxFile::FileStatus lastStatus = ToxFile::INITIALIZING;
-
-    enum class ExifOrientation
-    {
-        /* do not change values, this is exif spec
-         *
-         * name corresponds to where the 0 row and 0 column is in form row-column
-         * i.e. entry 5 here means that the 0'th row corresponds to the left side of the scene and
-         * the 0'th column corresponds to the top of the captured scene. This means that the image
-         * needs to be mirrored and rotated to be displayed.
-         */
-        TopLeft = 1,
-        TopRight = 2,
-        BottomRight = 3,
-        BottomLeft = 4,
-        LeftTop = 5,
-        RightTop = 6,
-        RightBottom = 7,
-        LeftBottom = 8
-    };
+    QString previewPath;
+    bool previewRequested = false;
 };
 
 #endif // FILETRANSFERWIDGET_H
@@ -0,0 +1,69 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filetransferregistry.h"
+
+#include "src/chatlog/content/filetransferwidget.h"
+
+/**
+ * @class FileTransferRegistry
+ * @brief Routes file transfer progress to the widgets showing that transfer.
+ *
+ * Core reports progress through a single connection to this registry, instead of every
+ * FileTransferWidget in every chat log receiving the progress of all transfers. Only accessed
+ * from the GUI thread.
+ */
+
+/**
+ * @brief Returns the singleton instance.
+ */
+FileTransferRegistry& FileTransferRegistry::getInstance()
+{
+    static FileTransferRegistry* registry = new FileTransferRegistry;
+    return *registry;
+}
+
+/**
+ * @brief Deliver the progress of a transfer to a widget, until unsubscribed.
+ */
+void FileTransferRegistry::subscribe(uint32_t friendId, uint32_t fileNum, FileTransferWidget* widget)
+{
+    const uint64_t key = getKey(friendId, fileNum);
+    if (!subscribers.contains(key, widget)) {
+        subscribers.insert(key, widget);
+    }
+}
+
+void FileTransferRegistry::unsubscribe(uint32_t friendId, uint32_t fileNum,
+                                       FileTransferWidget* widget)
+{
+    subscribers.remove(getKey(friendId, fileNum), widget);
+}
+
+void FileTransferRegistry::onFileTransferProgress(ToxFileProgressInfo progress)
+{
+    for (FileTransferWidget* widget : subscribers.values(getKey(progress.friendId, progress.fileNum))) {
+        widget->onFileTransferProgress(progress);
+    }
+}
+
+uint64_t FileTransferRegistry::getKey(uint32_t friendId, uint32_t fileNum)
+{
+    return (static_cast<uint64_t>(friendId) << 32) + fileNum;
+}
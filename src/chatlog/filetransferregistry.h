@@ -0,0 +1,50 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILETRANSFERREGISTRY_H
+#define FILETRANSFERREGISTRY_H
+
+#include "src/core/toxfile.h"
+
+#include <QMultiHash>
+#include <QObject>
+
+class FileTransferWidget;
+
+class FileTransferRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    static FileTransferRegistry& getInstance();
+
+    void subscribe(uint32_t friendId, uint32_t fileNum, FileTransferWidget* widget);
+    void unsubscribe(uint32_t friendId, uint32_t fileNum, FileTransferWidget* widget);
+
+public slots:
+    void onFileTransferProgress(ToxFileProgressInfo progress);
+
+private:
+    FileTransferRegistry() = default;
+    static uint64_t getKey(uint32_t friendId, uint32_t fileNum);
+
+private:
+    QMultiHash<uint64_t, FileTransferWidget*> subscribers;
+};
+
+#endif // FILETRANSFERREGISTRY_H
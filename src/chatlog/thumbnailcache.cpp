@@ -0,0 +1,336 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "thumbnailcache.h"
+
+#include <libexif/exif-loader.h>
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QTransform>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+// enough for the EXIF segment, which is at most 64 KiB
+const qint64 EXIF_HEADER_SIZE = 64 * 1024;
+// memory cache size in KiB
+const int MEMORY_CACHE_SIZE = 16 * 1024;
+// the oldest thumbnails are deleted when the disk cache grows beyond this size
+const qint64 DISK_CACHE_SIZE = 64 * 1024 * 1024;
+// thumbnails created between checks of the disk cache size
+const int PRUNE_INTERVAL = 64;
+} // namespace
+
+/**
+ * @class ThumbnailCache
+ * @brief Creates the previews of images shown by file transfers, on a worker thread.
+ *
+ * Images are decoded at the size they are shown in, and rotated according to their EXIF
+ * orientation. Thumbnails are kept in memory and in the cache folder of the profile, keyed by
+ * the path, modification time, size of the file and the thumbnail size. The profile sets the
+ * folder, encrypted profiles only keep thumbnails in memory. The folder is limited to
+ * DISK_CACHE_SIZE, the oldest thumbnails are deleted first. The larger tooltip previews are only
+ * created on request and not cached.
+ *
+ * Must only be used from the GUI thread, results are delivered by signals.
+ */
+
+ThumbnailCache::ThumbnailCache()
+{
+    thumbnails.setMaxCost(MEMORY_CACHE_SIZE);
+}
+
+/**
+ * @brief Returns the singleton instance.
+ */
+ThumbnailCache& ThumbnailCache::getInstance()
+{
+    static ThumbnailCache instance;
+    return instance;
+}
+
+/**
+ * @brief Set the folder thumbnails are stored in, forgetting the thumbnails kept in memory.
+ * @param dir Folder ending with a separator, empty to keep thumbnails in memory only.
+ */
+void ThumbnailCache::setCacheDir(const QString& dir)
+{
+    thumbnails.clear();
+    cacheDir = dir;
+    storedSincePrune = 0;
+    if (!cacheDir.isEmpty() && !pruneJob.isRunning()) {
+        pruneJob = QtConcurrent::run(&ThumbnailCache::pruneDiskCache, cacheDir);
+    }
+}
+
+/**
+ * @brief Get the square thumbnail of an image.
+ * @param path Image file.
+ * @param size Width and height of the thumbnail.
+ * @return The thumbnail if it's in memory, a null pixmap otherwise. It's loaded or created in the
+ * background then and delivered by thumbnailReady.
+ */
+QPixmap ThumbnailCache::getThumbnail(const QString& path, int size)
+{
+    const QString key = getKey(path, size);
+    if (QPixmap* cached = thumbnails.object(key)) {
+        return *cached;
+    }
+
+    if (pending.contains(key)) {
+        return QPixmap{};
+    }
+
+    pending.insert(key);
+    const QString dir = cacheDir;
+    QtConcurrent::run([this, path, key, size, dir] {
+        const QString cacheFile = dir + key + ".png";
+        QImage image;
+        if (!dir.isEmpty() && QFile::exists(cacheFile)) {
+            image.load(cacheFile);
+        }
+
+        bool stored = false;
+        if (image.isNull()) {
+            const QSize bounds{size, size};
+            image = scaleCropIntoSquare(loadImage(path, bounds, Qt::KeepAspectRatioByExpanding),
+                                        size);
+            if (!image.isNull() && !dir.isEmpty()) {
+                stored = QDir{}.mkpath(dir) && image.save(cacheFile, "PNG");
+                if (!stored) {
+                    qWarning() << "Can't store thumbnail" << cacheFile;
+                }
+            }
+        }
+
+        QMetaObject::invokeMethod(this, "onThumbnailLoaded", Qt::QueuedConnection,
+                                  Q_ARG(QString, path), Q_ARG(QString, key), Q_ARG(QImage, image),
+                                  Q_ARG(bool, stored));
+    });
+
+    return QPixmap{};
+}
+
+/**
+ * @brief Create a preview of an image for a tooltip in the background.
+ * @param path Image file.
+ * @param maxSize The preview is scaled down to fit into this size.
+ *
+ * The result is delivered as HTML by previewReady, empty if the image can't be loaded.
+ */
+void ThumbnailCache::requestPreview(const QString& path, const QSize& maxSize)
+{
+    QtConcurrent::run([this, path, maxSize] {
+        const QImage image = loadImage(path, maxSize, Qt::KeepAspectRatio);
+        QString html;
+        if (!image.isNull()) {
+            QByteArray imageData;
+            QBuffer buffer(&imageData);
+            buffer.open(QIODevice::WriteOnly);
+            image.save(&buffer, "PNG");
+            buffer.close();
+            html = "<img src=data:image/png;base64," + imageData.toBase64() + "/>";
+        }
+
+        QMetaObject::invokeMethod(this, "previewReady", Qt::QueuedConnection,
+                                  Q_ARG(QString, path), Q_ARG(QString, html));
+    });
+}
+
+/**
+ * @brief Decode an image at about the size it's shown in.
+ * @param path Image file.
+ * @param size Size to scale the image to, after applying the EXIF orientation.
+ * @param mode Qt::KeepAspectRatio to fit the image into size, Qt::KeepAspectRatioByExpanding to
+ * cover it. Images that are smaller already aren't scaled up.
+ * @return The image, null if it can't be read.
+ */
+QImage ThumbnailCache::loadImage(const QString& path, const QSize& size, Qt::AspectRatioMode mode)
+{
+    QImageReader reader{path};
+    const int orientation = getExifOrientation(path);
+    // the image is stored rotated by 90 degrees for these
+    const bool transposed = orientation >= static_cast<int>(ExifOrientation::LeftTop);
+    const QSize bounds = transposed ? size.transposed() : size;
+
+    const QSize imageSize = reader.size();
+    if (imageSize.isValid()) {
+        const bool larger =
+            mode == Qt::KeepAspectRatioByExpanding
+                ? imageSize.width() >= bounds.width() && imageSize.height() >= bounds.height()
+                : imageSize.width() > bounds.width() || imageSize.height() > bounds.height();
+        if (larger) {
+            // the decoder only produces the pixels needed for that size
+            reader.setScaledSize(imageSize.scaled(bounds, mode));
+        }
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qDebug() << "Can't load image" << path << reader.errorString();
+        return image;
+    }
+
+    if (orientation) {
+        applyTransformation(orientation, image);
+    }
+
+    return image;
+}
+
+/**
+ * @brief Scale an image to cover a square and crop what doesn't fit.
+ */
+QImage ThumbnailCache::scaleCropIntoSquare(const QImage& source, const int targetSize)
+{
+    QImage result;
+
+    // Make sure smaller-than-icon images (at least one dimension is smaller) will not be
+    // upscaled
+    if (source.width() < targetSize || source.height() < targetSize) {
+        result = source;
+    } else {
+        result = source.scaled(targetSize, targetSize, Qt::KeepAspectRatioByExpanding,
+                               Qt::SmoothTransformation);
+    }
+
+    // Then, image has to be cropped (if needed) so it will not overflow rectangle
+    // Only one dimension will be bigger after Qt::KeepAspectRatioByExpanding
+    if (result.width() > targetSize) {
+        return result.copy((result.width() - targetSize) / 2, 0, targetSize, targetSize);
+    } else if (result.height() > targetSize) {
+        return result.copy(0, (result.height() - targetSize) / 2, targetSize, targetSize);
+    }
+
+    // Picture was rectangle in the first place, no cropping
+    return result;
+}
+
+void ThumbnailCache::onThumbnailLoaded(const QString& path, const QString& key,
+                                       const QImage& image, bool stored)
+{
+    pending.remove(key);
+    if (stored && ++storedSincePrune >= PRUNE_INTERVAL && !pruneJob.isRunning()) {
+        storedSincePrune = 0;
+        pruneJob = QtConcurrent::run(&ThumbnailCache::pruneDiskCache, cacheDir);
+    }
+
+    if (image.isNull()) {
+        return;
+    }
+
+    const QPixmap thumbnail = QPixmap::fromImage(image);
+    const int cost = qMax(1, image.width() * image.height() * 4 / 1024);
+    thumbnails.insert(key, new QPixmap{thumbnail}, cost);
+    emit thumbnailReady(path, thumbnail);
+}
+
+/**
+ * @brief Delete the oldest thumbnails of a cache folder until it fits into DISK_CACHE_SIZE.
+ */
+void ThumbnailCache::pruneDiskCache(const QString& dir)
+{
+    // newest first
+    const QFileInfoList files =
+        QDir{dir}.entryInfoList(QStringList{"*.png"}, QDir::Files, QDir::Time);
+    qint64 total = 0;
+    for (const QFileInfo& file : files) {
+        total += file.size();
+        if (total > DISK_CACHE_SIZE && !QFile::remove(file.absoluteFilePath())) {
+            qWarning() << "Can't remove thumbnail" << file.absoluteFilePath();
+        }
+    }
+}
+
+QString ThumbnailCache::getKey(const QString& path, int size)
+{
+    const QFileInfo info{path};
+    const QString key = QString("%1\n%2\n%3\n%4")
+                            .arg(info.absoluteFilePath())
+                            .arg(info.lastModified().toMSecsSinceEpoch())
+                            .arg(info.size())
+                            .arg(size);
+    return QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha256).toHex();
+}
+
+int ThumbnailCache::getExifOrientation(const QString& path)
+{
+    QFile file{path};
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    const QByteArray header = file.read(EXIF_HEADER_SIZE);
+    ExifData* exifData =
+        exif_data_new_from_data(reinterpret_cast<const unsigned char*>(header.constData()),
+                                static_cast<unsigned int>(header.size()));
+
+    if (!exifData) {
+        return 0;
+    }
+
+    int orientation = 0;
+    const ExifByteOrder byteOrder = exif_data_get_byte_order(exifData);
+    const ExifEntry* const exifEntry = exif_data_get_entry(exifData, EXIF_TAG_ORIENTATION);
+    if (exifEntry) {
+        orientation = exif_get_short(exifEntry->data, byteOrder);
+    }
+    exif_data_free(exifData);
+    return orientation;
+}
+
+void ThumbnailCache::applyTransformation(const int orientation, QImage& image)
+{
+    QTransform exifTransform;
+    switch (static_cast<ExifOrientation>(orientation)) {
+    case ExifOrientation::TopLeft:
+        break;
+    case ExifOrientation::TopRight:
+        image = image.mirrored(1, 0);
+        break;
+    case ExifOrientation::BottomRight:
+        exifTransform.rotate(180);
+        break;
+    case ExifOrientation::BottomLeft:
+        image = image.mirrored(0, 1);
+        break;
+    case ExifOrientation::LeftTop:
+        exifTransform.rotate(90);
+        image = image.mirrored(0, 1);
+        break;
+    case ExifOrientation::RightTop:
+        exifTransform.rotate(-90);
+        break;
+    case ExifOrientation::RightBottom:
+        exifTransform.rotate(-90);
+        image = image.mirrored(0, 1);
+        break;
+    case ExifOrientation::LeftBottom:
+        exifTransform.rotate(90);
+        break;
+    default:
+        qWarning() << "Invalid exif orientation passed to applyTransformation!";
+    }
+    image = image.transformed(exifTransform);
+}
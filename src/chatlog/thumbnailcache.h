@@ -0,0 +1,90 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QCache>
+#include <QFuture>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QString>
+
+class ThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ThumbnailCache& getInstance();
+
+    void setCacheDir(const QString& dir);
+    QPixmap getThumbnail(const QString& path, int size);
+    void requestPreview(const QString& path, const QSize& maxSize);
+
+    static QImage loadImage(const QString& path, const QSize& size, Qt::AspectRatioMode mode);
+    static QImage scaleCropIntoSquare(const QImage& source, int targetSize);
+
+signals:
+    void thumbnailReady(const QString& path, const QPixmap& thumbnail);
+    void previewReady(const QString& path, const QString& html);
+
+private slots:
+    void onThumbnailLoaded(const QString& path, const QString& key, const QImage& image,
+                           bool stored);
+
+private:
+    ThumbnailCache();
+    ThumbnailCache(ThumbnailCache&) = delete;
+    ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+    static QString getKey(const QString& path, int size);
+    static void pruneDiskCache(const QString& dir);
+    static int getExifOrientation(const QString& path);
+    static void applyTransformation(int orientation, QImage& image);
+
+private:
+    QCache<QString, QPixmap> thumbnails;
+    QSet<QString> pending;
+    QString cacheDir;
+    int storedSincePrune = 0;
+    QFuture<void> pruneJob;
+
+    enum class ExifOrientation
+    {
+        /* do not change values, this is exif spec
+         *
+         * name corresponds to where the 0 row and 0 column is in form row-column
+         * i.e. entry 5 here means that the 0'th row corresponds to the left side of the scene and
+         * the 0'th column corresponds to the top of the captured scene. This means that the image
+         * needs to be mirrored and rotated to be displayed.
+         */
+        TopLeft = 1,
+        TopRight = 2,
+        BottomRight = 3,
+        BottomLeft = 4,
+        LeftTop = 5,
+        RightTop = 6,
+        RightBottom = 7,
+        LeftBottom = 8
+    };
+};
+
+#endif // THUMBNAILCACHE_H
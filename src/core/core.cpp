@@ -30,11 +30,13 @@
 #include "src/persistence/profile.h"
 
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QRegularExpression>
 #include <QString>
 #include <QStringBuilder>
 #include <QTimer>
 
+#include <atomic>
 #include <cassert>
 #include <memory>
 
@@ -44,6 +46,16 @@ const QString Core::TOX_EXT = ".tox";
 
 #define ASSERT_CORE_THREAD assert(QThread::currentThread() == coreThread.get())
 
+// after this long without queued work or file transfers, the loop timer may be coalesced by the OS
+#define CORE_IDLE_TIMEOUT_MS 1000
+
+// messages handed to toxcore per friend and iteration, and the iteration interval while more wait
+#define CORE_MESSAGES_PER_ITERATION 4
+#define CORE_MESSAGE_PACING_MS 10
+
+// the disconnect tolerance counts connection checks, they run at most this often
+#define CORE_CONNECTION_CHECK_MS 50
+
 namespace {
     bool LogConferenceTitleError(TOX_ERR_CONFERENCE_TITLE error)
     {
@@ -70,6 +82,8 @@ Core::Core(QThread* coreThread)
     , toxTimer{new QTimer{this}}
     , coreLoopLock(new QMutex(QMutex::Recursive))
     , coreThread(coreThread)
+    , selfState{std::make_shared<const SelfState>()}
+    , fileTransfers{std::make_shared<const FileTransfers>()}
 {
     assert(toxTimer);
     toxTimer->setSingleShot(true);
@@ -79,6 +93,8 @@ Core::Core(QThread* coreThread)
 
 Core::~Core()
 {
+    qDebug() << "Core loop:" << loopStats.toString();
+
     // need to reset av first, because it uses tox
     av.reset();
 
@@ -239,6 +255,7 @@ ToxCorePtr Core::makeToxCore(const QByteArray& savedata, const ICoreSettings* co
     }
 
     registerCallbacks(core->tox.get());
+    core->updateSelfState();
 
     // connect the thread with the Core
     connect(thread, &QThread::started, core.get(), &Core::onStarted);
@@ -271,6 +288,7 @@ void Core::onStarted()
 
     loadFriends();
     loadGroups();
+    CoreFile::loadResumableFiles(this);
 
     process(); // starts its own timer
     av->start();
@@ -315,6 +333,10 @@ CoreAV* Core::getAv()
 
 /**
  * @brief Processes toxcore events and ensure we stay connected, called by its own timer
+ *
+ * Also runs early when requestIteration() was called for queued outbound work. Early iterations
+ * don't postpone the scheduled one, and the connection is checked at a fixed interval no matter
+ * what triggered the iteration, so they don't change the disconnect tolerance either.
  */
 void Core::process()
 {
@@ -322,27 +344,163 @@ void Core::process()
 
     ASSERT_CORE_THREAD;
 
+    const bool woken = iterationRequested.exchange(false);
+    if (woken) {
+        lastActivity.start();
+    }
+
+    QElapsedTimer iterationTimer;
+    iterationTimer.start();
+
     static int tolerance = CORE_DISCONNECT_TOLERANCE;
     tox_iterate(tox.get(), this);
 
+    const QHash<uint32_t, QVector<int>> receipts = messageQueue.takeReadReceipts();
+    for (auto it = receipts.constBegin(); it != receipts.constEnd(); ++it) {
+        emit receiptsReceived(it.key(), it.value());
+    }
+
+    sendQueuedMessages();
+    CoreFile::processIO(this);
+    updateFileTransfers();
+
 #ifdef DEBUG
     // we want to see the debug messages immediately
     fflush(stdout);
 #endif
 
     // TODO(sudden6): recheck if this is still necessary
-    if (checkConnection()) {
-        tolerance = CORE_DISCONNECT_TOLERANCE;
-    } else if (!(--tolerance)) {
-        bootstrapDht();
-        tolerance = 3 * CORE_DISCONNECT_TOLERANCE;
+    if (!lastConnectionCheck.isValid()
+        || lastConnectionCheck.elapsed() >= CORE_CONNECTION_CHECK_MS) {
+        lastConnectionCheck.start();
+        if (checkConnection()) {
+            tolerance = CORE_DISCONNECT_TOLERANCE;
+        } else if (!(--tolerance)) {
+            bootstrapDht();
+            tolerance = 3 * CORE_DISCONNECT_TOLERANCE;
+        }
+    }
+
+    const unsigned sleeptime = nextIterationInterval();
+    loopStats.addIteration(static_cast<uint64_t>(iterationTimer.nsecsElapsed() / 1000), sleeptime,
+                           woken);
+
+    // keep the scheduled iteration if it comes first anyway
+    if (woken && toxTimer->isActive()
+        && toxTimer->remainingTime() <= static_cast<int>(sleeptime)) {
+        return;
     }
 
-    unsigned sleeptime =
-        qMin(tox_iteration_interval(tox.get()), CoreFile::corefileIterationInterval());
+    // the timer type only changes on the next start
+    toxTimer->stop();
+    const bool idle = !lastActivity.isValid() || lastActivity.elapsed() > CORE_IDLE_TIMEOUT_MS;
+    toxTimer->setTimerType(idle ? Qt::CoarseTimer : Qt::PreciseTimer);
     toxTimer->start(sleeptime);
 }
 
+/**
+ * @brief Time until toxcore needs to be iterated again.
+ * @return Milliseconds to sleep, shorter while files are transmitted or messages are queued.
+ */
+unsigned Core::nextIterationInterval()
+{
+    unsigned interval = tox_iteration_interval(tox.get());
+    const unsigned fileInterval = CoreFile::corefileIterationInterval();
+    if (fileInterval < interval) {
+        lastActivity.start();
+        interval = fileInterval;
+    }
+
+    if (interval > CORE_MESSAGE_PACING_MS
+        && messageQueue.hasSendable(QDateTime::currentMSecsSinceEpoch())) {
+        lastActivity.start();
+        interval = CORE_MESSAGE_PACING_MS;
+    }
+
+    return interval;
+}
+
+/**
+ * @brief Hand queued messages to toxcore.
+ *
+ * Sends at most CORE_MESSAGES_PER_ITERATION messages per friend, so a long backlog, e.g. offline
+ * messages delivered on reconnect, is spread over several iterations. When the toxcore send
+ * queue is full the friend's messages are retried in the next iteration.
+ */
+void Core::sendQueuedMessages()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (uint32_t friendId : messageQueue.getSendableFriends(now)) {
+        OutgoingMessageQueue::Message message;
+        for (int i = 0; i < CORE_MESSAGES_PER_ITERATION && messageQueue.peek(friendId, now, message);
+             ++i) {
+            const Tox_Message_Type type =
+                message.isAction ? TOX_MESSAGE_TYPE_ACTION : TOX_MESSAGE_TYPE_NORMAL;
+            ToxString cMessage(message.text);
+            Tox_Err_Friend_Send_Message error;
+            const uint32_t messageId = tox_friend_send_message(tox.get(), friendId, type,
+                                                               cMessage.data(), cMessage.size(),
+                                                               &error);
+            if (error == TOX_ERR_FRIEND_SEND_MESSAGE_SENDQ) {
+                break;
+            }
+
+            if (error != TOX_ERR_FRIEND_SEND_MESSAGE_OK) {
+                qWarning() << "Failed to send message to friend" << friendId << "error:" << error;
+                messageQueue.dropFront(friendId);
+                emit messageSentResult(friendId, message.text, 0);
+                continue;
+            }
+
+            messageQueue.markSent(friendId, messageId, now);
+            emit messageSentResult(friendId, message.text, message.receipt);
+        }
+    }
+}
+
+/**
+ * @brief Iterate toxcore as soon as possible, instead of waiting for the loop timer.
+ *
+ * Called after queueing outbound work like messages or file chunks, so it is sent without
+ * waiting for the next scheduled iteration. Requests before the iteration runs are coalesced.
+ * Can be called from any thread.
+ */
+void Core::requestIteration() const
+{
+    if (!iterationRequested.exchange(true)) {
+        QMetaObject::invokeMethod(const_cast<Core*>(this), "process", Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief Statistics about the toxcore event loop iterations.
+ */
+const CoreLoopStats& Core::getLoopStats() const
+{
+    return loopStats;
+}
+
+/**
+ * @brief Find a running or broken file transfer, e.g. to attach it to its history entry.
+ * @param friendId Friend the file is transferred with.
+ * @param fileId File ID as stored in the history.
+ * @param file Set to the transfer if found.
+ * @return True if the transfer was found.
+ *
+ * Doesn't lock the tox thread, the transfers are copied at the end of every iteration.
+ */
+bool Core::findFileTransfer(uint32_t friendId, const QString& fileId, ToxFile& file) const
+{
+    const auto transfers = std::atomic_load(&fileTransfers);
+    const auto it = transfers->constFind(fileId);
+    if (it == transfers->constEnd() || it->friendId != friendId) {
+        return false;
+    }
+
+    file = *it;
+    return true;
+}
+
 bool Core::checkConnection()
 {
     ASSERT_CORE_THREAD;
@@ -461,10 +619,13 @@ void Core::onConnectionStatusChanged(Tox*, uint32_t friendId, Tox_Connection sta
     // Ignore Online because it will be emited from onUserStatusChanged
     bool isOffline = friendStatus == Status::Offline;
     if (isOffline) {
+        // toxcore drops unsent messages, they are resent as offline messages on reconnect
+        static_cast<Core*>(core)->messageQueue.clearFriend(friendId);
         emit static_cast<Core*>(core)->friendStatusChanged(friendId, friendStatus);
         static_cast<Core*>(core)->checkLastOnline(friendId);
-        CoreFile::onConnectionStatusChanged(static_cast<Core*>(core), friendId, !isOffline);
     }
+
+    CoreFile::onConnectionStatusChanged(static_cast<Core*>(core), friendId, !isOffline);
 }
 
 void Core::onGroupInvite(Tox* tox, uint32_t friendId, Tox_Conference_Type type,
@@ -501,6 +662,7 @@ void Core::onGroupMessage(Tox*, uint32_t groupId, uint32_t peerId, Tox_Message_T
 void Core::onGroupPeerListChange(Tox*, uint32_t groupId, void* vCore)
 {
     const auto core = static_cast<Core*>(vCore);
+    core->updateGroupPeers(groupId);
     if (core->getGroupAvEnabled(groupId)) {
         CoreAV::invalidateGroupCallSources(groupId);
     }
@@ -514,7 +676,12 @@ void Core::onGroupPeerNameChange(Tox*, uint32_t groupId, uint32_t peerId, const
 {
     const auto newName = ToxString(name, length).getQString();
     qDebug() << QString("Group %1, Peer %2, name changed to %3").arg(groupId).arg(peerId).arg(newName);
-    emit static_cast<Core*>(core)->groupPeerNameChanged(groupId, peerId, newName);
+    const auto c = static_cast<Core*>(core);
+    if (!c->groupPeers.setPeerName(groupId, peerId, newName)) {
+        c->updateGroupPeers(groupId);
+    }
+
+    emit c->groupPeerNameChanged(groupId, peerId, newName);
 }
 
 void Core::onGroupTitleChange(Tox*, uint32_t groupId, uint32_t peerId, const uint8_t* cTitle,
@@ -527,7 +694,7 @@ void Core::onGroupTitleChange(Tox*, uint32_t groupId, uint32_t peerId, const uin
 
 void Core::onReadReceiptCallback(Tox*, uint32_t friendId, uint32_t receipt, void* core)
 {
-    emit static_cast<Core*>(core)->receiptRecieved(friendId, receipt);
+    static_cast<Core*>(core)->messageQueue.addReadReceipt(friendId, receipt);
 }
 
 void Core::acceptFriendRequest(const ToxPk& friendPk)
@@ -600,23 +767,30 @@ void Core::requestFriendship(const ToxId& friendId, const QString& message)
     emit saveRequest();
 }
 
+/**
+ * @brief Queue a message for a friend.
+ * @param friendId Friend to send the message to.
+ * @param message Message text, must not exceed tox_max_message_length().
+ * @return Receipt reported by receiptsReceived once the friend received the message.
+ *
+ * The message is sent from the Core thread, messageSentResult reports the outcome.
+ */
 int Core::sendMessage(uint32_t friendId, const QString& message)
 {
     QMutexLocker ml(coreLoopLock.get());
-    ToxString cMessage(message);
-    int receipt = tox_friend_send_message(tox.get(), friendId, TOX_MESSAGE_TYPE_NORMAL,
-                                          cMessage.data(), cMessage.size(), nullptr);
-    emit messageSentResult(friendId, message, receipt);
+    int receipt = messageQueue.enqueue(friendId, message, false);
+    requestIteration();
     return receipt;
 }
 
+/**
+ * @brief Queue an action for a friend, see sendMessage.
+ */
 int Core::sendAction(uint32_t friendId, const QString& action)
 {
     QMutexLocker ml(coreLoopLock.get());
-    ToxString cMessage(action);
-    int receipt = tox_friend_send_message(tox.get(), friendId, TOX_MESSAGE_TYPE_ACTION,
-                                          cMessage.data(), cMessage.size(), nullptr);
-    emit messageSentResult(friendId, action, receipt);
+    int receipt = messageQueue.enqueue(friendId, action, true);
+    requestIteration();
     return receipt;
 }
 
@@ -626,7 +800,10 @@ void Core::sendTyping(uint32_t friendId, bool typing)
 
     if (!tox_self_set_typing(tox.get(), friendId, typing, nullptr)) {
         emit failedToSetTyping(typing);
+        return;
     }
+
+    requestIteration();
 }
 
 bool parseConferenceSendMessageError(Tox_Err_Conference_Send_Message  error)
@@ -673,6 +850,8 @@ void Core::sendGroupMessageWithType(int groupId, const QString& message, Tox_Mes
             return;
         }
     }
+
+    requestIteration();
 }
 
 void Core::sendGroupMessage(int groupId, const QString& message)
@@ -697,6 +876,7 @@ void Core::changeGroupTitle(int groupId, const QString& title)
     Tox_Err_Conference_Title error;
     bool success = tox_conference_set_title(tox.get(), groupId, cTitle.data(), cTitle.size(), &error);
     if (success && error == TOX_ERR_CONFERENCE_TITLE_OK) {
+        requestIteration();
         emit groupTitleChanged(groupId, getUsername(), title);
         return;
     }
@@ -727,6 +907,18 @@ void Core::sendFile(uint32_t friendId, QString filename, QString filePath, long
     CoreFile::sendFile(this, friendId, filename, filePath, filesize);
 }
 
+/**
+ * @brief Stop all file transfers, storing them to be resumed in the next session.
+ *
+ * Call before saving the profile settings on exit.
+ */
+void Core::suspendFileTransfers()
+{
+    QMutexLocker ml{coreLoopLock.get()};
+
+    CoreFile::suspendTransfers(this);
+}
+
 void Core::sendAvatarFile(uint32_t friendId, const QByteArray& data)
 {
     QMutexLocker ml{coreLoopLock.get()};
@@ -734,6 +926,17 @@ void Core::sendAvatarFile(uint32_t friendId, const QByteArray& data)
     CoreFile::sendAvatarFile(this, friendId, data);
 }
 
+/**
+ * @brief Cancel our running avatar transfer to a friend, without emitting avatarSendFinished.
+ * @param friendId Friend the avatar is sent to.
+ */
+void Core::cancelAvatarSend(uint32_t friendId)
+{
+    QMutexLocker ml{coreLoopLock.get()};
+
+    CoreFile::cancelAvatarSend(this, friendId);
+}
+
 void Core::pauseResumeFile(uint32_t friendId, uint32_t fileNum)
 {
     QMutexLocker ml{coreLoopLock.get()};
@@ -782,6 +985,7 @@ void Core::removeFriend(uint32_t friendId, bool fake)
         return;
     }
 
+    messageQueue.clearFriend(friendId);
     emit saveRequest();
     emit friendRemoved(friendId);
 }
@@ -797,6 +1001,7 @@ void Core::removeGroup(int groupId, bool fake)
     Tox_Err_Conference_Delete error;
     bool success = tox_conference_delete(tox.get(), groupId, &error);
     if (success && error == TOX_ERR_CONFERENCE_DELETE_OK) {
+        groupPeers.removeGroup(groupId);
         av->leaveGroupCall(groupId);
         return;
     }
@@ -817,19 +1022,7 @@ void Core::removeGroup(int groupId, bool fake)
  */
 QString Core::getUsername() const
 {
-    QMutexLocker ml{coreLoopLock.get()};
-
-    QString sname;
-    if (!tox) {
-        return sname;
-    }
-
-    int size = tox_self_get_name_size(tox.get());
-    uint8_t* name = new uint8_t[size];
-    tox_self_get_name(tox.get(), name);
-    sname = ToxString(name, size).getQString();
-    delete[] name;
-    return sname;
+    return std::atomic_load(&selfState)->username;
 }
 
 void Core::setUsername(const QString& username)
@@ -846,6 +1039,8 @@ void Core::setUsername(const QString& username)
         return;
     }
 
+    updateSelfState();
+    requestIteration();
     emit usernameSet(username);
     emit saveRequest();
 }
@@ -855,11 +1050,7 @@ void Core::setUsername(const QString& username)
  */
 ToxId Core::getSelfId() const
 {
-    QMutexLocker ml{coreLoopLock.get()};
-
-    uint8_t friendId[TOX_ADDRESS_SIZE] = {0x00};
-    tox_self_get_address(tox.get(), friendId);
-    return ToxId(friendId, TOX_ADDRESS_SIZE);
+    return std::atomic_load(&selfState)->id;
 }
 
 /**
@@ -868,11 +1059,7 @@ ToxId Core::getSelfId() const
  */
 ToxPk Core::getSelfPublicKey() const
 {
-    QMutexLocker ml{coreLoopLock.get()};
-
-    uint8_t friendId[TOX_ADDRESS_SIZE] = {0x00};
-    tox_self_get_address(tox.get(), friendId);
-    return ToxPk(friendId);
+    return std::atomic_load(&selfState)->id.getPublicKey();
 }
 
 /**
@@ -901,29 +1088,57 @@ QPair<QByteArray, QByteArray> Core::getKeypair() const
  */
 QString Core::getStatusMessage() const
 {
-    QMutexLocker ml{coreLoopLock.get()};
+    return std::atomic_load(&selfState)->statusMessage;
+}
 
-    QString sname;
-    if (!tox) {
-        return sname;
+/**
+ * @brief Returns our user status
+ */
+Status Core::getStatus() const
+{
+    return std::atomic_load(&selfState)->status;
+}
+
+/**
+ * @brief Copy the resumable file transfers for findFileTransfer.
+ * @note Must be called with coreLoopLock held.
+ */
+void Core::updateFileTransfers()
+{
+    FileTransfers transfers = CoreFile::getResumableTransfers();
+    // nothing to publish while no files are transferred
+    if (transfers.isEmpty() && std::atomic_load(&fileTransfers)->isEmpty()) {
+        return;
     }
 
-    size_t size = tox_self_get_status_message_size(tox.get());
-    uint8_t* name = new uint8_t[size];
-    tox_self_get_status_message(tox.get(), name);
-    sname = ToxString(name, size).getQString();
-    delete[] name;
-    return sname;
+    std::atomic_store(&fileTransfers, std::make_shared<const FileTransfers>(std::move(transfers)));
 }
 
 /**
- * @brief Returns our user status
+ * @brief Copy our name, status message, status and Tox ID for the lock free getters.
+ * @note Must be called with coreLoopLock held after any of them changed.
  */
-Status Core::getStatus() const
+void Core::updateSelfState()
 {
-    QMutexLocker ml{coreLoopLock.get()};
+    auto state = std::make_shared<SelfState>();
+
+    size_t size = tox_self_get_name_size(tox.get());
+    QByteArray name(static_cast<int>(size), Qt::Uninitialized);
+    tox_self_get_name(tox.get(), reinterpret_cast<uint8_t*>(name.data()));
+    state->username = ToxString(name).getQString();
+
+    size = tox_self_get_status_message_size(tox.get());
+    QByteArray message(static_cast<int>(size), Qt::Uninitialized);
+    tox_self_get_status_message(tox.get(), reinterpret_cast<uint8_t*>(message.data()));
+    state->statusMessage = ToxString(message).getQString();
+
+    state->status = static_cast<Status>(tox_self_get_status(tox.get()));
+
+    uint8_t address[TOX_ADDRESS_SIZE] = {0x00};
+    tox_self_get_address(tox.get(), address);
+    state->id = ToxId(address, TOX_ADDRESS_SIZE);
 
-    return static_cast<Status>(tox_self_get_status(tox.get()));
+    std::atomic_store(&selfState, std::shared_ptr<const SelfState>{std::move(state)});
 }
 
 void Core::setStatusMessage(const QString& message)
@@ -940,6 +1155,8 @@ void Core::setStatusMessage(const QString& message)
         return;
     }
 
+    updateSelfState();
+    requestIteration();
     emit saveRequest();
     emit statusMessageSet(message);
 }
@@ -968,6 +1185,8 @@ void Core::setStatus(Status status)
     }
 
     tox_self_set_status(tox.get(), userstatus);
+    updateSelfState();
+    requestIteration();
     emit saveRequest();
     emit statusSet(status);
 }
@@ -1048,6 +1267,7 @@ void Core::loadGroups()
         if (LogConferenceTitleError(error)) {
             continue;
         }
+        updateGroupPeers(groupIds[i]);
         emit emptyGroupCreated(static_cast<int>(groupIds[i]), ToxString(name).getQString());
     }
 
@@ -1112,15 +1332,11 @@ bool Core::parsePeerQueryError(Tox_Err_Conference_Peer_Query error) const
  */
 uint32_t Core::getGroupNumberPeers(int groupId) const
 {
-    QMutexLocker ml{coreLoopLock.get()};
-
-    Tox_Err_Conference_Peer_Query error;
-    uint32_t count = tox_conference_peer_count(tox.get(), groupId, &error);
-    if (!parsePeerQueryError(error)) {
+    if (!groupPeers.hasGroup(groupId)) {
         return std::numeric_limits<uint32_t>::max();
     }
 
-    return count;
+    return static_cast<uint32_t>(groupPeers.getPeers(groupId)->size());
 }
 
 /**
@@ -1128,23 +1344,13 @@ uint32_t Core::getGroupNumberPeers(int groupId) const
  */
 QString Core::getGroupPeerName(int groupId, int peerId) const
 {
-    QMutexLocker ml{coreLoopLock.get()};
-
-    Tox_Err_Conference_Peer_Query error;
-    size_t length = tox_conference_peer_get_name_size(tox.get(), groupId, peerId, &error);
-    if (!parsePeerQueryError(error)) {
-        return QString{};
-    }
-
-    QByteArray name(length, Qt::Uninitialized);
-    uint8_t* namePtr = reinterpret_cast<uint8_t*>(name.data());
-    bool success = tox_conference_peer_get_name(tox.get(), groupId, peerId, namePtr, &error);
-    if (!parsePeerQueryError(error) || !success) {
-        qWarning() << "getGroupPeerName: Unknown error";
+    const GroupPeerTable::PeersPtr peers = groupPeers.getPeers(groupId);
+    if (peerId < 0 || peerId >= peers->size()) {
+        qWarning() << "getGroupPeerName: Unknown peer" << peerId << "in group" << groupId;
         return QString{};
     }
 
-    return ToxString(name).getQString();
+    return peers->at(peerId).name;
 }
 
 /**
@@ -1152,17 +1358,13 @@ QString Core::getGroupPeerName(int groupId, int peerId) const
  */
 ToxPk Core::getGroupPeerPk(int groupId, int peerId) const
 {
-    QMutexLocker ml{coreLoopLock.get()};
-
-    uint8_t friendPk[TOX_PUBLIC_KEY_SIZE] = {0x00};
-    Tox_Err_Conference_Peer_Query error;
-    bool success = tox_conference_peer_get_public_key(tox.get(), groupId, peerId, friendPk, &error);
-    if (!parsePeerQueryError(error) || !success) {
-        qWarning() << "getGroupPeerToxId: Unknown error";
+    const GroupPeerTable::PeersPtr peers = groupPeers.getPeers(groupId);
+    if (peerId < 0 || peerId >= peers->size()) {
+        qWarning() << "getGroupPeerPk: Unknown peer" << peerId << "in group" << groupId;
         return ToxPk{};
     }
 
-    return ToxPk(friendPk);
+    return peers->at(peerId).pk;
 }
 
 /**
@@ -1170,46 +1372,74 @@ ToxPk Core::getGroupPeerPk(int groupId, int peerId) const
  */
 QStringList Core::getGroupPeerNames(int groupId) const
 {
-    QMutexLocker ml{coreLoopLock.get()};
-
-    if (!tox) {
-        qWarning() << "Can't get group peer names, tox is null";
-        return {};
+    const GroupPeerTable::PeersPtr peers = groupPeers.getPeers(groupId);
+    QStringList names;
+    names.reserve(peers->size());
+    for (const GroupPeer& peer : *peers) {
+        names.append(peer.name);
     }
 
-    uint32_t nPeers = getGroupNumberPeers(groupId);
-    if (nPeers == std::numeric_limits<uint32_t>::max()) {
-        qWarning() << "getGroupPeerNames: Unable to get number of peers";
-        return {};
-    }
+    return names;
+}
+
+/**
+ * @brief Get a snapshot of the peers of a group.
+ * @return Peers indexed by peer number, as of the last peer list or name change.
+ *
+ * Doesn't lock the tox thread, the snapshot stays valid while it is referenced.
+ */
+GroupPeerTable::PeersPtr Core::getGroupPeers(int groupId) const
+{
+    return groupPeers.getPeers(groupId);
+}
 
+/**
+ * @brief Query toxcore for the peers of a group and publish them to the peer table.
+ * @param groupId Conference number.
+ *
+ * Peers that kept their number and public key keep their cached name, names of the others are
+ * queried once here. Must be called with coreLoopLock held.
+ */
+void Core::updateGroupPeers(uint32_t groupId)
+{
     Tox_Err_Conference_Peer_Query error;
-    uint32_t count = tox_conference_peer_count(tox.get(), groupId, &error);
+    const uint32_t count = tox_conference_peer_count(tox.get(), groupId, &error);
     if (!parsePeerQueryError(error)) {
-        return {};
+        groupPeers.removeGroup(groupId);
+        return;
     }
 
-    if (count != nPeers) {
-        qWarning() << "getGroupPeerNames: Unexpected peer count";
-        return {};
-    }
+    const GroupPeerTable::PeersPtr oldPeers = groupPeers.getPeers(groupId);
+    GroupPeerTable::Peers peers;
+    peers.reserve(static_cast<int>(count));
+    for (uint32_t i = 0; i < count; ++i) {
+        uint8_t peerPk[TOX_PUBLIC_KEY_SIZE] = {0x00};
+        bool success = tox_conference_peer_get_public_key(tox.get(), groupId, i, peerPk, &error);
+        if (!parsePeerQueryError(error) || !success) {
+            qWarning() << "updateGroupPeers: Unknown error";
+        }
 
-    QStringList names;
-    for (uint32_t i = 0; i < nPeers; ++i) {
-        size_t length = tox_conference_peer_get_name_size(tox.get(), groupId, i, &error);
-        if (!parsePeerQueryError(error)) {
+        GroupPeer peer{ToxPk(peerPk), QString{}, i};
+        if (i < static_cast<uint32_t>(oldPeers->size()) && oldPeers->at(i).pk == peer.pk) {
+            peer.name = oldPeers->at(i).name;
+            peers.append(peer);
             continue;
         }
 
-        QByteArray name(length, Qt::Uninitialized);
-        uint8_t* namePtr = reinterpret_cast<uint8_t*>(name.data());
-        bool ok = tox_conference_peer_get_name(tox.get(), groupId, i, namePtr, &error);
-        if (ok && parsePeerQueryError(error)) {
-            names.append(ToxString(name).getQString());
+        size_t length = tox_conference_peer_get_name_size(tox.get(), groupId, i, &error);
+        if (parsePeerQueryError(error)) {
+            QByteArray name(length, Qt::Uninitialized);
+            uint8_t* namePtr = reinterpret_cast<uint8_t*>(name.data());
+            success = tox_conference_peer_get_name(tox.get(), groupId, i, namePtr, &error);
+            if (parsePeerQueryError(error) && success) {
+                peer.name = ToxString(name).getQString();
+            }
         }
+
+        peers.append(peer);
     }
 
-    return names;
+    groupPeers.setPeers(groupId, std::move(peers));
 }
 
 /**
@@ -1283,7 +1513,7 @@ bool Core::parseConferenceJoinError(Tox_Err_Conference_Join error) const
  *
  * @return Conference number on success, UINT32_MAX on failure.
  */
-uint32_t Core::joinGroupchat(const GroupInvite& inviteInfo) const
+uint32_t Core::joinGroupchat(const GroupInvite& inviteInfo)
 {
     QMutexLocker ml{coreLoopLock.get()};
 
@@ -1297,13 +1527,23 @@ uint32_t Core::joinGroupchat(const GroupInvite& inviteInfo) const
         qDebug() << QString("Trying to join text groupchat invite sent by friend %1").arg(friendId);
         Tox_Err_Conference_Join error;
         uint32_t groupId = tox_conference_join(tox.get(), friendId, cookie, cookieLength, &error);
-        return parseConferenceJoinError(error) ? groupId : std::numeric_limits<uint32_t>::max();
+        if (!parseConferenceJoinError(error)) {
+            return std::numeric_limits<uint32_t>::max();
+        }
+
+        updateGroupPeers(groupId);
+        return groupId;
     }
 
     case TOX_CONFERENCE_TYPE_AV: {
         qDebug() << QString("Trying to join AV groupchat invite sent by friend %1").arg(friendId);
-        return toxav_join_av_groupchat(tox.get(), friendId, cookie, cookieLength,
-                                       CoreAV::groupCallCallback, const_cast<Core*>(this));
+        uint32_t groupId = toxav_join_av_groupchat(tox.get(), friendId, cookie, cookieLength,
+                                                   CoreAV::groupCallCallback, this);
+        if (groupId != std::numeric_limits<uint32_t>::max()) {
+            updateGroupPeers(groupId);
+        }
+
+        return groupId;
     }
 
     default:
@@ -1347,6 +1587,7 @@ int Core::createGroup(uint8_t type)
 
         switch (error) {
         case TOX_ERR_CONFERENCE_NEW_OK:
+            updateGroupPeers(groupId);
             emit emptyGroupCreated(groupId);
             return groupId;
 
@@ -1359,6 +1600,7 @@ int Core::createGroup(uint8_t type)
         }
     } else if (type == TOX_CONFERENCE_TYPE_AV) {
         uint32_t groupId = toxav_add_av_groupchat(tox.get(), CoreAV::groupCallCallback, this);
+        updateGroupPeers(groupId);
         emit emptyGroupCreated(groupId);
         return groupId;
     } else {
@@ -1507,5 +1749,6 @@ void Core::setNospam(uint32_t nospam)
     QMutexLocker ml{coreLoopLock.get()};
 
     tox_self_set_nospam(tox.get(), nospam);
+    updateSelfState();
     emit idSet(getSelfId());
 }
@@ -24,14 +24,19 @@
 #include "toxfile.h"
 #include "toxid.h"
 
+#include "src/core/coreloopstats.h"
 #include "src/core/dhtserver.h"
+#include "src/core/grouppeertable.h"
+#include "src/core/outgoingmessagequeue.h"
 #include <tox/tox.h>
 
+#include <QElapsedTimer>
 #include <QMutex>
 #include <QObject>
 #include <QThread>
 #include <QTimer>
 
+#include <atomic>
 #include <functional>
 #include <memory>
 
@@ -81,13 +86,14 @@ public:
     QString getGroupPeerName(int groupId, int peerId) const;
     ToxPk getGroupPeerPk(int groupId, int peerId) const;
     QStringList getGroupPeerNames(int groupId) const;
+    GroupPeerTable::PeersPtr getGroupPeers(int groupId) const;
     bool getGroupAvEnabled(int groupId) const;
     ToxPk getFriendPublicKey(uint32_t friendNumber) const;
     QString getFriendUsername(uint32_t friendNumber) const;
 
     bool isFriendOnline(uint32_t friendId) const;
     bool hasFriendWithPublicKey(const ToxPk& publicKey) const;
-    uint32_t joinGroupchat(const GroupInvite& inviteInfo) const;
+    uint32_t joinGroupchat(const GroupInvite& inviteInfo);
     void quitGroupChat(int groupId) const;
 
     QString getUsername() const;
@@ -98,6 +104,8 @@ public:
     QPair<QByteArray, QByteArray> getKeypair() const;
 
     bool isReady() const;
+    const CoreLoopStats& getLoopStats() const;
+    bool findFileTransfer(uint32_t friendId, const QString& fileId, ToxFile& file) const;
 
     void sendFile(uint32_t friendId, QString filename, QString filePath, long long filesize);
 
@@ -126,11 +134,13 @@ public slots:
     void sendTyping(uint32_t friendId, bool typing);
 
     void sendAvatarFile(uint32_t friendId, const QByteArray& data);
+    void cancelAvatarSend(uint32_t friendId);
     void cancelFileSend(uint32_t friendId, uint32_t fileNum);
     void cancelFileRecv(uint32_t friendId, uint32_t fileNum);
     void rejectFileRecvRequest(uint32_t friendId, uint32_t fileNum);
     void acceptFileRecvRequest(uint32_t friendId, uint32_t fileNum, QString path);
     void pauseResumeFile(uint32_t friendId, uint32_t fileNum);
+    void suspendFileTransfers();
 
     void setNospam(uint32_t nospam);
 
@@ -158,6 +168,7 @@ signals:
     void avReady();
 
     void fileSendStarted(ToxFile file);
+    void fileTransferOffered(ToxFile file);
     void fileReceiveRequested(ToxFile file);
     void fileTransferAccepted(ToxFile file);
     void fileTransferCancelled(ToxFile file);
@@ -165,7 +176,7 @@ signals:
     void fileUploadFinished(const QString& path);
     void fileDownloadFinished(const QString& path);
     void fileTransferPaused(ToxFile file);
-    void fileTransferInfo(ToxFile file);
+    void fileTransferProgress(ToxFileProgressInfo progress);
     void fileTransferRemotePausedUnpaused(ToxFile file, bool paused);
     void fileTransferBrokenUnbroken(ToxFile file, bool broken);
     void fileNameChanged(const ToxPk& friendPk);
@@ -177,6 +188,7 @@ signals:
      */
 
     void fileAvatarOfferReceived(uint32_t friendId, uint32_t fileId, const QByteArray& avatarHash);
+    void avatarSendFinished(uint32_t friendId, bool delivered);
 
     void friendMessageReceived(uint32_t friendId, const QString& message, bool isAction);
     void friendAdded(uint32_t friendId, const ToxPk& friendPk);
@@ -202,7 +214,7 @@ signals:
     void groupSentFailed(int groupId);
     void actionSentResult(uint32_t friendId, const QString& action, int success);
 
-    void receiptRecieved(int friedId, int receipt);
+    void receiptsReceived(uint32_t friendId, const QVector<int>& receipts);
 
     void failedToRemoveFriend(uint32_t friendId);
 
@@ -237,8 +249,14 @@ private:
 
     void sendGroupMessageWithType(int groupId, const QString& message, Tox_Message_Type type);
     bool parsePeerQueryError(Tox_Err_Conference_Peer_Query error) const;
+    void updateGroupPeers(uint32_t groupId);
     bool parseConferenceJoinError(Tox_Err_Conference_Join error) const;
     bool checkConnection();
+    unsigned nextIterationInterval();
+    void sendQueuedMessages();
+    void requestIteration() const;
+    void updateSelfState();
+    void updateFileTransfers();
 
     void checkEncryptedHistory();
     void makeTox(QByteArray savedata, ICoreSettings* s);
@@ -257,6 +275,17 @@ private slots:
     void onStarted();
 
 private:
+    struct SelfState
+    {
+        QString username;
+        QString statusMessage;
+        Status status = Status::Online;
+        ToxId id;
+    };
+
+    // running and broken file transfers by file ID, see findFileTransfer
+    using FileTransfers = QHash<QString, ToxFile>;
+
     struct ToxDeleter
     {
         void operator()(Tox* tox)
@@ -275,6 +304,17 @@ private:
     std::unique_ptr<QMutex> coreLoopLock = nullptr;
 
     std::unique_ptr<QThread> coreThread = nullptr;
+    QElapsedTimer lastActivity;
+    QElapsedTimer lastConnectionCheck;
+    mutable std::atomic<bool> iterationRequested{false};
+    CoreLoopStats loopStats;
+
+    // written with coreLoopLock held, read without locking
+    std::shared_ptr<const SelfState> selfState;
+    std::shared_ptr<const FileTransfers> fileTransfers;
+    GroupPeerTable groupPeers;
+
+    OutgoingMessageQueue messageQueue;
     QList<DhtServer> bootstrapNodes{};
 
     friend class Audio;    ///< Audio can access our calls directly to reduce latency
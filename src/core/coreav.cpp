@@ -26,6 +26,7 @@
 #include "src/persistence/settings.h"
 #include "src/video/corevideosource.h"
 #include "src/video/videoframe.h"
+#include "src/video/videostats.h"
 #include <QCoreApplication>
 #include <QDebug>
 #include <QThread>
@@ -418,6 +419,7 @@ void CoreAV::sendCallVideo(uint32_t callId, std::shared_ptr<VideoFrame> vframe)
     // We don't want to be dropping iframes because of some lock held by toxav_iterate
     TOXAV_ERR_SEND_FRAME err;
     int retries = 0;
+    const qint64 submitStart = VideoStats::now();
     do {
         if (!toxav_video_send_frame(toxav.get(), callId, frame.width, frame.height, frame.y, frame.u,
                                     frame.v, &err)) {
@@ -431,6 +433,10 @@ void CoreAV::sendCallVideo(uint32_t callId, std::shared_ptr<VideoFrame> vframe)
     } while (err == TOXAV_ERR_SEND_FRAME_SYNC && retries < 5);
     if (err == TOXAV_ERR_SEND_FRAME_SYNC) {
         qDebug() << "toxav_video_send_frame error: Lock busy, dropping frame";
+    } else {
+        const qint64 submitEnd = VideoStats::now();
+        VideoStats::record(VideoStats::Stage::EncodeSubmit, submitEnd - submitStart);
+        vframe->setStageTime(VideoStats::Stage::EncodeSubmit, submitEnd);
     }
 }
 
@@ -481,7 +487,7 @@ void CoreAV::groupCallCallback(void* tox, uint32_t group, uint32_t peer, const i
     const ToxPk peerPk = c->getGroupPeerPk(group, peer);
     const Settings& s = Settings::getInstance();
     // don't play the audio if it comes from a muted peer
-    if (s.getBlackList().contains(peerPk.toString())) {
+    if (s.isPeerMuted(peerPk)) {
         return;
     }
 
@@ -500,12 +506,11 @@ void CoreAV::groupCallCallback(void* tox, uint32_t group, uint32_t peer, const i
         return;
     }
 
-    Audio& audio = Audio::getInstance();
     if(!call.havePeer(peer)) {
         call.addPeer(peer);
     }
 
-    audio.playAudioBuffer(call.getAlSource(peer), data, samples, channels, sample_rate);
+    call.playPeerAudio(peer, data, samples, channels, sample_rate);
 }
 
 /**
@@ -684,21 +689,6 @@ bool CoreAV::isCallOutputMuted(const Friend* f) const
     return (it != calls.end()) && it->second.getMuteVol();
 }
 
-/**
- * @brief Forces to regenerate each call's audio sources.
- */
-void CoreAV::invalidateCallSources()
-{
-    for (auto& kv : groupCalls) {
-        kv.second.clearPeers();
-    }
-
-    for (auto& kv : calls) {
-        // TODO: this is wrong, "0" is a valid source id
-        kv.second.setAlSource(0);
-    }
-}
-
 /**
  * @brief Signal to all peers that we're not sending video anymore.
  * @note The next frame sent cancels this.
@@ -890,14 +880,7 @@ void CoreAV::audioFrameCallback(ToxAV*, uint32_t friendNum, const int16_t* pcm,
         return;
     }
 
-    Audio& audio = Audio::getInstance();
-    if (!call.getAlSource()) {
-        quint32 sourceId;
-        audio.subscribeOutput(sourceId);
-        call.setAlSource(sourceId);
-    }
-
-    audio.playAudioBuffer(call.getAlSource(), pcm, sampleCount, channels, samplingRate);
+    call.playAudio(pcm, sampleCount, channels, samplingRate);
 }
 
 void CoreAV::videoFrameCallback(ToxAV*, uint32_t friendNum, uint16_t w, uint16_t h,
@@ -20,26 +20,46 @@
 
 #include "corefile.h"
 #include "core.h"
+#include "filetransferio.h"
 #include "toxfile.h"
 #include "toxstring.h"
 #include "src/persistence/profile.h"
 #include "src/persistence/settings.h"
+#include <QDateTime>
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QRegularExpression>
 #include <QThread>
+#include <limits>
 #include <memory>
+#include <sodium/randombytes.h>
 
 /**
  * @class CoreFile
  * @brief Implements Core's file transfer callbacks.
  *
  * Avoids polluting core.h with private internal callbacks.
+ *
+ * Transfers that break off because the friend went offline are kept with their 32 byte file ID.
+ * Outgoing ones are offered again with the same file ID once the friend is back, incoming ones
+ * are resumed after the data received so far was verified against its hash. The broken
+ * transfers are stored in the profile settings, so they survive a restart.
+ *
+ * Outgoing data transfers are queued by a TransferScheduler and only offered to the friend once
+ * it allows them to start, they keep the file ID they got when queued.
  */
 
 QMutex CoreFile::fileSendMutex;
 QHash<uint64_t, ToxFile> CoreFile::fileMap;
+QHash<uint64_t, QQueue<CoreFile::ChunkRequest>> CoreFile::chunkRequests;
+QList<ToxFile> CoreFile::finishingFiles;
+QByteArray CoreFile::chunkBuffer;
+QList<CoreFile::BrokenFile> CoreFile::brokenFiles;
+QHash<uint64_t, CoreFile::ResumingFile> CoreFile::resumingFiles;
+uint32_t CoreFile::nextLocalFileNum = std::numeric_limits<uint32_t>::max();
+TransferScheduler CoreFile::scheduler;
 using namespace std;
 
 /**
@@ -58,6 +78,10 @@ unsigned CoreFile::corefileIterationInterval()
     */
     constexpr unsigned fileInterval = 10, idleInterval = 1000;
 
+    if (!chunkRequests.isEmpty() || !finishingFiles.isEmpty() || !resumingFiles.isEmpty()) {
+        return fileInterval;
+    }
+
     for (ToxFile& file : fileMap) {
         if (file.status == ToxFile::TRANSMITTING) {
             return fileInterval;
@@ -66,12 +90,33 @@ unsigned CoreFile::corefileIterationInterval()
     return idleInterval;
 }
 
+/**
+ * @brief Report the progress of a transfer, at most 10 times per second.
+ *
+ * The end of a transfer is reported by fileTransferFinished, so skipped updates don't matter.
+ */
+void CoreFile::reportProgress(Core* core, ToxFile& file)
+{
+    constexpr qint64 progressInterval = 100;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now - file.lastProgressUpdate < progressInterval) {
+        return;
+    }
+
+    file.lastProgressUpdate = now;
+    const quint64 rate = scheduler.getStats(file.friendId, file.fileNum).bytesPerSecond;
+    emit core->fileTransferProgress(
+        {file.friendId, file.fileNum, file.bytesSent, file.filesize, rate});
+}
+
 void CoreFile::sendAvatarFile(Core* core, uint32_t friendId, const QByteArray& data)
 {
     QMutexLocker mlocker(&fileSendMutex);
 
     if (data.isEmpty()) {
-        tox_file_send(core->tox.get(), friendId, TOX_FILE_KIND_AVATAR, 0, nullptr, nullptr, 0, nullptr);
+        const uint32_t fileNum = tox_file_send(core->tox.get(), friendId, TOX_FILE_KIND_AVATAR, 0,
+                                               nullptr, nullptr, 0, nullptr);
+        emit core->avatarSendFinished(friendId, fileNum != UINT32_MAX);
         return;
     }
 
@@ -89,20 +134,25 @@ void CoreFile::sendAvatarFile(Core* core, uint32_t friendId, const QByteArray& d
         break;
     case TOX_ERR_FILE_SEND_FRIEND_NOT_CONNECTED:
         qCritical() << "Friend not connected";
-        return;
+        break;
     case TOX_ERR_FILE_SEND_FRIEND_NOT_FOUND:
         qCritical() << "Friend not found";
-        return;
+        break;
     case TOX_ERR_FILE_SEND_NAME_TOO_LONG:
         qCritical() << "Name too long";
-        return;
+        break;
     case TOX_ERR_FILE_SEND_NULL:
         qCritical() << "Send null";
-        return;
+        break;
     case TOX_ERR_FILE_SEND_TOO_MANY:
         qCritical() << "To many ougoing transfer";
-        return;
+        break;
     default:
+        break;
+    }
+
+    if (error != TOX_ERR_FILE_SEND_OK) {
+        emit core->avatarSendFinished(friendId, false);
         return;
     }
 
@@ -114,6 +164,27 @@ void CoreFile::sendAvatarFile(Core* core, uint32_t friendId, const QByteArray& d
     tox_file_get_file_id(core->tox.get(), friendId, fileNum, (uint8_t*)file.resumeFileId.data(),
                          nullptr);
     addFile(friendId, fileNum, file);
+    core->requestIteration();
+}
+
+void CoreFile::cancelAvatarSend(Core* core, uint32_t friendId)
+{
+    QList<uint32_t> fileNums;
+    for (const ToxFile& file : fileMap) {
+        if (file.friendId == friendId && file.fileKind == TOX_FILE_KIND_AVATAR
+            && file.direction == ToxFile::SENDING) {
+            fileNums.append(file.fileNum);
+        }
+    }
+
+    for (uint32_t fileNum : fileNums) {
+        tox_file_control(core->tox.get(), friendId, fileNum, TOX_FILE_CONTROL_CANCEL, nullptr);
+        removeFile(friendId, fileNum);
+    }
+
+    if (!fileNums.isEmpty()) {
+        core->requestIteration();
+    }
 }
 
 void CoreFile::sendFile(Core* core, uint32_t friendId, QString filename, QString filePath,
@@ -121,28 +192,109 @@ void CoreFile::sendFile(Core* core, uint32_t friendId, QString filename, QString
 {
     QMutexLocker mlocker(&fileSendMutex);
     ToxString fileName(filename);
-    TOX_ERR_FILE_SEND sendErr;
-    uint32_t fileNum = tox_file_send(core->tox.get(), friendId, TOX_FILE_KIND_DATA, filesize,
-                                     nullptr, fileName.data(), fileName.size(), &sendErr);
-    if (sendErr != TOX_ERR_FILE_SEND_OK) {
-        qWarning() << "sendFile: Can't create the Tox file sender (" << sendErr << ")";
+    if (tox_friend_get_connection_status(core->tox.get(), friendId, nullptr)
+        == TOX_CONNECTION_NONE) {
+        qWarning() << "sendFile: Friend" << friendId << "is not connected";
         emit core->fileSendFailed(friendId, fileName.getQString());
         return;
     }
-    qDebug() << QString("sendFile: Created file sender %1 with friend %2").arg(fileNum).arg(friendId);
 
-    ToxFile file{fileNum, friendId, fileName.getQString(), filePath, ToxFile::SENDING};
+    ToxFile file{getLocalFileNum(), friendId, fileName.getQString(), filePath, ToxFile::SENDING};
     file.filesize = filesize;
-    file.resumeFileId.resize(TOX_FILE_ID_LENGTH);
-    tox_file_get_file_id(core->tox.get(), friendId, fileNum, (uint8_t*)file.resumeFileId.data(),
-                         nullptr);
-    if (!file.open(false)) {
-        qWarning() << QString("sendFile: Can't open file, error: %1").arg(file.file->errorString());
+    file.resumeFileId = createFileId();
+    queueFileSend(core, file);
+    qDebug() << QString("sendFile: Queued file %1 for friend %2, %3 waiting")
+                    .arg(file.fileNum)
+                    .arg(friendId)
+                    .arg(scheduler.getQueuedCount(friendId));
+
+    emit core->fileSendStarted(file);
+}
+
+/**
+ * @brief Create a random file ID for an outgoing transfer, before toxcore knows about it.
+ *
+ * Random like the IDs toxcore creates itself, so the receiver can't learn anything about the
+ * file or its path from it.
+ */
+QByteArray CoreFile::createFileId()
+{
+    QByteArray fileId(TOX_FILE_ID_LENGTH, Qt::Uninitialized);
+    randombytes_buf(fileId.data(), static_cast<size_t>(fileId.size()));
+    return fileId;
+}
+
+/**
+ * @brief Queue an outgoing transfer in the scheduler, its file is opened once it starts.
+ */
+void CoreFile::queueFileSend(Core* core, ToxFile& file)
+{
+    const Settings& s = Settings::getInstance();
+    scheduler.setMaxActive(s.getMaxFileTransfersPerFriend());
+    scheduler.setUploadLimit(static_cast<quint64>(qMax(0, s.getFileUploadRateLimit())) * 1024);
+
+    file.status = ToxFile::INITIALIZING;
+    addFile(file.friendId, file.fileNum, file);
+    scheduler.enqueue(file.friendId, file.fileNum, file.filesize);
+    core->requestIteration();
+}
+
+/**
+ * @brief Offer the queued transfers the scheduler allows to start to the friends.
+ */
+void CoreFile::startQueuedFiles(Core* core)
+{
+    for (uint32_t friendId : scheduler.getWaitingFriends()) {
+        uint32_t localNum;
+        while (scheduler.takeNext(friendId, localNum)) {
+            offerFile(core, friendId, localNum);
+        }
     }
+}
 
-    addFile(friendId, fileNum, file);
+/**
+ * @brief Open the file of a queued transfer and offer it to the friend.
+ */
+void CoreFile::offerFile(Core* core, uint32_t friendId, uint32_t localNum)
+{
+    const uint64_t localKey = getFriendKey(friendId, localNum);
+    if (!fileMap.contains(localKey)) {
+        return;
+    }
 
-    emit core->fileSendStarted(file);
+    ToxFile& queued = fileMap[localKey];
+    if (!queued.open(false) || static_cast<quint64>(queued.file->size()) != queued.filesize) {
+        qWarning() << "offerFile: File" << queued.filePath << "is gone or changed";
+        queued.status = ToxFile::CANCELED;
+        emit core->fileTransferCancelled(queued);
+        removeFile(friendId, localNum);
+        return;
+    }
+
+    ToxFile file = queued;
+
+    ToxString fileName(file.fileName);
+    Tox_Err_File_Send sendErr;
+    const uint32_t fileNum =
+        tox_file_send(core->tox.get(), friendId, TOX_FILE_KIND_DATA, file.filesize,
+                      reinterpret_cast<const uint8_t*>(file.resumeFileId.constData()),
+                      fileName.data(), fileName.size(), &sendErr);
+    if (sendErr != TOX_ERR_FILE_SEND_OK) {
+        qWarning() << "offerFile: Can't create the Tox file sender (" << sendErr << ")";
+        queued.status = ToxFile::CANCELED;
+        emit core->fileTransferCancelled(queued);
+        removeFile(friendId, localNum);
+        return;
+    }
+
+    qDebug() << QString("offerFile: Created file sender %1 with friend %2").arg(fileNum).arg(friendId);
+    // the receiver seeks first when resuming, that restarts reading there
+    file.io->startReading(0);
+    file.fileNum = fileNum;
+    fileMap.remove(localKey);
+    addFile(friendId, fileNum, file);
+    scheduler.start(friendId, fileNum, QDateTime::currentMSecsSinceEpoch());
+    emit core->fileTransferOffered(file);
 }
 
 void CoreFile::pauseResumeFile(Core* core, uint32_t friendId, uint32_t fileId)
@@ -175,10 +327,15 @@ void CoreFile::pauseResumeFile(Core* core, uint32_t friendId, uint32_t fileId)
         tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_RESUME,
                          nullptr);
     }
+    core->requestIteration();
 }
 
 void CoreFile::cancelFileSend(Core* core, uint32_t friendId, uint32_t fileId)
 {
+    if (cancelBrokenFile(core, friendId, fileId, ToxFile::SENDING)) {
+        return;
+    }
+
     ToxFile* file = findFile(friendId, fileId);
     if (!file) {
         qWarning("cancelFileSend: No such file in queue");
@@ -189,10 +346,15 @@ void CoreFile::cancelFileSend(Core* core, uint32_t friendId, uint32_t fileId)
     emit core->fileTransferCancelled(*file);
     tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_CANCEL, nullptr);
     removeFile(friendId, fileId);
+    core->requestIteration();
 }
 
 void CoreFile::cancelFileRecv(Core* core, uint32_t friendId, uint32_t fileId)
 {
+    if (cancelBrokenFile(core, friendId, fileId, ToxFile::RECEIVING)) {
+        return;
+    }
+
     ToxFile* file = findFile(friendId, fileId);
     if (!file) {
         qWarning("cancelFileRecv: No such file in queue");
@@ -202,6 +364,7 @@ void CoreFile::cancelFileRecv(Core* core, uint32_t friendId, uint32_t fileId)
     emit core->fileTransferCancelled(*file);
     tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_CANCEL, nullptr);
     removeFile(friendId, fileId);
+    core->requestIteration();
 }
 
 void CoreFile::rejectFileRecvRequest(Core* core, uint32_t friendId, uint32_t fileId)
@@ -215,6 +378,7 @@ void CoreFile::rejectFileRecvRequest(Core* core, uint32_t friendId, uint32_t fil
     emit core->fileTransferCancelled(*file);
     tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_CANCEL, nullptr);
     removeFile(friendId, fileId);
+    core->requestIteration();
 }
 
 void CoreFile::acceptFileRecvRequest(Core* core, uint32_t friendId, uint32_t fileId, QString path)
@@ -224,6 +388,11 @@ void CoreFile::acceptFileRecvRequest(Core* core, uint32_t friendId, uint32_t fil
         qWarning("acceptFileRecvRequest: No such file in queue");
         return;
     }
+    if (file->status != ToxFile::INITIALIZING) {
+        // resumed transfers are accepted already
+        qWarning("acceptFileRecvRequest: File is already accepted");
+        return;
+    }
     file->setFilePath(path);
     if (!file->open(true)) {
         qWarning() << "acceptFileRecvRequest: Unable to open file";
@@ -232,6 +401,7 @@ void CoreFile::acceptFileRecvRequest(Core* core, uint32_t friendId, uint32_t fil
     file->status = ToxFile::TRANSMITTING;
     emit core->fileTransferAccepted(*file);
     tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_RESUME, nullptr);
+    core->requestIteration();
 }
 
 ToxFile* CoreFile::findFile(uint32_t friendId, uint32_t fileId)
@@ -245,6 +415,30 @@ ToxFile* CoreFile::findFile(uint32_t friendId, uint32_t fileId)
     return nullptr;
 }
 
+/**
+ * @brief Get the running and broken transfers that can be attached to a history entry.
+ * @return Transfers keyed by their file ID, converted to a QString like the history does.
+ */
+QHash<QString, ToxFile> CoreFile::getResumableTransfers()
+{
+    QHash<QString, ToxFile> transfers;
+    auto add = [&transfers](const ToxFile& file) {
+        if (file.fileKind != TOX_FILE_KIND_AVATAR && !file.resumeFileId.isEmpty()) {
+            transfers.insert(QString::fromUtf8(file.resumeFileId), file);
+        }
+    };
+
+    for (const ToxFile& file : fileMap) {
+        add(file);
+    }
+
+    for (const BrokenFile& broken : brokenFiles) {
+        add(broken.file);
+    }
+
+    return transfers;
+}
+
 void CoreFile::addFile(uint32_t friendId, uint32_t fileId, const ToxFile& file)
 {
     uint64_t key = getFriendKey(friendId, fileId);
@@ -264,10 +458,154 @@ void CoreFile::removeFile(uint32_t friendId, uint32_t fileId)
         qWarning() << "removeFile: No such file in queue";
         return;
     }
-    fileMap[key].file->close();
+    const ToxFile& file = fileMap[key];
+    if (file.io) {
+        file.io->close();
+    } else {
+        file.file->close();
+    }
+
+    const TransferScheduler::Stats stats = scheduler.finish(friendId, fileId);
+    if (stats.bytes && file.fileKind != TOX_FILE_KIND_AVATAR) {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        const qint64 duration = qMax<qint64>(1, now - stats.startTime);
+        qDebug() << "removeFile: Transferred" << stats.bytes << "bytes of" << file.fileName << "in"
+                 << duration << "ms," << stats.bytes * 1000 / static_cast<quint64>(duration)
+                 << "B/s";
+    }
+
+    chunkRequests.remove(key);
+    resumingFiles.remove(key);
     fileMap.remove(key);
 }
 
+/**
+ * @brief Send file chunks and finish transfers once their file I/O is done.
+ *
+ * Called by Core after every iteration, chunks requested by toxcore before their data was read
+ * from disk are sent here.
+ */
+void CoreFile::processIO(Core* core)
+{
+    startQueuedFiles(core);
+
+    for (uint64_t key : resumingFiles.keys()) {
+        if (!fileMap.contains(key)) {
+            resumingFiles.remove(key);
+            continue;
+        }
+
+        ToxFile& file = fileMap[key];
+        if (file.io->isHashed()) {
+            finishResume(core, file, resumingFiles.take(key));
+        }
+    }
+
+    for (uint64_t key : chunkRequests.keys()) {
+        if (!fileMap.contains(key)) {
+            chunkRequests.remove(key);
+            continue;
+        }
+
+        while (chunkRequests.contains(key) && !chunkRequests[key].isEmpty()) {
+            const ChunkRequest request = chunkRequests[key].head();
+            const ChunkResult result =
+                sendFileChunk(core, fileMap[key], request.position, request.length);
+            if (result != ChunkResult::Sent) {
+                break;
+            }
+
+            chunkRequests[key].dequeue();
+        }
+
+        if (chunkRequests.contains(key) && chunkRequests[key].isEmpty()) {
+            chunkRequests.remove(key);
+        }
+    }
+
+    for (auto it = finishingFiles.begin(); it != finishingFiles.end();) {
+        if (!it->io->isClosed()) {
+            ++it;
+            continue;
+        }
+
+        if (it->io->hasError()) {
+            qWarning() << "processIO: File I/O failed for" << it->filePath;
+            it->status = ToxFile::CANCELED;
+            emit core->fileTransferCancelled(*it);
+        } else if (it->direction == ToxFile::SENDING) {
+            emit core->fileTransferFinished(*it);
+            emit core->fileUploadFinished(it->filePath);
+        } else {
+            emit core->fileTransferFinished(*it);
+            emit core->fileDownloadFinished(it->filePath);
+        }
+
+        it = finishingFiles.erase(it);
+    }
+
+    if (collectBrokenHashes(core)) {
+        saveResumableFiles(core);
+    }
+}
+
+/**
+ * @brief Send a file chunk requested by toxcore, if its data was already read from disk.
+ * @return Pending if the data isn't read yet, Failed if the transfer was cancelled.
+ */
+CoreFile::ChunkResult CoreFile::sendFileChunk(Core* core, ToxFile& file, uint64_t position,
+                                              size_t length)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (!scheduler.canSend(file.friendId, now)) {
+        // over the upload limit, sent by processIO later
+        return ChunkResult::Pending;
+    }
+
+    // memory mapped local files are sent without copying the chunk
+    const qint64 chunkLength = static_cast<qint64>(length);
+    const char* chunk = file.io ? file.io->mapped(position, chunkLength) : nullptr;
+    qint64 nread = chunkLength;
+    if (!chunk) {
+        if (static_cast<size_t>(chunkBuffer.size()) < length) {
+            chunkBuffer.resize(static_cast<int>(length));
+        }
+
+        nread = file.io ? file.io->read(position, chunkBuffer.data(), chunkLength) : -1;
+        chunk = chunkBuffer.constData();
+    }
+
+    if (nread == 0) {
+        return ChunkResult::Pending;
+    }
+
+    const uint32_t friendId = file.friendId;
+    const uint32_t fileId = file.fileNum;
+    Tox* tox = core->tox.get();
+    if (nread < 0) {
+        qWarning("sendFileChunk: Failed to read from file");
+        file.status = ToxFile::CANCELED;
+        emit core->fileTransferCancelled(file);
+        tox_file_send_chunk(tox, friendId, fileId, position, nullptr, 0, nullptr);
+        removeFile(friendId, fileId);
+        return ChunkResult::Failed;
+    }
+
+    // absolute, a resumed transfer starts where the receiver stopped
+    file.bytesSent = position + static_cast<uint64_t>(nread);
+    scheduler.addSent(friendId, fileId, static_cast<quint64>(nread), now);
+
+    if (!tox_file_send_chunk(tox, friendId, fileId, position,
+                             reinterpret_cast<const uint8_t*>(chunk), static_cast<size_t>(nread),
+                             nullptr)) {
+        qWarning("sendFileChunk: Failed to send data chunk");
+        return ChunkResult::Sent;
+    }
+
+    reportProgress(core, file);
+    return ChunkResult::Sent;
+}
+
 QString CoreFile::getCleanFileName(QString filename)
 {
     QRegularExpression regex{QStringLiteral(R"([<>:"/\\|?])")};
@@ -318,6 +656,10 @@ void CoreFile::onFileReceiveCallback(Tox*, uint32_t friendId, uint32_t fileId, u
     file.resumeFileId.resize(TOX_FILE_ID_LENGTH);
     tox_file_get_file_id(core->tox.get(), friendId, fileId, (uint8_t*)file.resumeFileId.data(),
                          nullptr);
+    if (resumeFileRecv(core, file)) {
+        return;
+    }
+
     addFile(friendId, fileId, file);
     if (kind != TOX_FILE_KIND_AVATAR)
         emit core->fileReceiveRequested(file);
@@ -367,6 +709,10 @@ void CoreFile::onFileControlCallback(Tox*, uint32_t friendId, uint32_t fileId,
             qDebug() << "File tranfer" << friendId << ":" << fileId << "cancelled by friend";
         file->status = ToxFile::CANCELED;
         emit static_cast<Core*>(core)->fileTransferCancelled(*file);
+        if (file->fileKind == TOX_FILE_KIND_AVATAR && file->direction == ToxFile::SENDING) {
+            // friends cancel avatars they already have
+            emit static_cast<Core*>(core)->avatarSendFinished(friendId, true);
+        }
         removeFile(friendId, fileId);
     } else if (control == TOX_FILE_CONTROL_PAUSE) {
         qDebug() << "onFileControlCallback: Received pause for file " << friendId << ":" << fileId;
@@ -400,41 +746,42 @@ void CoreFile::onFileDataCallback(Tox* tox, uint32_t friendId, uint32_t fileId,
     if (!length) {
         file->status = ToxFile::FINISHED;
         if (file->fileKind != TOX_FILE_KIND_AVATAR) {
-            emit static_cast<Core*>(core)->fileTransferFinished(*file);
-            emit static_cast<Core*>(core)->fileUploadFinished(file->filePath);
+            // reported by processIO once the file is hashed and closed
+            finishingFiles.append(*file);
+        } else {
+            emit static_cast<Core*>(core)->avatarSendFinished(friendId, true);
         }
         removeFile(friendId, fileId);
         return;
     }
 
-    unique_ptr<uint8_t[]> data(new uint8_t[length]);
-    int64_t nread;
-
     if (file->fileKind == TOX_FILE_KIND_AVATAR) {
-        QByteArray chunk = file->avatarData.mid(pos, length);
-        nread = chunk.size();
-        memcpy(data.get(), chunk.data(), nread);
-    } else {
-        file->file->seek(pos);
-        nread = file->file->read((char*)data.get(), length);
-        if (nread <= 0) {
-            qWarning("onFileDataCallback: Failed to read from file");
-            file->status = ToxFile::CANCELED;
-            emit static_cast<Core*>(core)->fileTransferCancelled(*file);
-            tox_file_send_chunk(tox, friendId, fileId, pos, nullptr, 0, nullptr);
-            removeFile(friendId, fileId);
+        // served straight from the shared avatar data, toxcore copies the chunk itself
+        const uint64_t avatarSize = static_cast<uint64_t>(file->avatarData.size());
+        if (pos >= avatarSize) {
+            qWarning("onFileDataCallback: Avatar chunk requested past the end");
             return;
         }
-        file->bytesSent += length;
-        file->hashGenerator->addData((const char*)data.get(), length);
+
+        const size_t chunkSize = static_cast<size_t>(qMin<uint64_t>(length, avatarSize - pos));
+        const auto chunk = reinterpret_cast<const uint8_t*>(file->avatarData.constData()) + pos;
+        if (!tox_file_send_chunk(tox, friendId, fileId, pos, chunk, chunkSize, nullptr)) {
+            qWarning("onFileDataCallback: Failed to send data chunk");
+        }
+        return;
     }
 
-    if (!tox_file_send_chunk(tox, friendId, fileId, pos, data.get(), nread, nullptr)) {
-        qWarning("onFileDataCallback: Failed to send data chunk");
+    // chunks have to be sent in order, so queue behind chunks still waiting for the disk
+    const uint64_t key = getFriendKey(friendId, fileId);
+    if (chunkRequests.contains(key)) {
+        chunkRequests[key].enqueue({pos, length});
         return;
     }
-    if (file->fileKind != TOX_FILE_KIND_AVATAR)
-        emit static_cast<Core*>(core)->fileTransferInfo(*file);
+
+    const ChunkResult result = sendFileChunk(static_cast<Core*>(core), *file, pos, length);
+    if (result == ChunkResult::Pending) {
+        chunkRequests[key].enqueue({pos, length});
+    }
 }
 
 void CoreFile::onFileRecvChunkCallback(Tox* tox, uint32_t friendId, uint32_t fileId, uint64_t position,
@@ -448,8 +795,20 @@ void CoreFile::onFileRecvChunkCallback(Tox* tox, uint32_t friendId, uint32_t fil
         return;
     }
 
+    if (position < file->bytesSent) {
+        // data we already have, skip it
+        const quint64 known = qMin<quint64>(file->bytesSent - position, length);
+        if (known == length && length) {
+            return;
+        }
+
+        data += known;
+        length -= known;
+        position += known;
+    }
+
     if (file->bytesSent != position) {
-        qWarning("onFileRecvChunkCallback: Received a chunk out-of-order, aborting transfer");
+        qWarning("onFileRecvChunkCallback: Data is missing before a chunk, aborting transfer");
         if (file->fileKind != TOX_FILE_KIND_AVATAR) {
             file->status = ToxFile::CANCELED;
             emit core->fileTransferCancelled(*file);
@@ -469,38 +828,361 @@ void CoreFile::onFileRecvChunkCallback(Tox* tox, uint32_t friendId, uint32_t fil
                 emit core->friendAvatarChanged(core->getFriendPublicKey(friendId), file->avatarData);
             }
         } else {
-            emit core->fileTransferFinished(*file);
-            emit core->fileDownloadFinished(file->filePath);
+            // reported by processIO once the data is on disk and hashed
+            finishingFiles.append(*file);
         }
         removeFile(friendId, fileId);
         return;
     }
 
-    if (file->fileKind == TOX_FILE_KIND_AVATAR)
+    if (file->fileKind == TOX_FILE_KIND_AVATAR) {
         file->avatarData.append((char*)data, length);
-    else
-        file->file->write((char*)data, length);
+    } else {
+        file->io->write((const char*)data, static_cast<qint64>(length));
+        if (file->io->hasError()) {
+            qWarning("onFileRecvChunkCallback: Failed to write to file, aborting transfer");
+            file->status = ToxFile::CANCELED;
+            emit core->fileTransferCancelled(*file);
+            tox_file_control(tox, friendId, fileId, TOX_FILE_CONTROL_CANCEL, nullptr);
+            removeFile(friendId, fileId);
+            return;
+        }
+    }
     file->bytesSent += length;
-    file->hashGenerator->addData((const char*)data, length);
 
-    if (file->fileKind != TOX_FILE_KIND_AVATAR)
-        emit static_cast<Core*>(core)->fileTransferInfo(*file);
+    if (file->fileKind != TOX_FILE_KIND_AVATAR) {
+        scheduler.addReceived(friendId, fileId, length, QDateTime::currentMSecsSinceEpoch());
+        reportProgress(static_cast<Core*>(core), *file);
+    }
 }
 
 void CoreFile::onConnectionStatusChanged(Core* core, uint32_t friendId, bool online)
 {
-    // TODO: Actually resume broken file transfers
-    // We need to:
-    // - Start a new file transfer with the same 32byte file ID with toxcore
-    // - Seek to the correct position again
-    // - Update the fileNum in our ToxFile
-    // - Update the users of our signals to check the 32byte tox file ID, not the uint32_t file_num
-    // (fileId)
-    ToxFile::FileStatus status = online ? ToxFile::TRANSMITTING : ToxFile::BROKEN;
+    bool changed = false;
+    if (!online) {
+        for (uint64_t key : fileMap.keys()) {
+            if (key >> 32 == friendId) {
+                breakFile(core, key);
+                changed = true;
+            }
+        }
+    } else {
+        for (auto it = brokenFiles.begin(); it != brokenFiles.end();) {
+            if (it->file.friendId != friendId || it->file.direction != ToxFile::SENDING) {
+                ++it;
+                continue;
+            }
+
+            resumeFileSend(core, *it);
+            it = brokenFiles.erase(it);
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        saveResumableFiles(core);
+    }
+}
+
+/**
+ * @brief Number for a queued or broken transfer, which toxcore doesn't know.
+ *
+ * Counts down from the largest number, so it doesn't collide with toxcore's file numbers. Used
+ * by the GUI to cancel the transfer.
+ */
+uint32_t CoreFile::getLocalFileNum()
+{
+    return nextLocalFileNum--;
+}
+
+/**
+ * @brief Stop a running transfer and keep it to be resumed later.
+ *
+ * Avatars and incoming transfers that weren't accepted yet are cancelled instead, queued
+ * outgoing transfers break like running ones.
+ */
+void CoreFile::breakFile(Core* core, uint64_t key)
+{
+    ToxFile file = fileMap[key];
+    if (file.fileKind == TOX_FILE_KIND_AVATAR
+        || (file.direction == ToxFile::RECEIVING && !file.io)) {
+        if (file.fileKind != TOX_FILE_KIND_AVATAR) {
+            file.status = ToxFile::CANCELED;
+            emit core->fileTransferCancelled(file);
+        } else if (file.direction == ToxFile::SENDING) {
+            emit core->avatarSendFinished(file.friendId, false);
+        }
+
+        removeFile(file.friendId, file.fileNum);
+        return;
+    }
+
+    BrokenFile broken{file, QByteArray{}};
+    if (resumingFiles.contains(key)) {
+        // broke again before the received data was verified
+        const ResumingFile& resuming = resumingFiles[key];
+        broken.file.bytesSent = resuming.offset;
+        broken.hash = resuming.hash;
+    }
+
+    broken.file.fileNum = getLocalFileNum();
+    broken.file.status = ToxFile::BROKEN;
+    broken.file.pauseStatus = ToxFilePause{};
+    emit core->fileTransferBrokenUnbroken(broken.file, true);
+
+    // closes the file, the hash of received data is collected by processIO
+    removeFile(file.friendId, file.fileNum);
+    brokenFiles.append(broken);
+}
+
+/**
+ * @brief Queue a broken outgoing transfer again, it's offered with the same file ID.
+ *
+ * Transfers restored from a previous session are already in the history, the GUI attaches
+ * them to their entry by file ID instead of being told about a new transfer.
+ */
+void CoreFile::resumeFileSend(Core* core, const BrokenFile& broken)
+{
+    ToxFile file = broken.file;
+    // the previous file may still be closing on the I/O worker
+    file.file = std::make_shared<QFile>(file.filePath);
+    file.io.reset();
+    file.fileNum = getLocalFileNum();
+    queueFileSend(core, file);
+    emit core->fileTransferBrokenUnbroken(file, false);
+}
+
+/**
+ * @brief Take over an incoming offer that continues a broken transfer.
+ *
+ * The data received before is hashed in the background, finishResume continues the transfer.
+ * @return True if the offer was taken over.
+ */
+bool CoreFile::resumeFileRecv(Core* core, const ToxFile& offer)
+{
+    for (auto it = brokenFiles.begin(); it != brokenFiles.end(); ++it) {
+        const ToxFile& old = it->file;
+        if (old.direction != ToxFile::RECEIVING || old.friendId != offer.friendId
+            || old.resumeFileId != offer.resumeFileId || old.filesize != offer.filesize
+            || it->hash.isEmpty()) {
+            continue;
+        }
+
+        ToxFile file = old;
+        file.fileNum = offer.fileNum;
+        file.file = std::make_shared<QFile>(file.filePath);
+        file.io.reset();
+        if (!file.open(true)) {
+            qWarning() << "resumeFileRecv: Can't open" << file.filePath << "again";
+            return false;
+        }
+
+        qDebug() << QString("resumeFileRecv: Verifying %1 bytes of %2 before resuming")
+                        .arg(old.bytesSent)
+                        .arg(file.fileName);
+        const ResumingFile resuming{old.bytesSent, it->hash};
+        brokenFiles.erase(it);
+
+        file.io->hashFile(resuming.offset);
+        addFile(file.friendId, file.fileNum, file);
+        resumingFiles.insert(getFriendKey(file.friendId, file.fileNum), resuming);
+        core->requestIteration();
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Continue an incoming transfer once the data on disk is hashed.
+ *
+ * If the data doesn't match what was received before, the transfer starts over.
+ */
+void CoreFile::finishResume(Core* core, ToxFile& file, const ResumingFile& resuming)
+{
+    Tox* tox = core->tox.get();
+    const uint32_t friendId = file.friendId;
+    const uint32_t fileId = file.fileNum;
+    if (file.io->hasError()) {
+        qWarning() << "finishResume: Can't read" << file.filePath;
+        file.status = ToxFile::CANCELED;
+        emit core->fileTransferCancelled(file);
+        tox_file_control(tox, friendId, fileId, TOX_FILE_CONTROL_CANCEL, nullptr);
+        removeFile(friendId, fileId);
+        saveResumableFiles(core);
+        return;
+    }
+
+    quint64 offset = resuming.offset;
+    if (file.io->getHashedSize() != offset || file.io->getHash() != resuming.hash) {
+        qWarning() << "finishResume: Received data of" << file.fileName
+                   << "changed, starting over";
+        offset = 0;
+    }
+
+    Tox_Err_File_Seek seekErr;
+    if (offset && !tox_file_seek(tox, friendId, fileId, offset, &seekErr)) {
+        qWarning() << "finishResume: Can't seek (" << seekErr << "), starting over";
+        offset = 0;
+    }
+
+    file.io->startWriting(offset);
+    file.bytesSent = offset;
+    file.status = ToxFile::TRANSMITTING;
+    tox_file_control(tox, friendId, fileId, TOX_FILE_CONTROL_RESUME, nullptr);
+    core->requestIteration();
+    emit core->fileTransferAccepted(file);
+    saveResumableFiles(core);
+}
+
+/**
+ * @brief Cancel a broken transfer.
+ * @return True if there was a broken transfer with that number.
+ */
+bool CoreFile::cancelBrokenFile(Core* core, uint32_t friendId, uint32_t fileId,
+                                ToxFile::FileDirection direction)
+{
+    for (auto it = brokenFiles.begin(); it != brokenFiles.end(); ++it) {
+        if (it->file.friendId != friendId || it->file.fileNum != fileId
+            || it->file.direction != direction) {
+            continue;
+        }
+
+        ToxFile file = it->file;
+        brokenFiles.erase(it);
+        file.status = ToxFile::CANCELED;
+        emit core->fileTransferCancelled(file);
+        saveResumableFiles(core);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the hashes of broken incoming transfers whose data is on disk now.
+ * @return True if a broken transfer changed.
+ */
+bool CoreFile::collectBrokenHashes(Core* core)
+{
+    bool changed = false;
+    for (auto it = brokenFiles.begin(); it != brokenFiles.end();) {
+        ToxFile& file = it->file;
+        if (file.direction != ToxFile::RECEIVING || !it->hash.isEmpty() || !file.io
+            || !file.io->isClosed()) {
+            ++it;
+            continue;
+        }
+
+        changed = true;
+        if (file.io->hasError()) {
+            qWarning() << "collectBrokenHashes: Can't write" << file.filePath;
+            file.status = ToxFile::CANCELED;
+            emit core->fileTransferCancelled(file);
+            it = brokenFiles.erase(it);
+            continue;
+        }
+
+        it->hash = file.io->getHash();
+        ++it;
+    }
+
+    return changed;
+}
+
+/**
+ * @brief Store the broken transfers in the profile settings.
+ *
+ * Incoming transfers are stored once the hash of their data is known.
+ */
+void CoreFile::saveResumableFiles(Core* core)
+{
+    QList<Settings::ResumableFile> files;
+    for (const BrokenFile& broken : brokenFiles) {
+        const ToxFile& file = broken.file;
+        const bool receiving = file.direction == ToxFile::RECEIVING;
+        if (receiving && broken.hash.isEmpty()) {
+            continue;
+        }
+
+        Settings::ResumableFile resumable;
+        resumable.friendPk = core->getFriendPublicKey(file.friendId);
+        resumable.fileId = file.resumeFileId;
+        resumable.fileName = file.fileName;
+        resumable.filePath = file.filePath;
+        resumable.fileSize = file.filesize;
+        resumable.offset = file.bytesSent;
+        resumable.hash = broken.hash;
+        resumable.receiving = receiving;
+        files.append(resumable);
+    }
+
+    Settings::getInstance().setResumableFiles(files);
+}
+
+/**
+ * @brief Break all running transfers before Core stops, so they can be resumed after a restart.
+ *
+ * Waits a bit for the received data to reach the disk, to store its hash. The I/O workers don't
+ * need the Core loop, so blocking on them is safe.
+ */
+void CoreFile::suspendTransfers(Core* core)
+{
+    constexpr qint64 suspendTimeout = 5000;
+
     for (uint64_t key : fileMap.keys()) {
-        if (key >> 32 != friendId)
+        breakFile(core, key);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    auto waitClosed = [&timer](const ToxFile& file) {
+        const qint64 remaining = suspendTimeout - timer.elapsed();
+        if (file.io && remaining > 0) {
+            file.io->waitClosed(static_cast<unsigned long>(remaining));
+        }
+    };
+
+    for (const ToxFile& file : finishingFiles) {
+        waitClosed(file);
+    }
+
+    for (const BrokenFile& broken : brokenFiles) {
+        if (broken.hash.isEmpty()) {
+            waitClosed(broken.file);
+        }
+    }
+
+    collectBrokenHashes(core);
+    saveResumableFiles(core);
+}
+
+/**
+ * @brief Load the broken transfers stored by a previous session.
+ *
+ * Requires the friend list to be loaded.
+ */
+void CoreFile::loadResumableFiles(Core* core)
+{
+    brokenFiles.clear();
+    resumingFiles.clear();
+
+    for (const Settings::ResumableFile& resumable : Settings::getInstance().getResumableFiles()) {
+        const uint32_t friendId =
+            tox_friend_by_public_key(core->tox.get(), resumable.friendPk.getBytes(), nullptr);
+        if (friendId == std::numeric_limits<uint32_t>::max()) {
+            qDebug() << "loadResumableFiles: Dropping transfer of a removed friend";
             continue;
-        fileMap[key].status = status;
-        emit core->fileTransferBrokenUnbroken(fileMap[key], !online);
+        }
+
+        const ToxFile::FileDirection direction =
+            resumable.receiving ? ToxFile::RECEIVING : ToxFile::SENDING;
+        ToxFile file{getLocalFileNum(), friendId, resumable.fileName, resumable.filePath,
+                     direction};
+        file.filesize = resumable.fileSize;
+        file.bytesSent = resumable.offset;
+        file.resumeFileId = resumable.fileId;
+        file.status = ToxFile::BROKEN;
+        brokenFiles.append({file, resumable.hash});
     }
 }
@@ -27,9 +27,13 @@
 #include <tox/tox.h>
 
 #include "toxfile.h"
+#include "transferscheduler.h"
 
+#include <QByteArray>
 #include <QHash>
+#include <QList>
 #include <QMutex>
+#include <QQueue>
 #include <QString>
 
 struct Tox;
@@ -51,15 +55,21 @@ private:
     static void sendFile(Core* core, uint32_t friendId, QString filename, QString filePath,
                          long long filesize);
     static void sendAvatarFile(Core* core, uint32_t friendId, const QByteArray& data);
+    static void cancelAvatarSend(Core* core, uint32_t friendId);
     static void pauseResumeFile(Core* core, uint32_t friendId, uint32_t fileId);
     static void cancelFileSend(Core* core, uint32_t friendId, uint32_t fileId);
     static void cancelFileRecv(Core* core, uint32_t friendId, uint32_t fileId);
     static void rejectFileRecvRequest(Core* core, uint32_t friendId, uint32_t fileId);
     static void acceptFileRecvRequest(Core* core, uint32_t friendId, uint32_t fileId, QString path);
     static ToxFile* findFile(uint32_t friendId, uint32_t fileId);
+    static QHash<QString, ToxFile> getResumableTransfers();
     static void addFile(uint32_t friendId, uint32_t fileId, const ToxFile& file);
     static void removeFile(uint32_t friendId, uint32_t fileId);
     static unsigned corefileIterationInterval();
+    static void reportProgress(Core* core, ToxFile& file);
+    static void processIO(Core* core);
+    static void suspendTransfers(Core* core);
+    static void loadResumableFiles(Core* core);
     static constexpr uint64_t getFriendKey(uint32_t friendId, uint32_t fileId)
     {
         return (static_cast<std::uint64_t>(friendId) << 32) + fileId;
@@ -77,9 +87,60 @@ private:
                                         const uint8_t* data, size_t length, void* vCore);
     static void onConnectionStatusChanged(Core* core, uint32_t friendId, bool online);
 
+private:
+    enum class ChunkResult
+    {
+        Sent,
+        Pending,
+        Failed
+    };
+
+    struct ChunkRequest
+    {
+        uint64_t position;
+        size_t length;
+    };
+
+    // a transfer that broke off, to resume when the friend is back
+    struct BrokenFile
+    {
+        ToxFile file;
+        // hash of the received data, known once it's on disk
+        QByteArray hash;
+    };
+
+    // a broken incoming transfer offered again, resumed once the received data is verified
+    struct ResumingFile
+    {
+        quint64 offset;
+        QByteArray hash;
+    };
+
+    static ChunkResult sendFileChunk(Core* core, ToxFile& file, uint64_t position, size_t length);
+    static QByteArray createFileId();
+    static void queueFileSend(Core* core, ToxFile& file);
+    static void startQueuedFiles(Core* core);
+    static void offerFile(Core* core, uint32_t friendId, uint32_t localNum);
+    static uint32_t getLocalFileNum();
+    static void breakFile(Core* core, uint64_t key);
+    static void resumeFileSend(Core* core, const BrokenFile& broken);
+    static bool resumeFileRecv(Core* core, const ToxFile& offer);
+    static void finishResume(Core* core, ToxFile& file, const ResumingFile& resuming);
+    static bool cancelBrokenFile(Core* core, uint32_t friendId, uint32_t fileId,
+                                 ToxFile::FileDirection direction);
+    static bool collectBrokenHashes(Core* core);
+    static void saveResumableFiles(Core* core);
+
 private:
     static QMutex fileSendMutex;
     static QHash<uint64_t, ToxFile> fileMap;
+    static QHash<uint64_t, QQueue<ChunkRequest>> chunkRequests;
+    static QList<ToxFile> finishingFiles;
+    static QByteArray chunkBuffer;
+    static QList<BrokenFile> brokenFiles;
+    static QHash<uint64_t, ResumingFile> resumingFiles;
+    static uint32_t nextLocalFileNum;
+    static TransferScheduler scheduler;
     static QString getCleanFileName(QString filename);
 };
 
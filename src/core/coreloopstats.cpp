@@ -0,0 +1,98 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "coreloopstats.h"
+
+/**
+ * @class CoreLoopStats
+ * @brief Iteration timing histograms of the toxcore event loop.
+ *
+ * Written by the Core thread after every iteration and readable from any thread.
+ */
+
+/**
+ * @var CoreLoopStats::BUCKET_COUNT
+ * @brief Number of histogram buckets, the last one counts all values from 1024 on.
+ */
+
+CoreLoopStats::CoreLoopStats()
+    : iterations{0}
+    , wakeups{0}
+    , durations{BUCKET_COUNT}
+    , sleeps{BUCKET_COUNT}
+{
+}
+
+/**
+ * @brief Record one iteration of the event loop.
+ * @param durationUs Time spent iterating toxcore, in microseconds.
+ * @param sleepMs Time until the next scheduled iteration, in milliseconds.
+ * @param woken True if the iteration was requested for pending work instead of scheduled.
+ */
+void CoreLoopStats::addIteration(uint64_t durationUs, uint32_t sleepMs, bool woken)
+{
+    iterations.fetch_add(1, std::memory_order_relaxed);
+    if (woken) {
+        wakeups.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    durations.add(durationUs);
+    sleeps.add(sleepMs);
+}
+
+uint64_t CoreLoopStats::getIterations() const
+{
+    return iterations.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Number of iterations that ran early because work was queued.
+ */
+uint64_t CoreLoopStats::getWakeups() const
+{
+    return wakeups.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Histogram of the iteration durations, in microseconds.
+ */
+QVector<uint64_t> CoreLoopStats::getDurations() const
+{
+    return durations.getBuckets();
+}
+
+/**
+ * @brief Histogram of the sleep times between iterations, in milliseconds.
+ */
+QVector<uint64_t> CoreLoopStats::getSleeps() const
+{
+    return sleeps.getBuckets();
+}
+
+/**
+ * @brief Human readable summary, listing only non-empty buckets by their lower bound.
+ */
+QString CoreLoopStats::toString() const
+{
+    return QStringLiteral("%1 iterations, %2 woken, iterate us [%3], sleep ms [%4]")
+        .arg(getIterations())
+        .arg(getWakeups())
+        .arg(durations.toString())
+        .arg(sleeps.toString());
+}
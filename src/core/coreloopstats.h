@@ -0,0 +1,53 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORELOOPSTATS_H
+#define CORELOOPSTATS_H
+
+#include "src/core/poweroftwohistogram.h"
+
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <cstdint>
+
+class CoreLoopStats
+{
+public:
+    static constexpr int BUCKET_COUNT = 12;
+
+    CoreLoopStats();
+
+    void addIteration(uint64_t durationUs, uint32_t sleepMs, bool woken);
+
+    uint64_t getIterations() const;
+    uint64_t getWakeups() const;
+    QVector<uint64_t> getDurations() const;
+    QVector<uint64_t> getSleeps() const;
+    QString toString() const;
+
+private:
+    std::atomic<uint64_t> iterations;
+    std::atomic<uint64_t> wakeups;
+    PowerOfTwoHistogram durations;
+    PowerOfTwoHistogram sleeps;
+};
+
+#endif // CORELOOPSTATS_H
@@ -0,0 +1,709 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filetransferio.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QStorageInfo>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <cstring>
+
+/**
+ * @class FileTransferIO
+ * @brief Disk access of a file transfer, done on a worker thread.
+ *
+ * Lets the Core thread send and receive file chunks without blocking on the disk. Outgoing
+ * transfers read ahead up to READ_AHEAD_BLOCKS blocks of BLOCK_SIZE bytes, starting at the
+ * position of the first read. Incoming chunks are collected into blocks and written behind.
+ * Block buffers are reused for the lifetime of the transfer.
+ *
+ * The work of all transfers runs on a small shared thread pool, with at most one job per
+ * transfer so reads and writes stay in order. The worker also hashes the data it reads or
+ * writes, if the transfer skipped parts of the file the whole file is hashed when closing.
+ * Resumed transfers hash the data already on disk with hashFile, before writing after it.
+ *
+ * Files opened read only on a local file system are memory mapped instead. The worker then
+ * only pages in the data ahead of the reader, and chunks can be taken straight from the
+ * mapping with mapped(), without a syscall or a copy per chunk.
+ */
+
+namespace {
+const int IO_THREADS = 4;
+// touching one byte per page is enough to load it
+const int PAGE_SIZE = 4096;
+// keep the address space usage of 32 bit builds small
+const qint64 MAX_MAP_SIZE_32BIT = 256 * 1024 * 1024;
+
+QThreadPool& ioPool()
+{
+    static QThreadPool* pool = [] {
+        QThreadPool* p = new QThreadPool;
+        p->setMaxThreadCount(IO_THREADS);
+        return p;
+    }();
+    return *pool;
+}
+} // namespace
+
+struct FileTransferIO::State : std::enable_shared_from_this<FileTransferIO::State>
+{
+    struct Block
+    {
+        quint64 offset;
+        QByteArray data;
+    };
+
+    explicit State(std::shared_ptr<QFile> file)
+        : file{std::move(file)}
+    {}
+
+    QByteArray takeBuffer();
+    void recycle(QByteArray buffer);
+    void restartReading(quint64 position);
+    bool needsRead() const;
+    void mapFile();
+    void hashBlock(quint64 offset, const QByteArray& data);
+    void rehashFile();
+    bool hashPrefix(quint64 length);
+    bool hasWork() const;
+    void schedule();
+    void work();
+
+    std::shared_ptr<QFile> file;
+    mutable QMutex mutex;
+    bool jobRunning = false;
+    bool closing = false;
+    bool closed = false;
+    // signalled once closed is set
+    QWaitCondition closedCondition;
+    bool error = false;
+
+    // read ahead, readOffset is the end of the data read so far
+    bool reading = false;
+    bool eof = false;
+    quint64 readOffset = 0;
+    quint64 generation = 0;
+    QQueue<Block> ready;
+
+    // memory mapped reading, data from readStart to readOffset is paged in
+    bool mapChecked = false;
+    uchar* map = nullptr;
+    quint64 mapSize = 0;
+    quint64 readStart = 0;
+    quint64 readPosition = 0;
+
+    // write behind
+    QByteArray current;
+    QQueue<QByteArray> writes;
+    quint64 writeOffset = 0;
+    // set by startWriting, the file is cut there before the next write
+    qint64 truncateAt = -1;
+
+    // set by hashFile, the length of the file prefix to hash
+    qint64 prefixLength = -1;
+    bool prefixHashed = false;
+
+    // only accessed by the worker, except for reading the result
+    mutable QMutex hashMutex;
+    QCryptographicHash hash{QCryptographicHash::Sha256};
+    quint64 hashedOffset = 0;
+    bool hashGap = false;
+    QByteArray fileResult;
+
+    QVector<QByteArray> spare;
+};
+
+/**
+ * @brief Create the I/O worker of a transfer.
+ * @param file Already opened file, only accessed by the worker from now on.
+ */
+FileTransferIO::FileTransferIO(std::shared_ptr<QFile> file)
+    : state{std::make_shared<State>(std::move(file))}
+{}
+
+/**
+ * @brief Start reading ahead from a position, before the data is needed.
+ */
+void FileTransferIO::startReading(quint64 position)
+{
+    QMutexLocker locker{&state->mutex};
+    if (!state->closing) {
+        state->restartReading(position);
+    }
+}
+
+/**
+ * @brief Copy buffered file data.
+ * @param position Offset in the file, a position outside the buffered range restarts reading
+ * ahead from there.
+ * @param data Destination for the data.
+ * @param length Number of bytes to copy.
+ * @return Number of bytes copied, 0 if the data isn't buffered yet, -1 on read errors or if the
+ * file ends before position + length.
+ */
+qint64 FileTransferIO::read(quint64 position, char* data, qint64 length)
+{
+    QMutexLocker locker{&state->mutex};
+    if (state->error || state->closing) {
+        return -1;
+    }
+
+    if (state->map) {
+        if (!state->reading || position < state->readStart || position > state->readOffset) {
+            state->restartReading(position);
+            return 0;
+        }
+
+        state->readPosition = position;
+        if (state->readOffset - position < static_cast<quint64>(length)) {
+            state->schedule();
+            return state->eof ? -1 : 0;
+        }
+
+        memcpy(data, state->map + position, static_cast<size_t>(length));
+        state->readPosition = position + static_cast<quint64>(length);
+        state->schedule();
+        return length;
+    }
+
+    const quint64 start = state->ready.isEmpty() ? state->readOffset : state->ready.head().offset;
+    if (!state->reading || position < start || position > state->readOffset) {
+        state->restartReading(position);
+        return 0;
+    }
+
+    while (!state->ready.isEmpty()
+           && state->ready.head().offset + state->ready.head().data.size() <= position) {
+        state->recycle(state->ready.dequeue().data);
+    }
+
+    if (state->readOffset - position < static_cast<quint64>(length)) {
+        state->schedule();
+        return state->eof ? -1 : 0;
+    }
+
+    qint64 copied = 0;
+    for (const State::Block& block : state->ready) {
+        const quint64 from = position + copied - block.offset;
+        const qint64 size = qMin(length - copied, static_cast<qint64>(block.data.size() - from));
+        memcpy(data + copied, block.data.constData() + from, static_cast<size_t>(size));
+        copied += size;
+        if (copied == length) {
+            break;
+        }
+    }
+
+    // free fully consumed blocks for reading further ahead
+    while (!state->ready.isEmpty()
+           && state->ready.head().offset + state->ready.head().data.size() <= position + length) {
+        state->recycle(state->ready.dequeue().data);
+    }
+
+    state->schedule();
+    return copied;
+}
+
+/**
+ * @brief Get file data without copying it, if the file is memory mapped.
+ * @param position Offset in the file.
+ * @param length Number of bytes needed.
+ * @return Pointer to the data, valid until close(). nullptr if the file isn't mapped or the data
+ * isn't paged in yet, use read() then.
+ */
+const char* FileTransferIO::mapped(quint64 position, qint64 length)
+{
+    QMutexLocker locker{&state->mutex};
+    if (!state->map || state->error || state->closing || !state->reading
+        || position < state->readStart
+        || position + static_cast<quint64>(length) > state->readOffset) {
+        return nullptr;
+    }
+
+    state->readPosition = position + static_cast<quint64>(length);
+    state->schedule();
+    return reinterpret_cast<const char*>(state->map + position);
+}
+
+/**
+ * @brief Append data to the file, written once a block is full or the transfer is closed.
+ */
+void FileTransferIO::write(const char* data, qint64 length)
+{
+    QMutexLocker locker{&state->mutex};
+    if (state->error || state->closing) {
+        return;
+    }
+
+    if (state->current.capacity() < BLOCK_SIZE) {
+        state->current = state->takeBuffer();
+    }
+
+    state->current.append(data, static_cast<int>(length));
+    if (state->current.size() >= BLOCK_SIZE) {
+        state->writes.enqueue(state->current);
+        state->current = state->takeBuffer();
+        state->schedule();
+    }
+}
+
+/**
+ * @brief Continue writing at a position, dropping any file data after it.
+ *
+ * Used when resuming a transfer, call before the first write. The hash continues from the
+ * prefix hashed by hashFile if it ends at position, otherwise the whole file is hashed on close.
+ */
+void FileTransferIO::startWriting(quint64 position)
+{
+    {
+        QMutexLocker locker{&state->hashMutex};
+        if (position != state->hashedOffset) {
+            state->hash.reset();
+            state->hashedOffset = 0;
+            state->hashGap = position > 0;
+        }
+    }
+
+    QMutexLocker locker{&state->mutex};
+    if (state->error || state->closing) {
+        return;
+    }
+
+    state->writeOffset = position;
+    state->truncateAt = static_cast<qint64>(position);
+    state->schedule();
+}
+
+/**
+ * @brief Hash the first bytes of the file in the background.
+ * @param length Number of bytes to hash, less are hashed if the file is shorter.
+ *
+ * Use isHashed to find out when done, then getHash and getHashedSize for the result.
+ */
+void FileTransferIO::hashFile(quint64 length)
+{
+    QMutexLocker locker{&state->mutex};
+    if (state->error || state->closing) {
+        return;
+    }
+
+    state->prefixHashed = false;
+    state->prefixLength = static_cast<qint64>(length);
+    state->schedule();
+}
+
+/**
+ * @brief Check if the hashing started by hashFile is done.
+ */
+bool FileTransferIO::isHashed() const
+{
+    QMutexLocker locker{&state->mutex};
+    return state->prefixHashed || state->error;
+}
+
+/**
+ * @brief Number of bytes from the start of the file covered by getHash.
+ */
+quint64 FileTransferIO::getHashedSize() const
+{
+    QMutexLocker locker{&state->hashMutex};
+    return state->hashedOffset;
+}
+
+/**
+ * @brief Stop reading ahead, write the remaining data and close the file in the background.
+ *
+ * Use isClosed to find out when the file is complete on disk.
+ */
+void FileTransferIO::close()
+{
+    QMutexLocker locker{&state->mutex};
+    if (state->closing) {
+        return;
+    }
+
+    if (!state->current.isEmpty()) {
+        state->writes.enqueue(state->current);
+        state->current = QByteArray{};
+    }
+
+    state->closing = true;
+    state->reading = false;
+    state->ready.clear();
+    state->spare.clear();
+    state->schedule();
+}
+
+/**
+ * @brief Check if the file was closed after close(), with all data written.
+ */
+bool FileTransferIO::isClosed() const
+{
+    QMutexLocker locker{&state->mutex};
+    return state->closed;
+}
+
+/**
+ * @brief Block until the file was closed after close(), with all data written.
+ * @param timeout Maximum time to wait in milliseconds.
+ * @return True if the file is closed, false if the timeout expired first.
+ */
+bool FileTransferIO::waitClosed(unsigned long timeout) const
+{
+    QMutexLocker locker{&state->mutex};
+    if (!state->closed) {
+        state->closedCondition.wait(&state->mutex, timeout);
+    }
+
+    return state->closed;
+}
+
+/**
+ * @brief SHA-256 hash of the data read or written so far.
+ *
+ * Once a complete transfer is closed, this is the hash of the whole file.
+ */
+QByteArray FileTransferIO::getHash() const
+{
+    QMutexLocker locker{&state->hashMutex};
+    return state->fileResult.isEmpty() ? state->hash.result() : state->fileResult;
+}
+
+/**
+ * @brief Check if reading or writing the file failed.
+ */
+bool FileTransferIO::hasError() const
+{
+    QMutexLocker locker{&state->mutex};
+    return state->error;
+}
+
+QByteArray FileTransferIO::State::takeBuffer()
+{
+    if (!spare.isEmpty()) {
+        return spare.takeLast();
+    }
+
+    QByteArray buffer;
+    buffer.reserve(BLOCK_SIZE);
+    return buffer;
+}
+
+void FileTransferIO::State::recycle(QByteArray buffer)
+{
+    // with reserved capacity, resize keeps the allocation
+    buffer.resize(0);
+    spare.append(buffer);
+}
+
+void FileTransferIO::State::restartReading(quint64 position)
+{
+    ++generation;
+    while (!ready.isEmpty()) {
+        recycle(ready.dequeue().data);
+    }
+
+    reading = true;
+    eof = false;
+    readOffset = position;
+    readStart = position;
+    readPosition = position;
+    schedule();
+}
+
+/**
+ * @brief Check if reading ahead should continue, requires the mutex.
+ */
+bool FileTransferIO::State::needsRead() const
+{
+    if (!reading || eof || error) {
+        return false;
+    }
+
+    if (map) {
+        return readOffset < readPosition + READ_AHEAD_BLOCKS * BLOCK_SIZE;
+    }
+
+    return ready.size() < READ_AHEAD_BLOCKS;
+}
+
+/**
+ * @brief Memory map the file if it's only read and on a local file system.
+ *
+ * Network file systems are excluded, since a lost connection would fault on access.
+ */
+void FileTransferIO::State::mapFile()
+{
+    static const QStringList networkFileSystems{"nfs",   "nfs4",  "cifs", "smbfs",
+                                                "smb2",  "afpfs", "davfs", "9p",
+                                                "fuse.sshfs"};
+
+    if (file->openMode() != QIODevice::ReadOnly) {
+        return;
+    }
+
+    const qint64 size = file->size();
+    if (size <= 0 || (QT_POINTER_SIZE < 8 && size > MAX_MAP_SIZE_32BIT)) {
+        return;
+    }
+
+    const QStorageInfo storage{file->fileName()};
+    if (!storage.isValid() || networkFileSystems.contains(storage.fileSystemType())) {
+        return;
+    }
+
+    uchar* data = file->map(0, size);
+    if (!data) {
+        qDebug() << "Reading" << file->fileName() << "without mapping:" << file->errorString();
+        return;
+    }
+
+    QMutexLocker locker{&mutex};
+    map = data;
+    mapSize = static_cast<quint64>(size);
+}
+
+/**
+ * @brief Add data at a file offset to the hash, if it continues the data hashed so far.
+ */
+void FileTransferIO::State::hashBlock(quint64 offset, const QByteArray& data)
+{
+    QMutexLocker locker{&hashMutex};
+    const quint64 end = offset + static_cast<quint64>(data.size());
+    if (offset > hashedOffset) {
+        hashGap = true;
+    } else if (end > hashedOffset) {
+        const int skip = static_cast<int>(hashedOffset - offset);
+        hash.addData(data.constData() + skip, data.size() - skip);
+        hashedOffset = end;
+    }
+}
+
+/**
+ * @brief Hash the whole file, used if blocks were not transferred in order.
+ */
+void FileTransferIO::State::rehashFile()
+{
+    QCryptographicHash fileHash{QCryptographicHash::Sha256};
+    if (!file->seek(0) || !fileHash.addData(file.get())) {
+        return;
+    }
+
+    QMutexLocker locker{&hashMutex};
+    fileResult = fileHash.result();
+}
+
+/**
+ * @brief Restart the hash with the first length bytes of the file.
+ * @return False on read errors.
+ */
+bool FileTransferIO::State::hashPrefix(quint64 length)
+{
+    {
+        QMutexLocker locker{&hashMutex};
+        hash.reset();
+        hashedOffset = 0;
+        hashGap = false;
+    }
+
+    if (!file->seek(0)) {
+        return false;
+    }
+
+    QByteArray block{BLOCK_SIZE, Qt::Uninitialized};
+    quint64 hashed = 0;
+    while (hashed < length) {
+        const qint64 size = file->read(block.data(), qMin<qint64>(BLOCK_SIZE, length - hashed));
+        if (size < 0) {
+            return false;
+        }
+        if (size == 0) {
+            break;
+        }
+
+        hashed += static_cast<quint64>(size);
+        QMutexLocker locker{&hashMutex};
+        hash.addData(block.constData(), static_cast<int>(size));
+        hashedOffset = hashed;
+    }
+
+    return true;
+}
+
+bool FileTransferIO::State::hasWork() const
+{
+    return prefixLength >= 0 || truncateAt >= 0 || !writes.isEmpty() || needsRead()
+           || (closing && !closed);
+}
+
+/**
+ * @brief Start a worker job if there is work and none is running, requires the mutex.
+ */
+void FileTransferIO::State::schedule()
+{
+    if (jobRunning || !hasWork()) {
+        return;
+    }
+
+    jobRunning = true;
+    std::shared_ptr<State> self = shared_from_this();
+    QtConcurrent::run(&ioPool(), [self] { self->work(); });
+}
+
+void FileTransferIO::State::work()
+{
+    QMutexLocker locker{&mutex};
+    while (true) {
+        if (prefixLength >= 0) {
+            const quint64 length = static_cast<quint64>(prefixLength);
+            prefixLength = -1;
+            locker.unlock();
+            const bool hashed = hashPrefix(length);
+            locker.relock();
+            error = error || !hashed;
+            prefixHashed = true;
+            continue;
+        }
+
+        if (truncateAt >= 0) {
+            const qint64 size = truncateAt;
+            truncateAt = -1;
+            locker.unlock();
+            const bool truncated = file->resize(size) && file->seek(size);
+            locker.relock();
+            error = error || !truncated;
+            continue;
+        }
+
+        if (!writes.isEmpty()) {
+            QByteArray block = writes.dequeue();
+            const quint64 offset = writeOffset;
+            writeOffset += static_cast<quint64>(block.size());
+            locker.unlock();
+            hashBlock(offset, block);
+            const bool written = file->write(block) == block.size();
+            locker.relock();
+            error = error || !written;
+            recycle(block);
+            continue;
+        }
+
+        if (needsRead() && !mapChecked) {
+            mapChecked = true;
+            locker.unlock();
+            mapFile();
+            locker.relock();
+            continue;
+        }
+
+        if (needsRead() && map) {
+            const quint64 offset = readOffset;
+            const quint64 blockGeneration = generation;
+            const quint64 size = qMin<quint64>(BLOCK_SIZE, mapSize - qMin(offset, mapSize));
+            locker.unlock();
+            if (size > 0) {
+                // page in the data before the Core thread needs it
+                const uchar* const data = map + offset;
+                volatile uchar touched = 0;
+                for (quint64 page = 0; page < size; page += PAGE_SIZE) {
+                    touched = touched + data[page];
+                }
+                hashBlock(offset, QByteArray::fromRawData(reinterpret_cast<const char*>(data),
+                                                          static_cast<int>(size)));
+            }
+            locker.relock();
+            if (blockGeneration != generation || !reading) {
+                // reading restarted at another position meanwhile
+                continue;
+            }
+
+            eof = size < BLOCK_SIZE;
+            readOffset += size;
+            continue;
+        }
+
+        if (needsRead()) {
+            QByteArray block = takeBuffer();
+            const quint64 offset = readOffset;
+            const quint64 blockGeneration = generation;
+            locker.unlock();
+            block.resize(BLOCK_SIZE);
+            const qint64 size = file->seek(static_cast<qint64>(offset))
+                                    ? file->read(block.data(), BLOCK_SIZE)
+                                    : -1;
+            if (size > 0) {
+                hashBlock(offset,
+                          QByteArray::fromRawData(block.constData(), static_cast<int>(size)));
+            }
+            locker.relock();
+            if (blockGeneration != generation || !reading) {
+                // reading restarted at another position meanwhile
+                recycle(block);
+                continue;
+            }
+
+            if (size < 0) {
+                error = true;
+                recycle(block);
+                continue;
+            }
+
+            eof = size < BLOCK_SIZE;
+            if (size == 0) {
+                recycle(block);
+                continue;
+            }
+
+            block.resize(static_cast<int>(size));
+            ready.enqueue({offset, block});
+            readOffset += static_cast<quint64>(size);
+            continue;
+        }
+
+        if (closing && !closed) {
+            const bool rehash = !error;
+            uchar* const mapping = map;
+            map = nullptr;
+            locker.unlock();
+            if (rehash && hashGap) {
+                rehashFile();
+            }
+            if (mapping) {
+                file->unmap(mapping);
+            }
+            file->close();
+            locker.relock();
+            closed = true;
+            closedCondition.wakeAll();
+        }
+
+        jobRunning = false;
+        return;
+    }
+}
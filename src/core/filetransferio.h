@@ -0,0 +1,56 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILETRANSFERIO_H
+#define FILETRANSFERIO_H
+
+#include <QByteArray>
+
+#include <memory>
+
+class QFile;
+
+class FileTransferIO
+{
+public:
+    static constexpr int BLOCK_SIZE = 64 * 1024;
+    static constexpr int READ_AHEAD_BLOCKS = 4;
+
+    explicit FileTransferIO(std::shared_ptr<QFile> file);
+
+    void startReading(quint64 position);
+    qint64 read(quint64 position, char* data, qint64 length);
+    const char* mapped(quint64 position, qint64 length);
+    void write(const char* data, qint64 length);
+    void startWriting(quint64 position);
+    void hashFile(quint64 length);
+    bool isHashed() const;
+    quint64 getHashedSize() const;
+    void close();
+    bool isClosed() const;
+    bool waitClosed(unsigned long timeout) const;
+    bool hasError() const;
+    QByteArray getHash() const;
+
+private:
+    struct State;
+    std::shared_ptr<State> state;
+};
+
+#endif // FILETRANSFERIO_H
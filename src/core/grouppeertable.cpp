@@ -0,0 +1,124 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "grouppeertable.h"
+
+#include <atomic>
+
+/**
+ * @struct GroupPeer
+ * @brief A peer of a conference, as last reported by toxcore.
+ *
+ * @var GroupPeer::number
+ * @brief Peer number inside the conference, equal to the index in the peer list.
+ */
+
+/**
+ * @class GroupPeerTable
+ * @brief Per-conference peer lists, readable from any thread without locking.
+ *
+ * Every conference has an immutable peer list indexed by peer number. Changes build a new list
+ * and publish it together with a new conference map, so readers only take a reference to the
+ * current snapshot and never block the tox thread.
+ *
+ * Writers must be serialized externally; Core only modifies the table with coreLoopLock held.
+ */
+
+GroupPeerTable::GroupPeerTable()
+    : tables{std::make_shared<const Tables>()}
+{
+}
+
+/**
+ * @brief Get a snapshot of the peers of a conference.
+ * @param groupId Conference number.
+ * @return Peer list indexed by peer number, empty list if the conference is unknown.
+ */
+GroupPeerTable::PeersPtr GroupPeerTable::getPeers(uint32_t groupId) const
+{
+    const TablesPtr current = load();
+    const auto it = current->constFind(groupId);
+    if (it == current->constEnd()) {
+        static const PeersPtr empty = std::make_shared<const Peers>();
+        return empty;
+    }
+
+    return *it;
+}
+
+/**
+ * @brief Checks if a peer list was published for a conference.
+ */
+bool GroupPeerTable::hasGroup(uint32_t groupId) const
+{
+    return load()->contains(groupId);
+}
+
+/**
+ * @brief Replace the peer list of a conference.
+ * @param groupId Conference number.
+ * @param peers New peer list, indexed by peer number.
+ */
+void GroupPeerTable::setPeers(uint32_t groupId, Peers peers)
+{
+    Tables next = *load();
+    next.insert(groupId, std::make_shared<const Peers>(std::move(peers)));
+    publish(std::move(next));
+}
+
+/**
+ * @brief Update the name of a single peer.
+ * @return False if the conference or the peer is unknown.
+ */
+bool GroupPeerTable::setPeerName(uint32_t groupId, uint32_t peerId, const QString& name)
+{
+    const TablesPtr current = load();
+    const auto it = current->constFind(groupId);
+    if (it == current->constEnd() || peerId >= static_cast<uint32_t>((*it)->size())) {
+        return false;
+    }
+
+    Peers peers = **it;
+    peers[peerId].name = name;
+    setPeers(groupId, std::move(peers));
+    return true;
+}
+
+void GroupPeerTable::removeGroup(uint32_t groupId)
+{
+    Tables next = *load();
+    if (next.remove(groupId) > 0) {
+        publish(std::move(next));
+    }
+}
+
+void GroupPeerTable::clear()
+{
+    publish(Tables{});
+}
+
+GroupPeerTable::TablesPtr GroupPeerTable::load() const
+{
+    return std::atomic_load(&tables);
+}
+
+void GroupPeerTable::publish(Tables next)
+{
+    std::atomic_store(&tables, TablesPtr{std::make_shared<const Tables>(std::move(next))});
+}
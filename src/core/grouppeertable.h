@@ -0,0 +1,66 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GROUPPEERTABLE_H
+#define GROUPPEERTABLE_H
+
+#include "src/core/toxpk.h"
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <cstdint>
+#include <memory>
+
+struct GroupPeer
+{
+    ToxPk pk;
+    QString name;
+    uint32_t number;
+};
+
+class GroupPeerTable
+{
+public:
+    using Peers = QVector<GroupPeer>;
+    using PeersPtr = std::shared_ptr<const Peers>;
+
+    GroupPeerTable();
+
+    PeersPtr getPeers(uint32_t groupId) const;
+    bool hasGroup(uint32_t groupId) const;
+
+    void setPeers(uint32_t groupId, Peers peers);
+    bool setPeerName(uint32_t groupId, uint32_t peerId, const QString& name);
+    void removeGroup(uint32_t groupId);
+    void clear();
+
+private:
+    using Tables = QHash<uint32_t, PeersPtr>;
+    using TablesPtr = std::shared_ptr<const Tables>;
+
+    TablesPtr load() const;
+    void publish(Tables tables);
+
+private:
+    TablesPtr tables;
+};
+
+#endif // GROUPPEERTABLE_H
@@ -0,0 +1,221 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "outgoingmessagequeue.h"
+
+/**
+ * @class OutgoingMessageQueue
+ * @brief Per-friend queue of messages waiting to be handed to toxcore.
+ *
+ * Messages get a receipt when queued, so callers can track them before toxcore assigns its own
+ * message id. Once sent, the toxcore id is mapped back to that receipt when the friend confirms
+ * reception. At most MAX_IN_FLIGHT messages per friend are sent but unconfirmed; messages
+ * unconfirmed for longer than IN_FLIGHT_TIMEOUT_MS no longer count against that limit. Their
+ * receipts are still mapped, since a confirmation may arrive late over a slow relay, until the
+ * friend goes offline.
+ *
+ * Not thread safe, Core only accesses it with coreLoopLock held.
+ */
+
+/**
+ * @var OutgoingMessageQueue::MAX_IN_FLIGHT
+ * @brief Maximum number of sent but unconfirmed messages per friend.
+ */
+
+/**
+ * @var OutgoingMessageQueue::IN_FLIGHT_TIMEOUT_MS
+ * @brief Time after which an unconfirmed message stops blocking further sends.
+ */
+
+/**
+ * @brief Queue a message for sending.
+ * @param friendId Friend to send the message to.
+ * @param text Message text, must fit into a single toxcore message.
+ * @param isAction True to send the message as action.
+ * @return Receipt reported back by takeReadReceipts once the friend received the message,
+ * never 0.
+ */
+int OutgoingMessageQueue::enqueue(uint32_t friendId, const QString& text, bool isAction)
+{
+    if (++lastReceipt <= 0) {
+        lastReceipt = 1;
+    }
+
+    queues[friendId].pending.enqueue({lastReceipt, isAction, text});
+    return lastReceipt;
+}
+
+/**
+ * @brief Check if any friend has a message that can be sent now.
+ */
+bool OutgoingMessageQueue::hasSendable(qint64 now) const
+{
+    for (const FriendQueue& queue : queues) {
+        if (canSend(queue, now)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the friends that have a message that can be sent now.
+ */
+QVector<uint32_t> OutgoingMessageQueue::getSendableFriends(qint64 now) const
+{
+    QVector<uint32_t> friends;
+    for (auto it = queues.constBegin(); it != queues.constEnd(); ++it) {
+        if (canSend(it.value(), now)) {
+            friends.append(it.key());
+        }
+    }
+
+    return friends;
+}
+
+/**
+ * @brief Get the next message to send to a friend.
+ * @param friendId Friend to get the message for.
+ * @param now Current time in milliseconds.
+ * @param message Set to the next message on success.
+ * @return False if the queue is empty or too many messages are in flight.
+ */
+bool OutgoingMessageQueue::peek(uint32_t friendId, qint64 now, Message& message) const
+{
+    const auto it = queues.constFind(friendId);
+    if (it == queues.constEnd() || !canSend(it.value(), now)) {
+        return false;
+    }
+
+    message = it->pending.head();
+    return true;
+}
+
+/**
+ * @brief Remove the next message after toxcore accepted it.
+ * @param friendId Friend the message was sent to.
+ * @param messageId Message id assigned by toxcore.
+ * @param now Current time in milliseconds.
+ */
+void OutgoingMessageQueue::markSent(uint32_t friendId, uint32_t messageId, qint64 now)
+{
+    const auto it = queues.find(friendId);
+    if (it == queues.end() || it->pending.isEmpty()) {
+        return;
+    }
+
+    const Message message = it->pending.dequeue();
+    it->inFlight.insert(messageId, {message.receipt, now});
+}
+
+/**
+ * @brief Remove the next message after toxcore refused it for good.
+ */
+void OutgoingMessageQueue::dropFront(uint32_t friendId)
+{
+    const auto it = queues.find(friendId);
+    if (it == queues.end() || it->pending.isEmpty()) {
+        return;
+    }
+
+    it->pending.dequeue();
+    if (it->pending.isEmpty() && it->inFlight.isEmpty()) {
+        queues.erase(it);
+    }
+}
+
+/**
+ * @brief Record that a friend confirmed the reception of a message.
+ * @param friendId Friend that sent the read receipt.
+ * @param messageId Message id assigned by toxcore.
+ */
+void OutgoingMessageQueue::addReadReceipt(uint32_t friendId, uint32_t messageId)
+{
+    const auto it = queues.find(friendId);
+    if (it == queues.end()) {
+        return;
+    }
+
+    const auto inFlight = it->inFlight.find(messageId);
+    if (inFlight == it->inFlight.end()) {
+        return;
+    }
+
+    readReceipts[friendId].append(inFlight->receipt);
+    it->inFlight.erase(inFlight);
+    if (it->pending.isEmpty() && it->inFlight.isEmpty()) {
+        queues.erase(it);
+    }
+}
+
+/**
+ * @brief Get and forget all receipts confirmed since the last call.
+ * @return Receipts returned by enqueue, grouped by friend.
+ */
+QHash<uint32_t, QVector<int>> OutgoingMessageQueue::takeReadReceipts()
+{
+    QHash<uint32_t, QVector<int>> receipts;
+    receipts.swap(readReceipts);
+    return receipts;
+}
+
+/**
+ * @brief Forget all queued and in flight messages of a friend.
+ *
+ * Used when the friend goes offline or is removed, toxcore drops its pending messages then.
+ * Receipts already confirmed are still reported by takeReadReceipts.
+ */
+void OutgoingMessageQueue::clearFriend(uint32_t friendId)
+{
+    queues.remove(friendId);
+}
+
+/**
+ * @brief Number of messages queued for a friend but not yet sent.
+ */
+int OutgoingMessageQueue::getPendingCount(uint32_t friendId) const
+{
+    const auto it = queues.constFind(friendId);
+    return it == queues.constEnd() ? 0 : it->pending.size();
+}
+
+/**
+ * @brief Check if a friend has a message queued and fewer than MAX_IN_FLIGHT unexpired ones
+ * unconfirmed.
+ */
+bool OutgoingMessageQueue::canSend(const FriendQueue& queue, qint64 now)
+{
+    if (queue.pending.isEmpty()) {
+        return false;
+    }
+
+    if (queue.inFlight.size() < MAX_IN_FLIGHT) {
+        return true;
+    }
+
+    int active = 0;
+    for (const InFlight& message : queue.inFlight) {
+        if (now - message.sentAt < IN_FLIGHT_TIMEOUT_MS) {
+            ++active;
+        }
+    }
+
+    return active < MAX_IN_FLIGHT;
+}
@@ -0,0 +1,75 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OUTGOINGMESSAGEQUEUE_H
+#define OUTGOINGMESSAGEQUEUE_H
+
+#include <QHash>
+#include <QQueue>
+#include <QString>
+#include <QVector>
+
+#include <cstdint>
+
+class OutgoingMessageQueue
+{
+public:
+    struct Message
+    {
+        int receipt;
+        bool isAction;
+        QString text;
+    };
+
+    static constexpr int MAX_IN_FLIGHT = 16;
+    static constexpr qint64 IN_FLIGHT_TIMEOUT_MS = 30000;
+
+    int enqueue(uint32_t friendId, const QString& text, bool isAction);
+    bool hasSendable(qint64 now) const;
+    QVector<uint32_t> getSendableFriends(qint64 now) const;
+    bool peek(uint32_t friendId, qint64 now, Message& message) const;
+    void markSent(uint32_t friendId, uint32_t messageId, qint64 now);
+    void dropFront(uint32_t friendId);
+    void addReadReceipt(uint32_t friendId, uint32_t messageId);
+    QHash<uint32_t, QVector<int>> takeReadReceipts();
+    void clearFriend(uint32_t friendId);
+    int getPendingCount(uint32_t friendId) const;
+
+private:
+    struct InFlight
+    {
+        int receipt;
+        qint64 sentAt;
+    };
+
+    struct FriendQueue
+    {
+        QQueue<Message> pending;
+        QHash<uint32_t, InFlight> inFlight;
+    };
+
+    static bool canSend(const FriendQueue& queue, qint64 now);
+
+private:
+    QHash<uint32_t, FriendQueue> queues;
+    QHash<uint32_t, QVector<int>> readReceipts;
+    int lastReceipt = 0;
+};
+
+#endif // OUTGOINGMESSAGEQUEUE_H
@@ -0,0 +1,121 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "poweroftwohistogram.h"
+
+#include <QStringList>
+
+/**
+ * @class PowerOfTwoHistogram
+ * @brief Lock-free histogram with power of two buckets.
+ *
+ * Bucket 0 counts the value 0, bucket n counts values in [2^(n-1), 2^n) and the last bucket also
+ * counts everything larger. Adding a value is a single relaxed atomic increment, so any thread may
+ * add to or read from the histogram without locking.
+ */
+
+/**
+ * @var PowerOfTwoHistogram::MAX_BUCKET_COUNT
+ * @brief Largest supported number of buckets, the last one counts all values from 2^22 on.
+ */
+
+/**
+ * @param count Number of buckets, clamped to [1, MAX_BUCKET_COUNT].
+ */
+PowerOfTwoHistogram::PowerOfTwoHistogram(int count)
+    : bucketCount{count}
+{
+    if (bucketCount < 1) {
+        bucketCount = 1;
+    } else if (bucketCount > MAX_BUCKET_COUNT) {
+        bucketCount = MAX_BUCKET_COUNT;
+    }
+
+    reset();
+}
+
+int PowerOfTwoHistogram::getBucketCount() const
+{
+    return bucketCount;
+}
+
+/**
+ * @brief Get the bucket a value is counted in.
+ */
+int PowerOfTwoHistogram::bucketFor(uint64_t value) const
+{
+    int bucket = 0;
+    while (value > 0 && bucket < bucketCount - 1) {
+        value >>= 1;
+        ++bucket;
+    }
+
+    return bucket;
+}
+
+void PowerOfTwoHistogram::add(uint64_t value)
+{
+    buckets[bucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void PowerOfTwoHistogram::reset()
+{
+    for (std::atomic<uint64_t>& bucket : buckets) {
+        bucket = 0;
+    }
+}
+
+/**
+ * @brief Get a copy of the bucket counts.
+ */
+QVector<uint64_t> PowerOfTwoHistogram::getBuckets() const
+{
+    QVector<uint64_t> values;
+    values.reserve(bucketCount);
+    for (int i = 0; i < bucketCount; ++i) {
+        values.append(buckets[i].load(std::memory_order_relaxed));
+    }
+
+    return values;
+}
+
+/**
+ * @brief Human readable summary, listing only non-empty buckets by their lower bound.
+ */
+QString PowerOfTwoHistogram::toString() const
+{
+    const QVector<uint64_t> values = getBuckets();
+    QStringList list;
+    for (int i = 0; i < values.size(); ++i) {
+        if (values[i] > 0) {
+            list << QStringLiteral("%1+:%2").arg(getLowerBound(i)).arg(values[i]);
+        }
+    }
+
+    return list.join(' ');
+}
+
+/**
+ * @brief Get the smallest value counted in a bucket.
+ */
+uint64_t PowerOfTwoHistogram::getLowerBound(int bucket)
+{
+    return bucket == 0 ? 0 : (uint64_t{1} << (bucket - 1));
+}
@@ -0,0 +1,52 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef POWEROFTWOHISTOGRAM_H
+#define POWEROFTWOHISTOGRAM_H
+
+#include <QString>
+#include <QVector>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+class PowerOfTwoHistogram
+{
+public:
+    static constexpr int MAX_BUCKET_COUNT = 24;
+
+    explicit PowerOfTwoHistogram(int count = MAX_BUCKET_COUNT);
+
+    int getBucketCount() const;
+    int bucketFor(uint64_t value) const;
+    void add(uint64_t value);
+    void reset();
+    QVector<uint64_t> getBuckets() const;
+    QString toString() const;
+
+    static uint64_t getLowerBound(int bucket);
+
+private:
+    int bucketCount;
+    std::array<std::atomic<uint64_t>, MAX_BUCKET_COUNT> buckets;
+};
+
+#endif // POWEROFTWOHISTOGRAM_H
@@ -1,5 +1,6 @@
 #include "src/core/toxcall.h"
 #include "src/audio/audio.h"
+#include "src/audio/audiomixer.h"
 #include "src/core/coreav.h"
 #include "src/persistence/settings.h"
 #include "src/video/camerasource.h"
@@ -24,8 +25,14 @@
  * @var TOXAV_FRIEND_CALL_STATE ToxFriendCall::state
  * @brief State of the peer (not ours!)
  *
- * @var QMap ToxGroupCall::peers
- * @brief Keeps sources for users in group calls.
+ * @var std::unique_ptr<AudioMixer> ToxFriendCall::mixer
+ * @brief Plays the friend's audio through its jitter buffer.
+ *
+ * @var int ToxFriendCall::FRIEND_PEER
+ * @brief Peer number of the friend in the call's mixer.
+ *
+ * @var std::unique_ptr<AudioMixer> ToxGroupCall::mixer
+ * @brief Mixes the audio of all peers into the call's single output source.
  */
 
 ToxCall::ToxCall(bool VideoEnabled, CoreAV& av)
@@ -154,18 +161,9 @@ CoreVideoSource* ToxCall::getVideoSource() const
     return videoSource;
 }
 
-quint32 ToxFriendCall::getAlSource() const
-{
-    return alSource;
-}
-
-void ToxFriendCall::setAlSource(const quint32& value)
-{
-    alSource = value;
-}
-
 ToxFriendCall::ToxFriendCall(uint32_t FriendNum, bool VideoEnabled, CoreAV& av)
     : ToxCall(VideoEnabled, av)
+    , mixer{new AudioMixer}
 {
     // register audio
     Audio& audio = Audio::getInstance();
@@ -180,7 +178,9 @@ ToxFriendCall::ToxFriendCall(uint32_t FriendNum, bool VideoEnabled, CoreAV& av)
        qDebug() << "Audio input connection not working";
     }
 
-    audio.subscribeOutput(alSource);
+    // the friend is the only peer of the mixer, it provides the jitter buffering
+    mixer->addPeer(FRIEND_PEER);
+    audio.subscribeMixer(*mixer);
 
     // register video
     if (videoEnabled) {
@@ -203,24 +203,59 @@ ToxFriendCall::ToxFriendCall(uint32_t FriendNum, bool VideoEnabled, CoreAV& av)
 
 ToxFriendCall::ToxFriendCall(ToxFriendCall &&other) noexcept
     : ToxCall(std::move(other))
-    , alSource{other.alSource}
+    , mixer{std::move(other.mixer)}
 {
-    other.alSource = 0;
 }
 
 ToxFriendCall& ToxFriendCall::operator=(ToxFriendCall &&other) noexcept
 {
     ToxCall::operator=(std::move(other));
-    alSource = other.alSource;
-    other.alSource = 0;
+    if (mixer) {
+        Audio::getInstance().unsubscribeMixer(*mixer);
+    }
+    mixer = std::move(other.mixer);
 
     return *this;
 }
 
 ToxFriendCall::~ToxFriendCall()
 {
-    auto& audio = Audio::getInstance();
-    audio.unsubscribeOutput(alSource);
+    // the mixer was moved, it is unsubscribed by its new owner
+    if (!mixer) {
+        return;
+    }
+
+    AudioJitterBuffer::Stats stats;
+    if (mixer->getPeerStats(FRIEND_PEER, stats)) {
+        qDebug() << "Call audio: jitter" << stats.jitterMs << "ms, buffer" << stats.depthMs << "/"
+                 << stats.targetMs << "ms, underruns" << stats.underruns << ", concealed"
+                 << stats.concealed << ", late drops" << stats.lateDrops << ", overruns"
+                 << stats.overruns << ", stretched" << stats.stretched;
+    }
+
+    Audio::getInstance().unsubscribeMixer(*mixer);
+}
+
+/**
+ * @brief Queues a received audio frame in the call's jitter buffer.
+ *
+ * The call plays with the channel count the friend sends, so stereo audio isn't downmixed.
+ *
+ * @note Call from the ToxAV thread, only blocks on the audio thread when the friend's channel
+ * count changes.
+ */
+void ToxFriendCall::playAudio(const int16_t* data, size_t samples, unsigned channels,
+                              uint32_t sampleRate)
+{
+    if (channels != mixer->getChannels()) {
+        Audio& audio = Audio::getInstance();
+        audio.unsubscribeMixer(*mixer);
+        mixer.reset(new AudioMixer{channels});
+        mixer->addPeer(FRIEND_PEER);
+        audio.subscribeMixer(*mixer);
+    }
+
+    mixer->push(FRIEND_PEER, data, samples, channels, sampleRate);
 }
 
 void ToxFriendCall::startTimeout(uint32_t callId)
@@ -258,10 +293,12 @@ void ToxFriendCall::setState(const TOXAV_FRIEND_CALL_STATE& value)
 
 ToxGroupCall::ToxGroupCall(int GroupNum, CoreAV& av)
     : ToxCall(false, av)
+    , mixer{new AudioMixer}
 {
     // register audio
     Audio& audio = Audio::getInstance();
     audio.subscribeInput();
+    audio.subscribeMixer(*mixer);
     audioInConn = QObject::connect(&Audio::getInstance(), &Audio::frameAvailable,
     [&av, GroupNum](const int16_t* pcm, size_t samples, uint8_t chans,
             uint32_t rate) {
@@ -274,74 +311,60 @@ ToxGroupCall::ToxGroupCall(int GroupNum, CoreAV& av)
 }
 
 ToxGroupCall::ToxGroupCall(ToxGroupCall&& other) noexcept
-    : ToxCall(std::move(other)), peers{other.peers}
+    : ToxCall(std::move(other)), mixer{std::move(other.mixer)}
 {
-    // all peers were moved, this ensures audio output is unsubscribed only once
-    other.peers.clear();
 }
 
 ToxGroupCall::~ToxGroupCall()
 {
-    Audio& audio = Audio::getInstance();
-
-    for (quint32 v : peers) {
-        audio.unsubscribeOutput(v);
+    // the mixer was moved, it is unsubscribed by its new owner
+    if (mixer) {
+        Audio::getInstance().unsubscribeMixer(*mixer);
     }
 }
 
 ToxGroupCall& ToxGroupCall::operator=(ToxGroupCall&& other) noexcept
 {
     ToxCall::operator=(std::move(other));
-    peers = other.peers;
-    other.peers.clear();
+    if (mixer) {
+        Audio::getInstance().unsubscribeMixer(*mixer);
+    }
+    mixer = std::move(other.mixer);
 
     return *this;
 }
 
 void ToxGroupCall::removePeer(int peerId)
 {
-    auto& audio = Audio::getInstance();
-    const auto& sourceId = peers.find(peerId);
-    if(sourceId == peers.constEnd()) {
-        qDebug() << "Peer:" << peerId << "does not have a source, can't remove";
+    if (!mixer->hasPeer(peerId)) {
+        qDebug() << "Peer:" << peerId << "is not mixed, can't remove";
         return;
     }
 
-    audio.unsubscribeOutput(sourceId.value());
-    peers.remove(peerId);
+    mixer->removePeer(peerId);
 }
 
 void ToxGroupCall::addPeer(int peerId)
 {
-    auto& audio = Audio::getInstance();
-    uint sourceId = 0;
-    audio.subscribeOutput(sourceId);
-    peers.insert(peerId, sourceId);
+    mixer->addPeer(peerId);
 }
 
 bool ToxGroupCall::havePeer(int peerId)
 {
-    const auto& sourceId = peers.find(peerId);
-    return sourceId != peers.constEnd();
+    return mixer->hasPeer(peerId);
 }
 
 void ToxGroupCall::clearPeers()
 {
-    Audio& audio = Audio::getInstance();
-
-    for (quint32 v : peers) {
-        audio.unsubscribeOutput(v);
-    }
-
-    peers.clear();
+    mixer->clearPeers();
 }
 
-quint32 ToxGroupCall::getAlSource(int peer)
+/**
+ * @brief Queues a received audio frame of a peer for mixing.
+ * @note Call from the Tox thread, does not block on the audio thread.
+ */
+void ToxGroupCall::playPeerAudio(int peerId, const int16_t* data, unsigned samples,
+                                 unsigned channels, uint32_t sampleRate)
 {
-    if(!havePeer(peer)) {
-        qWarning() << "Getting alSource for non-existant peer";
-        return 0;
-    }
-
-    return peers[peer];
+    mixer->push(peerId, data, samples, channels, sampleRate);
 }
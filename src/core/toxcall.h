@@ -11,6 +11,7 @@
 
 class QTimer;
 class AudioFilterer;
+class AudioMixer;
 class CoreVideoSource;
 class CoreAV;
 
@@ -74,8 +75,7 @@ public:
     TOXAV_FRIEND_CALL_STATE getState() const;
     void setState(const TOXAV_FRIEND_CALL_STATE& value);
 
-    quint32 getAlSource() const;
-    void setAlSource(const quint32& value);
+    void playAudio(const int16_t* data, size_t samples, unsigned channels, uint32_t sampleRate);
 
 protected:
     std::unique_ptr<QTimer> timeoutTimer;
@@ -83,7 +83,8 @@ protected:
 private:
     TOXAV_FRIEND_CALL_STATE state{TOXAV_FRIEND_CALL_STATE_NONE};
     static constexpr int CALL_TIMEOUT = 45000;
-    quint32 alSource{0};
+    static constexpr int FRIEND_PEER = 0;
+    std::unique_ptr<AudioMixer> mixer;
 };
 
 class ToxGroupCall : public ToxCall
@@ -101,10 +102,11 @@ public:
     bool havePeer(int peerId);
     void clearPeers();
 
-    quint32 getAlSource(int peer);
+    void playPeerAudio(int peerId, const int16_t* data, unsigned samples, unsigned channels,
+                       uint32_t sampleRate);
 
 private:
-    QMap<int, quint32> peers;
+    std::unique_ptr<AudioMixer> mixer;
 
     // If you add something here, don't forget to override the ctors and move operators!
 };
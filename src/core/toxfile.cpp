@@ -1,4 +1,6 @@
 #include "src/core/toxfile.h"
+#include "src/core/filetransferio.h"
+#include <QCryptographicHash>
 #include <QFile>
 #include <QRegularExpression>
 #include <tox/tox.h>
@@ -32,10 +34,23 @@ ToxFile::ToxFile(uint32_t fileNum, uint32_t friendId, QString filename, QString
     , direction{Direction}
 {}
 
+/**
+ * @brief Check if both refer to the same transfer.
+ *
+ * A resumed transfer gets a new fileNum from toxcore but keeps its file ID, so the file ID is
+ * compared if both have one.
+ */
 bool ToxFile::operator==(const ToxFile& other) const
 {
-    return (fileNum == other.fileNum) && (friendId == other.friendId)
-           && (direction == other.direction);
+    if (friendId != other.friendId || direction != other.direction) {
+        return false;
+    }
+
+    if (!resumeFileId.isEmpty() && !other.resumeFileId.isEmpty()) {
+        return resumeFileId == other.resumeFileId;
+    }
+
+    return fileNum == other.fileNum;
 }
 
 bool ToxFile::operator!=(const ToxFile& other) const
@@ -51,5 +66,22 @@ void ToxFile::setFilePath(QString path)
 
 bool ToxFile::open(bool write)
 {
-    return write ? file->open(QIODevice::ReadWrite) : file->open(QIODevice::ReadOnly);
+    const bool opened =
+        write ? file->open(QIODevice::ReadWrite) : file->open(QIODevice::ReadOnly);
+    if (opened) {
+        io = std::make_shared<FileTransferIO>(file);
+    }
+
+    return opened;
+}
+
+/**
+ * @brief SHA-256 hash of the file data transferred so far.
+ *
+ * Computed by the transfer's FileTransferIO, it's the hash of the whole file once the transfer
+ * finished.
+ */
+QByteArray ToxFile::getHash() const
+{
+    return io ? io->getHash() : QCryptographicHash::hash(QByteArray{}, QCryptographicHash::Sha256);
 }
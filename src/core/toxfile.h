@@ -3,10 +3,11 @@
 
 #include "src/core/toxfilepause.h"
 
+#include <QByteArray>
 #include <QString>
 #include <memory>
-#include <QCryptographicHash>
 
+class FileTransferIO;
 class QFile;
 class QTimer;
 
@@ -41,6 +42,7 @@ struct ToxFile
 
     void setFilePath(QString path);
     bool open(bool write);
+    QByteArray getHash() const;
 
     uint8_t fileKind;
     uint32_t fileNum;
@@ -48,14 +50,28 @@ struct ToxFile
     QString fileName;
     QString filePath;
     std::shared_ptr<QFile> file;
+    // created by open, does all disk access of the transfer
+    std::shared_ptr<FileTransferIO> io;
     quint64 bytesSent;
     quint64 filesize;
     FileStatus status;
     FileDirection direction;
     QByteArray avatarData;
     QByteArray resumeFileId;
-    std::shared_ptr<QCryptographicHash> hashGenerator = std::make_shared<QCryptographicHash>(QCryptographicHash::Sha256);
     ToxFilePause pauseStatus;
+    // time of the last progress update, to limit the update rate
+    qint64 lastProgressUpdate = 0;
+};
+
+// Progress of a running transfer, cheap to copy through queued connections
+struct ToxFileProgressInfo
+{
+    uint32_t friendId;
+    uint32_t fileNum;
+    quint64 bytesSent;
+    quint64 filesize;
+    // measured over the last second
+    quint64 bytesPerSecond;
 };
 
 #endif // CORESTRUCTS_H
@@ -5,6 +5,8 @@
 #include <QByteArray>
 #include <QString>
 
+#include <cstring>
+
 /**
  * @class ToxPk
  * @brief This class represents a Tox Public Key, which is a part of Tox ID.
@@ -130,3 +132,24 @@ int ToxPk::getPkSize()
 {
     return TOX_PUBLIC_KEY_SIZE;
 }
+
+/**
+ * @brief Hash function for QHash and QSet.
+ * @param pk ToxPk to hash.
+ * @param seed Seed provided by the container.
+ * @return Hash of the key.
+ *
+ * Public keys are uniformly distributed, so the leading bytes are used directly instead of
+ * hashing the whole key.
+ */
+uint qHash(const ToxPk& pk, uint seed)
+{
+    const uint8_t* bytes = pk.getBytes();
+    if (bytes == nullptr) {
+        return seed;
+    }
+
+    uint hash;
+    memcpy(&hash, bytes, sizeof(hash));
+    return hash ^ seed;
+}
@@ -29,4 +29,6 @@ private:
     QByteArray key;
 };
 
+uint qHash(const ToxPk& pk, uint seed = 0);
+
 #endif // TOXPK_H
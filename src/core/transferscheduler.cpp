@@ -0,0 +1,269 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "transferscheduler.h"
+
+#include <QtGlobal>
+
+/**
+ * @class TransferScheduler
+ * @brief Decides when outgoing file transfers start and how fast they may send.
+ *
+ * Outgoing transfers are queued per friend and offered to the friend only while less than
+ * the configured number of them is running, files smaller than SMALL_FILE_SIZE go first.
+ * Avatars don't go through the scheduler. An optional upload limit per friend is enforced with
+ * a token bucket holding at most one second worth of data.
+ *
+ * The throughput of every transfer, incoming or outgoing, is measured over RATE_WINDOW_MS.
+ *
+ * Not thread safe, Core only accesses it with coreLoopLock held.
+ */
+
+/**
+ * @var TransferScheduler::DEFAULT_MAX_ACTIVE
+ * @brief Default number of outgoing transfers running at the same time per friend.
+ */
+
+/**
+ * @var TransferScheduler::SMALL_FILE_SIZE
+ * @brief Files smaller than this are offered before larger ones.
+ */
+
+/**
+ * @var TransferScheduler::RATE_WINDOW_MS
+ * @brief Time over which the throughput of a transfer is measured.
+ */
+
+/**
+ * @brief Set how many outgoing transfers may run at the same time per friend.
+ */
+void TransferScheduler::setMaxActive(int count)
+{
+    maxActive = qMax(1, count);
+}
+
+/**
+ * @brief Set the upload limit per friend.
+ * @param bytesPerSecond Limit, 0 for no limit.
+ */
+void TransferScheduler::setUploadLimit(quint64 bytesPerSecond)
+{
+    uploadLimit = bytesPerSecond;
+}
+
+/**
+ * @brief Queue an outgoing transfer until it may be offered to the friend.
+ */
+void TransferScheduler::enqueue(uint32_t friendId, uint32_t fileId, quint64 size)
+{
+    FriendState& state = friends[friendId];
+    if (size < SMALL_FILE_SIZE) {
+        state.small.enqueue(fileId);
+    } else {
+        state.large.enqueue(fileId);
+    }
+}
+
+/**
+ * @brief Get the friends with queued transfers that may start now.
+ */
+QVector<uint32_t> TransferScheduler::getWaitingFriends() const
+{
+    QVector<uint32_t> waiting;
+    for (auto it = friends.constBegin(); it != friends.constEnd(); ++it) {
+        const FriendState& state = it.value();
+        if (state.active < maxActive && !(state.small.isEmpty() && state.large.isEmpty())) {
+            waiting.append(it.key());
+        }
+    }
+
+    return waiting;
+}
+
+/**
+ * @brief Take the next queued transfer of a friend, if another one may start.
+ * @param fileId Set to the file number given to enqueue.
+ * @return False if nothing is queued or the friend has enough running transfers.
+ *
+ * Call start with the new file number once the transfer was offered.
+ */
+bool TransferScheduler::takeNext(uint32_t friendId, uint32_t& fileId)
+{
+    auto it = friends.find(friendId);
+    if (it == friends.end() || it->active >= maxActive) {
+        return false;
+    }
+
+    if (!it->small.isEmpty()) {
+        fileId = it->small.dequeue();
+    } else if (!it->large.isEmpty()) {
+        fileId = it->large.dequeue();
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Count an outgoing transfer as running, until finish is called.
+ */
+void TransferScheduler::start(uint32_t friendId, uint32_t fileId, qint64 now)
+{
+    Transfer& transfer = getTransfer(friendId, fileId, now);
+    if (!transfer.counted) {
+        transfer.counted = true;
+        ++friends[friendId].active;
+    }
+}
+
+/**
+ * @brief Forget a queued or running transfer.
+ * @return The final throughput stats of the transfer.
+ */
+TransferScheduler::Stats TransferScheduler::finish(uint32_t friendId, uint32_t fileId)
+{
+    const Transfer transfer = transfers.take(getKey(friendId, fileId));
+    auto it = friends.find(friendId);
+    if (it != friends.end()) {
+        it->small.removeOne(fileId);
+        it->large.removeOne(fileId);
+        if (transfer.counted) {
+            --it->active;
+        }
+
+        if (it->active == 0 && it->small.isEmpty() && it->large.isEmpty()) {
+            friends.erase(it);
+        }
+    }
+
+    return transfer.stats;
+}
+
+/**
+ * @brief Check if the upload limit allows sending more data to a friend now.
+ */
+bool TransferScheduler::canSend(uint32_t friendId, qint64 now)
+{
+    if (!uploadLimit) {
+        return true;
+    }
+
+    const auto it = friends.find(friendId);
+    // nothing was sent to this friend yet, so the bucket is full
+    if (it == friends.end()) {
+        return true;
+    }
+
+    FriendState& state = it.value();
+    const double limit = static_cast<double>(uploadLimit);
+    if (state.lastRefill < 0) {
+        state.budget = limit;
+    } else {
+        state.budget += limit * (now - state.lastRefill) / 1000.0;
+        state.budget = qMin(state.budget, limit);
+    }
+
+    state.lastRefill = now;
+    return state.budget > 0;
+}
+
+/**
+ * @brief Account data sent by an outgoing transfer.
+ */
+void TransferScheduler::addSent(uint32_t friendId, uint32_t fileId, quint64 bytes, qint64 now)
+{
+    addBytes(getTransfer(friendId, fileId, now), bytes, now);
+    if (!uploadLimit) {
+        return;
+    }
+
+    FriendState& state = friends[friendId];
+    if (state.lastRefill < 0) {
+        // the bucket was full before this
+        state.budget = static_cast<double>(uploadLimit);
+        state.lastRefill = now;
+    }
+
+    state.budget -= static_cast<double>(bytes);
+}
+
+/**
+ * @brief Account data received by an incoming transfer.
+ */
+void TransferScheduler::addReceived(uint32_t friendId, uint32_t fileId, quint64 bytes,
+                                    qint64 now)
+{
+    addBytes(getTransfer(friendId, fileId, now), bytes, now);
+}
+
+/**
+ * @brief Get the throughput stats of a transfer, zero for unknown transfers.
+ */
+TransferScheduler::Stats TransferScheduler::getStats(uint32_t friendId, uint32_t fileId) const
+{
+    return transfers.value(getKey(friendId, fileId)).stats;
+}
+
+/**
+ * @brief Number of outgoing transfers of a friend that are running.
+ */
+int TransferScheduler::getActiveCount(uint32_t friendId) const
+{
+    return friends.value(friendId).active;
+}
+
+/**
+ * @brief Number of outgoing transfers of a friend waiting to start.
+ */
+int TransferScheduler::getQueuedCount(uint32_t friendId) const
+{
+    const FriendState state = friends.value(friendId);
+    return state.small.size() + state.large.size();
+}
+
+uint64_t TransferScheduler::getKey(uint32_t friendId, uint32_t fileId)
+{
+    return (static_cast<uint64_t>(friendId) << 32) + fileId;
+}
+
+TransferScheduler::Transfer& TransferScheduler::getTransfer(uint32_t friendId, uint32_t fileId,
+                                                            qint64 now)
+{
+    const uint64_t key = getKey(friendId, fileId);
+    auto it = transfers.find(key);
+    if (it == transfers.end()) {
+        it = transfers.insert(key, {false, {0, now, 0}, now, 0});
+    }
+
+    return it.value();
+}
+
+void TransferScheduler::addBytes(Transfer& transfer, quint64 bytes, qint64 now)
+{
+    transfer.stats.bytes += bytes;
+    transfer.windowBytes += bytes;
+
+    const qint64 elapsed = now - transfer.windowStart;
+    if (elapsed >= RATE_WINDOW_MS) {
+        transfer.stats.bytesPerSecond = transfer.windowBytes * 1000 / static_cast<quint64>(elapsed);
+        transfer.windowStart = now;
+        transfer.windowBytes = 0;
+    }
+}
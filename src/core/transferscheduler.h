@@ -0,0 +1,89 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRANSFERSCHEDULER_H
+#define TRANSFERSCHEDULER_H
+
+#include <QHash>
+#include <QQueue>
+#include <QVector>
+
+#include <cstdint>
+
+class TransferScheduler
+{
+public:
+    struct Stats
+    {
+        quint64 bytes;
+        qint64 startTime;
+        quint64 bytesPerSecond;
+    };
+
+    static constexpr int DEFAULT_MAX_ACTIVE = 3;
+    static constexpr quint64 SMALL_FILE_SIZE = 1024 * 1024;
+    static constexpr qint64 RATE_WINDOW_MS = 1000;
+
+    void setMaxActive(int count);
+    void setUploadLimit(quint64 bytesPerSecond);
+
+    void enqueue(uint32_t friendId, uint32_t fileId, quint64 size);
+    QVector<uint32_t> getWaitingFriends() const;
+    bool takeNext(uint32_t friendId, uint32_t& fileId);
+    void start(uint32_t friendId, uint32_t fileId, qint64 now);
+    Stats finish(uint32_t friendId, uint32_t fileId);
+
+    bool canSend(uint32_t friendId, qint64 now);
+    void addSent(uint32_t friendId, uint32_t fileId, quint64 bytes, qint64 now);
+    void addReceived(uint32_t friendId, uint32_t fileId, quint64 bytes, qint64 now);
+    Stats getStats(uint32_t friendId, uint32_t fileId) const;
+    int getActiveCount(uint32_t friendId) const;
+    int getQueuedCount(uint32_t friendId) const;
+
+private:
+    struct Transfer
+    {
+        bool counted;
+        Stats stats;
+        qint64 windowStart;
+        quint64 windowBytes;
+    };
+
+    struct FriendState
+    {
+        QQueue<uint32_t> small;
+        QQueue<uint32_t> large;
+        int active = 0;
+        // token bucket of the upload limit
+        double budget = 0;
+        qint64 lastRefill = -1;
+    };
+
+    static uint64_t getKey(uint32_t friendId, uint32_t fileId);
+    Transfer& getTransfer(uint32_t friendId, uint32_t fileId, qint64 now);
+    static void addBytes(Transfer& transfer, quint64 bytes, qint64 now);
+
+private:
+    QHash<uint32_t, FriendState> friends;
+    QHash<uint64_t, Transfer> transfers;
+    int maxActive = DEFAULT_MAX_ACTIVE;
+    quint64 uploadLimit = 0;
+};
+
+#endif // TRANSFERSCHEDULER_H
@@ -103,13 +103,12 @@ void Group::regeneratePeerList()
 {
     const Core* core = Core::getInstance();
 
-    QStringList peers = core->getGroupPeerNames(groupId);
+    const GroupPeerTable::PeersPtr peers = core->getGroupPeers(groupId);
     toxpks.clear();
-    const int nPeers = peers.size();
-    for (int i = 0; i < nPeers; ++i) {
-        const auto pk = core->getGroupPeerPk(groupId, i);
+    for (const GroupPeer& peer : *peers) {
+        const ToxPk& pk = peer.pk;
 
-        toxpks[pk] = peers[i];
+        toxpks[pk] = peer.name;
         if (toxpks[pk].isEmpty()) {
             toxpks[pk] =
                 tr("<Empty>", "Placeholder when someone's name in a group chat is empty");
@@ -20,21 +20,39 @@
 
 #include "avatarbroadcaster.h"
 #include "src/core/core.h"
+#include "src/persistence/settings.h"
 #include <QDebug>
 #include <QObject>
+#include <QTimer>
 
 /**
  * @class AvatarBroadcaster
  *
  * Takes care of broadcasting avatar changes to our friends in a smart way
- * Cache a copy of our current avatar and friends who have received it
- * so we don't spam avatar transfers to a friend who already has it.
+ * Cache a copy of our current avatar and remember the avatar hash each friend received,
+ * so we don't spam avatar transfers to a friend who already has it, even after a restart.
+ *
+ * Avatars are sent one at a time from a queue, spread out by SEND_INTERVAL_MS and with at most
+ * MAX_ACTIVE_SENDS transfers running at once, so changing our avatar with many friends online
+ * doesn't take up the whole upload bandwidth. A transfer the friend doesn't finish within
+ * SEND_TIMEOUT_MS is cancelled, so it can't hold its slot forever.
  */
 
+namespace {
+const int SEND_INTERVAL_MS = 100;
+const int MAX_ACTIVE_SENDS = 4;
+const int SEND_TIMEOUT_MS = 60000;
+} // namespace
+
 QByteArray AvatarBroadcaster::avatarData;
-QMap<uint32_t, bool> AvatarBroadcaster::friendsSentTo;
+QByteArray AvatarBroadcaster::avatarHash;
+QQueue<uint32_t> AvatarBroadcaster::queue;
+QSet<uint32_t> AvatarBroadcaster::queued;
+QHash<uint32_t, AvatarBroadcaster::ActiveSend> AvatarBroadcaster::sending;
+quint64 AvatarBroadcaster::nextSendId = 0;
 
 static QMetaObject::Connection autoBroadcastConn;
+static QMetaObject::Connection avatarSentConn;
 static auto autoBroadcast = [](uint32_t friendId, Status) {
     AvatarBroadcaster::sendAvatarTo(friendId);
 };
@@ -45,11 +63,17 @@ static auto autoBroadcast = [](uint32_t friendId, Status) {
  */
 void AvatarBroadcaster::setAvatar(QByteArray data)
 {
-    if (avatarData == data)
+    QObject::disconnect(avatarSentConn);
+    avatarSentConn = QObject::connect(Core::getInstance(), &Core::avatarSendFinished, getTimer(),
+                                      &AvatarBroadcaster::onAvatarSent);
+
+    if (avatarData == data && !avatarHash.isEmpty())
         return;
 
     avatarData = data;
-    friendsSentTo.clear();
+    avatarHash = QByteArray(TOX_HASH_LENGTH, 0);
+    tox_hash(reinterpret_cast<uint8_t*>(avatarHash.data()),
+             reinterpret_cast<const uint8_t*>(avatarData.constData()), avatarData.size());
 
     QVector<uint32_t> friends = Core::getInstance()->getFriendList();
     for (uint32_t friendId : friends)
@@ -57,17 +81,18 @@ void AvatarBroadcaster::setAvatar(QByteArray data)
 }
 
 /**
- * @brief Send our current avatar to this friend, if not already sent
+ * @brief Queue our current avatar for this friend, if they don't have it yet
  * @param friendId Id of friend to send avatar.
  */
 void AvatarBroadcaster::sendAvatarTo(uint32_t friendId)
 {
-    if (friendsSentTo.contains(friendId) && friendsSentTo[friendId])
+    if (queued.contains(friendId) || !needsAvatar(friendId))
         return;
-    if (!Core::getInstance()->isFriendOnline(friendId))
-        return;
-    Core::getInstance()->sendAvatarFile(friendId, avatarData);
-    friendsSentTo[friendId] = true;
+
+    queue.enqueue(friendId);
+    queued.insert(friendId);
+    if (!getTimer()->isActive() && sending.size() < MAX_ACTIVE_SENDS)
+        getTimer()->start();
 }
 
 /**
@@ -78,6 +103,106 @@ void AvatarBroadcaster::enableAutoBroadcast(bool state)
 {
     QObject::disconnect(autoBroadcastConn);
     if (state)
-        autoBroadcastConn =
-            QObject::connect(Core::getInstance(), &Core::friendStatusChanged, autoBroadcast);
+        autoBroadcastConn = QObject::connect(Core::getInstance(), &Core::friendStatusChanged,
+                                             getTimer(), autoBroadcast);
+}
+
+/**
+ * @brief Check if our current avatar should be sent to this friend.
+ * @param friendId Id of friend to check.
+ * @return True if the friend is online and didn't receive it yet.
+ */
+bool AvatarBroadcaster::needsAvatar(uint32_t friendId)
+{
+    const Core* core = Core::getInstance();
+    if (!core->isFriendOnline(friendId))
+        return false;
+
+    const ToxPk friendPk = core->getFriendPublicKey(friendId);
+    return Settings::getInstance().getSentAvatarHash(friendPk) != avatarHash;
+}
+
+/**
+ * @brief Start the next queued avatar transfer, called by the timer.
+ */
+void AvatarBroadcaster::sendNext()
+{
+    while (!queue.isEmpty()) {
+        if (sending.size() >= MAX_ACTIVE_SENDS) {
+            // restarted by onAvatarSent
+            getTimer()->stop();
+            return;
+        }
+
+        const uint32_t friendId = queue.dequeue();
+        queued.remove(friendId);
+        // a running transfer is checked again once it's done
+        if (sending.contains(friendId) || !needsAvatar(friendId))
+            continue;
+
+        const quint64 sendId = nextSendId++;
+        sending.insert(friendId, {avatarHash, sendId});
+        QTimer::singleShot(SEND_TIMEOUT_MS, getTimer(),
+                           [friendId, sendId] { onSendTimeout(friendId, sendId); });
+        Core::getInstance()->sendAvatarFile(friendId, avatarData);
+        return;
+    }
+
+    getTimer()->stop();
+}
+
+/**
+ * @brief Remember that a friend received our avatar, and send the next one.
+ * @param friendId Id of friend the avatar was sent to.
+ * @param delivered False if the transfer failed or was interrupted.
+ */
+void AvatarBroadcaster::onAvatarSent(uint32_t friendId, bool delivered)
+{
+    const QByteArray sentHash = sending.take(friendId).hash;
+    if (delivered && !sentHash.isEmpty()) {
+        // marks the setting dirty, it's written with the next personal settings save
+        const Core* core = Core::getInstance();
+        Settings::getInstance().setSentAvatarHash(core->getFriendPublicKey(friendId), sentHash);
+    }
+
+    // our avatar may have changed in the meantime
+    if (sentHash != avatarHash)
+        sendAvatarTo(friendId);
+
+    if (!queue.isEmpty() && !getTimer()->isActive())
+        getTimer()->start();
+}
+
+/**
+ * @brief Cancel a transfer the friend didn't finish in time, and send the next one.
+ * @param friendId Id of friend the avatar is sent to.
+ * @param sendId Id of the transfer, to ignore the timeout of an earlier one.
+ *
+ * The friend isn't queued again, they get our avatar when they come online the next time.
+ */
+void AvatarBroadcaster::onSendTimeout(uint32_t friendId, quint64 sendId)
+{
+    // the transfer may have finished, or a newer one was started since
+    auto it = sending.find(friendId);
+    if (it == sending.end() || it->id != sendId)
+        return;
+
+    qWarning() << "Avatar transfer to friend" << friendId << "timed out";
+    sending.erase(it);
+    Core::getInstance()->cancelAvatarSend(friendId);
+
+    if (!queue.isEmpty() && !getTimer()->isActive())
+        getTimer()->start();
+}
+
+QTimer* AvatarBroadcaster::getTimer()
+{
+    static QTimer* timer = nullptr;
+    if (!timer) {
+        timer = new QTimer;
+        timer->setInterval(SEND_INTERVAL_MS);
+        QObject::connect(timer, &QTimer::timeout, &AvatarBroadcaster::sendNext);
+    }
+
+    return timer;
 }
@@ -22,7 +22,11 @@
 #define AVATARBROADCASTER_H
 
 #include <QByteArray>
-#include <QMap>
+#include <QHash>
+#include <QQueue>
+#include <QSet>
+
+class QTimer;
 
 class AvatarBroadcaster
 {
@@ -35,8 +39,25 @@ public:
     static void enableAutoBroadcast(bool state = true);
 
 private:
+    static bool needsAvatar(uint32_t friendId);
+    static void sendNext();
+    static void onAvatarSent(uint32_t friendId, bool delivered);
+    static void onSendTimeout(uint32_t friendId, quint64 sendId);
+    static QTimer* getTimer();
+
+private:
+    struct ActiveSend
+    {
+        QByteArray hash;
+        quint64 id;
+    };
+
     static QByteArray avatarData;
-    static QMap<uint32_t, bool> friendsSentTo;
+    static QByteArray avatarHash;
+    static QQueue<uint32_t> queue;
+    static QSet<uint32_t> queued;
+    static QHash<uint32_t, ActiveSend> sending;
+    static quint64 nextSendId;
 };
 
 #endif // AVATARBROADCASTER_H
@@ -20,6 +20,7 @@
 
 #include "nexus.h"
 #include "persistence/settings.h"
+#include "src/chatlog/filetransferregistry.h"
 #include "src/core/core.h"
 #include "src/core/coreav.h"
 #include "src/model/groupinvite.h"
@@ -96,10 +97,12 @@ void Nexus::start()
     qRegisterMetaType<ToxAV*>("ToxAV*");
     qRegisterMetaType<ToxFile>("ToxFile");
     qRegisterMetaType<ToxFile::FileDirection>("ToxFile::FileDirection");
+    qRegisterMetaType<ToxFileProgressInfo>("ToxFileProgressInfo");
     qRegisterMetaType<std::shared_ptr<VideoFrame>>("std::shared_ptr<VideoFrame>");
     qRegisterMetaType<ToxPk>("ToxPk");
     qRegisterMetaType<ToxId>("ToxId");
     qRegisterMetaType<GroupInvite>("GroupInvite");
+    qRegisterMetaType<QVector<int>>("QVector<int>");
 
     qApp->setQuitOnLastWindowClosed(false);
 
@@ -213,6 +216,8 @@ void Nexus::showMainGUI()
     connect(core, &Core::friendTypingChanged, widget, &Widget::onFriendTypingChanged);
     connect(core, &Core::messageSentResult, widget, &Widget::onMessageSendResult);
     connect(core, &Core::groupSentFailed, widget, &Widget::onGroupSendFailed);
+    connect(core, &Core::fileTransferProgress, &FileTransferRegistry::getInstance(),
+            &FileTransferRegistry::onFileTransferProgress);
 
     connect(widget, &Widget::statusSet, core, &Core::setStatus);
     connect(widget, &Widget::friendRequested, core, &Core::requestFriendship);
@@ -337,6 +337,35 @@ RawDatabase::Query History::generateFileFinished(int64_t id, bool success, const
     }
 }
 
+/**
+ * @brief Marks a file transfer as finished that was added in an earlier session.
+ *
+ * Resumed transfers keep their file ID, so the latest entry with that ID is updated.
+ */
+RawDatabase::Query History::generateResumedFileFinished(const QString& fileId, bool success,
+                                                        const QString& filePath,
+                                                        const QByteArray& fileHash)
+{
+    auto file_state = success ? ToxFile::FINISHED : ToxFile::CANCELED;
+    const QString latest = QStringLiteral("(SELECT id FROM file_transfers "
+                                          "WHERE file_restart_id = ? ORDER BY id DESC LIMIT 1)");
+    if (filePath.length()) {
+        return RawDatabase::Query(QStringLiteral("UPDATE file_transfers "
+                                                 "SET file_state = %1, file_path = ?, "
+                                                 "file_hash = ? WHERE id = %2")
+                                      .arg(file_state)
+                                      .arg(latest),
+                                  {filePath.toUtf8(), fileHash, fileId.toUtf8()});
+    } else {
+        return RawDatabase::Query(QStringLiteral("UPDATE file_transfers "
+                                                 "SET file_state = %1 "
+                                                 "WHERE id = %2")
+                                      .arg(file_state)
+                                      .arg(latest),
+                                  {fileId.toUtf8()});
+    }
+}
+
 void History::addNewFileMessage(const QString& friendPk, const QString& fileId,
                                 const QString& fileName, const QString& filePath, int64_t size,
                                 const QString& sender, const QDateTime& time, QString const& dispName)
@@ -370,6 +399,9 @@ void History::addNewFileMessage(const QString& friendPk, const QString& fileId,
     insertionData.size = size;
     insertionData.direction = direction;
 
+    // known from now on, so finishing it before it's inserted is remembered
+    fileInfos.insert(fileId, FileInfo{});
+
     auto insertFileTransferFn = [weakThis, insertionData](int64_t messageId) {
         auto insertionDataRw = std::move(insertionData);
 
@@ -412,17 +444,24 @@ void History::addNewMessage(const QString& friendPk, const QString& message, con
 void History::setFileFinished(const QString& fileId, bool success, const QString& filePath,
                               const QByteArray& fileHash)
 {
-    auto& fileInfo = fileInfos[fileId];
-    if (fileInfo.fileId == -1) {
-        fileInfo.finished = true;
-        fileInfo.success = success;
-        fileInfo.filePath = filePath;
-        fileInfo.fileHash = fileHash;
-    } else {
-        db->execLater(generateFileFinished(fileInfo.fileId, success, filePath, fileHash));
+    const auto it = fileInfos.find(fileId);
+    if (it == fileInfos.end()) {
+        // not added in this session, e.g. a transfer resumed after a restart
+        db->execLater(generateResumedFileFinished(fileId, success, filePath, fileHash));
+        return;
+    }
+
+    if (it->fileId == -1) {
+        // finished once onFileInserted knows its id
+        it->finished = true;
+        it->success = success;
+        it->filePath = filePath;
+        it->fileHash = fileHash;
+        return;
     }
 
-    fileInfos.remove(fileId);
+    db->execLater(generateFileFinished(it->fileId, success, filePath, fileHash));
+    fileInfos.erase(it);
 }
 /**
  * @brief Fetches chat messages from the database.
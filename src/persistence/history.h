@@ -199,6 +199,9 @@ private:
 
     static RawDatabase::Query generateFileFinished(int64_t fileId, bool success,
                                                    const QString& filePath, const QByteArray& fileHash);
+    static RawDatabase::Query generateResumedFileFinished(const QString& fileId, bool success,
+                                                          const QString& filePath,
+                                                          const QByteArray& fileHash);
     void dbSchemaUpgrade();
 
     std::shared_ptr<RawDatabase> db;
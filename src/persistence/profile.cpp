@@ -31,11 +31,13 @@
 #include "profile.h"
 #include "profilelocker.h"
 #include "settings.h"
+#include "src/chatlog/thumbnailcache.h"
 #include "src/core/core.h"
 #include "src/core/corefile.h"
 #include "src/net/avatarbroadcaster.h"
 #include "src/nexus.h"
 #include "src/widget/gui.h"
+#include "src/widget/tool/avatarcache.h"
 #include "src/widget/tool/identicon.h"
 #include "src/widget/widget.h"
 
@@ -48,6 +50,9 @@
  *
  * @var bool Profile::isRemoved
  * @brief True if the profile has been removed by remove().
+ *
+ * @var QHash<ToxPk, CachedAvatar> Profile::avatarCache
+ * @brief Avatars read from disk or set since, with their tox hash and the decoded picture.
  */
 
 QStringList Profile::profiles;
@@ -105,6 +110,7 @@ Profile::Profile(QString name, const QString& password, bool isNewProfile, const
     s.saveGlobal();
 
     initCore(toxsave, s, isNewProfile);
+    connect(&AvatarCache::getInstance(), &AvatarCache::avatarLoaded, this, &Profile::avatarLoaded);
 
     const ToxId& selfId = core->getSelfId();
     loadDatabase(selfId, password);
@@ -186,6 +192,7 @@ Profile* Profile::loadProfile(QString name, const QString& password)
         p->encrypted = true;
     }
 
+    p->updateThumbnailCache();
     return p;
 
 // cleanup in case of error
@@ -236,15 +243,20 @@ Profile* Profile::createProfile(QString name, QString password)
         p->encrypted = true;
     }
 
+    p->updateThumbnailCache();
     return p;
 }
 
 Profile::~Profile()
 {
     if (!isRemoved && core->isReady()) {
+        core->suspendFileTransfers();
         onSaveToxSave();
     }
 
+    AvatarCache::getInstance().clear();
+    ThumbnailCache::getInstance().setCacheDir(QString{});
+
     if (!isRemoved) {
         Settings::getInstance().savePersonal(this);
         Settings::getInstance().sync();
@@ -433,21 +445,45 @@ QPixmap Profile::loadAvatar()
  */
 QPixmap Profile::loadAvatar(const ToxPk& owner)
 {
-    QPixmap pic;
-    if (Settings::getInstance().getShowIdenticons()) {
-
-        const QByteArray avatarData = loadAvatarData(owner);
-        if (avatarData.isEmpty()) {
-            pic = QPixmap::fromImage(Identicon(owner.getKey()).toImage(16));
-        } else {
-            pic.loadFromData(avatarData);
+    CachedAvatar& avatar = getCachedAvatar(owner);
+    if (avatar.data.isEmpty()) {
+        if (Settings::getInstance().getShowIdenticons()) {
+            return QPixmap::fromImage(Identicon(owner.getKey()).toImage(16));
         }
 
-    } else {
-        pic.loadFromData(loadAvatarData(owner));
+        return QPixmap{};
     }
 
-    return pic;
+    if (avatar.pixmap.isNull()) {
+        avatar.pixmap.loadFromData(avatar.data);
+    }
+
+    return avatar.pixmap;
+}
+
+/**
+ * @brief Get a contact's avatar scaled to the size it's shown in.
+ * @param owner Friend PK to load avatar.
+ * @param size Size the avatar is scaled to fit into.
+ * @return The avatar if it's cached, a null pixmap otherwise. It's read and decoded in the
+ * background then and delivered by avatarLoaded.
+ */
+QPixmap Profile::loadAvatar(const ToxPk& owner, const QSize& size)
+{
+    const bool identicon = Settings::getInstance().getShowIdenticons();
+    AvatarCache& cache = AvatarCache::getInstance();
+    auto it = avatarCache.constFind(owner);
+    if (it != avatarCache.constEnd()) {
+        const QByteArray data = it->data;
+        return cache.getAvatar(owner, [data] { return data; }, identicon, size);
+    }
+
+    // AvatarCache::clear waits for the loader before the passkey is changed or released
+    const QString path = avatarPath(owner);
+    const QString plainPath = avatarPath(owner, true);
+    const ToxEncrypt* key = encrypted ? passkey.get() : nullptr;
+    auto load = [path, plainPath, key] { return readAvatarFile(path, plainPath, key); };
+    return cache.getAvatar(owner, load, identicon, size);
 }
 
 /**
@@ -457,12 +493,34 @@ QPixmap Profile::loadAvatar(const ToxPk& owner)
  */
 QByteArray Profile::loadAvatarData(const ToxPk& owner)
 {
-    QString path = avatarPath(owner);
-    bool avatarEncrypted = encrypted;
+    return getCachedAvatar(owner).data;
+}
+
+/**
+ * @brief Read a contact's avatar from disk, decrypting it if needed.
+ * @param owner Friend PK to load avatar.
+ * @return Avatar as QByteArray, empty if there is none.
+ */
+QByteArray Profile::readAvatarFile(const ToxPk& owner)
+{
+    return readAvatarFile(avatarPath(owner), avatarPath(owner, true),
+                          encrypted ? passkey.get() : nullptr);
+}
+
+/**
+ * @brief Read an avatar from disk, decrypting it if needed. Safe to call from any thread.
+ * @param path Path to the avatar.
+ * @param plainPath Path to the unencrypted avatar, used if an encrypted one isn't found.
+ * @param key Key to decrypt the avatar with, nullptr if the profile isn't encrypted.
+ * @return Avatar as QByteArray, empty if there is none.
+ */
+QByteArray Profile::readAvatarFile(QString path, const QString& plainPath, const ToxEncrypt* key)
+{
+    bool avatarEncrypted = key != nullptr;
     // If the encrypted avatar isn't found, try loading the unencrypted one for the same ID
     if (avatarEncrypted && !QFile::exists(path)) {
         avatarEncrypted = false;
-        path = avatarPath(owner, true);
+        path = plainPath;
     }
 
     QFile file(path);
@@ -472,7 +530,7 @@ QByteArray Profile::loadAvatarData(const ToxPk& owner)
 
     QByteArray pic = file.readAll();
     if (avatarEncrypted && !pic.isEmpty()) {
-        pic = passkey->decrypt(pic);
+        pic = key->decrypt(pic);
         if (pic.isEmpty()) {
             qWarning() << "Failed to decrypt avatar at" << path;
         }
@@ -481,6 +539,35 @@ QByteArray Profile::loadAvatarData(const ToxPk& owner)
     return pic;
 }
 
+/**
+ * @brief Get a contact's avatar from the memory cache, reading it from disk on first use.
+ * @param owner Friend PK to load avatar.
+ * @return Cache entry of the avatar, the picture is only decoded by loadAvatar.
+ */
+Profile::CachedAvatar& Profile::getCachedAvatar(const ToxPk& owner)
+{
+    auto it = avatarCache.find(owner);
+    if (it == avatarCache.end()) {
+        cacheAvatar(owner, readAvatarFile(owner));
+        it = avatarCache.find(owner);
+    }
+
+    return *it;
+}
+
+/**
+ * @brief Replace a contact's avatar in the memory cache.
+ * @param owner Friend PK of the avatar.
+ * @param avatar Avatar data, empty if there is none.
+ */
+void Profile::cacheAvatar(const ToxPk& owner, const QByteArray& avatar)
+{
+    QByteArray avatarHash(TOX_HASH_LENGTH, 0);
+    tox_hash(reinterpret_cast<uint8_t*>(avatarHash.data()),
+             reinterpret_cast<const uint8_t*>(avatar.constData()), avatar.size());
+    avatarCache.insert(owner, {avatar, avatarHash, QPixmap{}});
+}
+
 void Profile::loadDatabase(const ToxId& id, QString password)
 {
     if (isRemoved) {
@@ -581,12 +668,15 @@ void Profile::onRequestSent(const ToxPk& friendPk, const QString& message)
 }
 
 /**
- * @brief Save an avatar to cache.
+ * @brief Save an avatar to cache and disk.
  * @param pic Picture to save.
  * @param owner PK of avatar owner.
  */
 void Profile::saveAvatar(const ToxPk& owner, const QByteArray& avatar)
 {
+    cacheAvatar(owner, avatar);
+    AvatarCache::getInstance().invalidate(owner);
+
     const bool needEncrypt = encrypted && !avatar.isEmpty();
     const QByteArray& pic = needEncrypt ? passkey->encrypt(avatar) : avatar;
 
@@ -612,10 +702,7 @@ void Profile::saveAvatar(const ToxPk& owner, const QByteArray& avatar)
  */
 QByteArray Profile::getAvatarHash(const ToxPk& owner)
 {
-    QByteArray pic = loadAvatarData(owner);
-    QByteArray avatarHash(TOX_HASH_LENGTH, 0);
-    tox_hash((uint8_t*)avatarHash.data(), (uint8_t*)pic.data(), pic.size());
-    return avatarHash;
+    return getCachedAvatar(owner).hash;
 }
 
 /**
@@ -742,6 +829,13 @@ QStringList Profile::remove()
         qWarning() << "Could not remove file " << profileConfig.fileName();
     }
 
+    ThumbnailCache::getInstance().setCacheDir(QString{});
+    QDir thumbnailDir{getThumbnailDir(name)};
+    if (!thumbnailDir.removeRecursively()) {
+        ret.push_back(thumbnailDir.path());
+        qWarning() << "Could not remove folder " << thumbnailDir.path();
+    }
+
     QString dbPath = getDbPath(name);
     if (database && database->isOpen() && !database->remove() && QFile::exists(dbPath)) {
         ret.push_back(dbPath);
@@ -774,6 +868,8 @@ bool Profile::rename(QString newName)
         database->rename(newName);
     }
 
+    QDir{Settings::getInstance().getSettingsDirPath() + "thumbnails"}.rename(name, newName);
+
     bool resetAutorun = Settings::getInstance().getAutorun();
     Settings::getInstance().setAutorun(false);
     Settings::getInstance().setCurrentProfile(newName);
@@ -782,6 +878,7 @@ bool Profile::rename(QString newName)
     }
 
     name = newName;
+    updateThumbnailCache();
     return true;
 }
 
@@ -836,7 +933,8 @@ QString Profile::setPassword(const QString& newPassword)
             return tr(
                 "Failed to derive key from password, the profile won't use the new password.");
         }
-        // apply change
+        // apply change, avatars being loaded may still use the old key
+        AvatarCache::getInstance().clear();
         passkey = std::move(newpasskey);
         encrypted = true;
     }
@@ -858,6 +956,7 @@ QString Profile::setPassword(const QString& newPassword)
     }
 
     Nexus::getDesktopGUI()->reloadHistory();
+    updateThumbnailCache();
 
     QByteArray avatar = loadAvatarData(core->getSelfId().getPublicKey());
     saveAvatar(core->getSelfId().getPublicKey(), avatar);
@@ -880,3 +979,30 @@ QString Profile::getDbPath(const QString& profileName)
 {
     return Settings::getInstance().getSettingsDirPath() + profileName + ".db";
 }
+
+/**
+ * @brief Retrieves the path to the image thumbnail cache of a given profile.
+ * @param profileName Profile name.
+ * @return Path to the folder, ending with a separator.
+ */
+QString Profile::getThumbnailDir(const QString& profileName)
+{
+    return Settings::getInstance().getSettingsDirPath() + "thumbnails/" + profileName + "/";
+}
+
+/**
+ * @brief Stores image thumbnails in the folder of this profile.
+ *
+ * Encrypted profiles keep them in memory only, thumbnails stored before the profile was encrypted
+ * are deleted.
+ */
+void Profile::updateThumbnailCache()
+{
+    const QString dir = getThumbnailDir(name);
+    if (encrypted) {
+        ThumbnailCache::getInstance().setCacheDir(QString{});
+        QDir{dir}.removeRecursively();
+    } else {
+        ThumbnailCache::getInstance().setCacheDir(dir);
+    }
+}
@@ -28,6 +28,7 @@
 #include "src/persistence/history.h"
 
 #include <QByteArray>
+#include <QHash>
 #include <QObject>
 #include <QPixmap>
 #include <QString>
@@ -54,6 +55,7 @@ public:
 
     QPixmap loadAvatar();
     QPixmap loadAvatar(const ToxPk& owner);
+    QPixmap loadAvatar(const ToxPk& owner, const QSize& size);
     QByteArray loadAvatarData(const ToxPk& owner);
     void setAvatar(QByteArray pic);
     void setFriendAvatar(const ToxPk& owner, QByteArray pic);
@@ -73,6 +75,7 @@ public:
     static bool exists(QString name);
     static bool isEncrypted(QString name);
     static QString getDbPath(const QString& profileName);
+    static QString getThumbnailDir(const QString& profileName);
 
 signals:
     void selfAvatarChanged(const QPixmap& pixmap);
@@ -82,6 +85,8 @@ signals:
     void friendAvatarSet(const ToxPk& friendPk, const QPixmap& pixmap);
     // emit on set to default, used by those that modify on active
     void friendAvatarRemoved(const ToxPk& friendPk);
+    // emit when an avatar requested by size was decoded in the background
+    void avatarLoaded(const ToxPk& owner, const QPixmap& pixmap, const QSize& size);
     // TODO(sudden6): this doesn't seem to be the right place for Core errors
     void failedToStart();
     void badProxy();
@@ -98,11 +103,23 @@ private slots:
     void onAvatarOfferReceived(uint32_t friendId, uint32_t fileId, const QByteArray& avatarHash);
 
 private:
+    struct CachedAvatar
+    {
+        QByteArray data;
+        QByteArray hash;
+        QPixmap pixmap;
+    };
+
     Profile(QString name, const QString& password, bool newProfile, const QByteArray& toxsave);
     static QStringList getFilesByExt(QString extension);
     QString avatarPath(const ToxPk& owner, bool forceUnencrypted = false);
+    QByteArray readAvatarFile(const ToxPk& owner);
+    static QByteArray readAvatarFile(QString path, const QString& plainPath, const ToxEncrypt* key);
+    CachedAvatar& getCachedAvatar(const ToxPk& owner);
+    void cacheAvatar(const ToxPk& owner, const QByteArray& avatar);
     bool saveToxSave(QByteArray data);
     void initCore(const QByteArray& toxsave, ICoreSettings& s, bool isNewProfile);
+    void updateThumbnailCache();
 
 private:
     std::unique_ptr<Core> core = nullptr;
@@ -110,6 +127,7 @@ private:
     std::unique_ptr<ToxEncrypt> passkey = nullptr;
     std::shared_ptr<RawDatabase> database;
     std::shared_ptr<History> history;
+    QHash<ToxPk, CachedAvatar> avatarCache;
     bool isRemoved;
     bool encrypted = false;
     static QStringList profiles;
@@ -45,6 +45,9 @@
 #include <QStandardPaths>
 #include <QStyleFactory>
 #include <QThread>
+#include <QTimer>
+
+#include <atomic>
 
 /**
  * @var QHash<QString, QByteArray> Settings::widgetSettings
@@ -57,6 +60,23 @@
  * @brief Toxme info like name@server
  */
 
+namespace {
+// Coalesces the saves requested by a burst of changes, e.g. while a splitter is dragged
+const int SAVE_DELAY_MS = 1000;
+
+/**
+ * @brief Change signals and mutations of settings stored in the profile .ini.
+ *
+ * Everything else is stored in the global qtox.ini.
+ */
+const QSet<QByteArray> personalKeys{
+    "compactLayoutChanged", "proxyTypeChanged", "proxyAddressChanged", "proxyPortChanged",
+    "typingNotificationChanged", "enableLoggingChanged", "blackListChanged", "toxmeInfoChanged",
+    "toxmeBioChanged", "toxmePrivChanged", "toxmePassChanged", "autoAcceptCallChanged",
+    "autoGroupInviteChanged", "autoAcceptDirChanged", "contactNoteChanged", "friends", "circles",
+    "friendRequests", "resumableFiles", "sentAvatarHashChanged"};
+}
+
 const QString Settings::globalSettingsFile = "qtox.ini";
 Settings* Settings::settings{nullptr};
 QMutex Settings::bigLock{QMutex::Recursive};
@@ -67,10 +87,17 @@ Settings::Settings()
     , useCustomDhtList{false}
     , makeToxPortable{false}
     , currentProfileId(0)
+    , snapshot{std::make_shared<const Snapshot>()}
 {
     settingsThread = new QThread();
     settingsThread->setObjectName("qTox Settings");
     settingsThread->start(QThread::LowPriority);
+
+    saveTimer = new QTimer(this);
+    saveTimer->setSingleShot(true);
+    saveTimer->setInterval(SAVE_DELAY_MS);
+    connect(saveTimer, &QTimer::timeout, this, &Settings::savePending);
+
     moveToThread(settingsThread);
     loadGlobal();
 }
@@ -185,6 +212,8 @@ void Settings::loadGlobal()
                                   .toString();
         autoAcceptMaxSize =
             static_cast<size_t>(s.value("autoAcceptMaxSize", 20 << 20 /*20 MB*/).toLongLong());
+        maxFileTransfersPerFriend = s.value("maxFileTransfersPerFriend", 3).toInt();
+        fileUploadRateLimit = s.value("fileUploadRateLimit", 0).toInt();
         stylePreference = static_cast<StyleType>(s.value("stylePreference", 1).toInt());
     }
     s.endGroup();
@@ -310,6 +339,8 @@ void Settings::loadGlobal()
         rcs.endGroup();
     }
 
+    publishSnapshot();
+    dirtyGlobalKeys.clear();
     loaded = true;
 }
 
@@ -366,6 +397,7 @@ void Settings::loadPersonal(Profile* profile)
             fp.autoAcceptCall =
                 Settings::AutoAcceptCallFlags(QFlag(ps.value("autoAcceptCall", 0).toInt()));
             fp.autoGroupInvite = ps.value("autoGroupInvite").toBool();
+            fp.sentAvatarHash = ps.value("sentAvatarHash").toByteArray();
             fp.circleID = ps.value("circle", -1).toInt();
 
             if (getEnableLogging())
@@ -393,6 +425,28 @@ void Settings::loadPersonal(Profile* profile)
     }
     ps.endGroup();
 
+    ps.beginGroup("FileTransfers");
+    {
+        int size = ps.beginReadArray("Transfer");
+        resumableFiles.clear();
+        resumableFiles.reserve(size);
+        for (int i = 0; i < size; i++) {
+            ps.setArrayIndex(i);
+            ResumableFile file;
+            file.friendPk = ToxPk(ps.value("friendPk").toByteArray());
+            file.fileId = ps.value("fileId").toByteArray();
+            file.fileName = ps.value("fileName").toString();
+            file.filePath = ps.value("filePath").toString();
+            file.fileSize = ps.value("fileSize").toULongLong();
+            file.offset = ps.value("offset").toULongLong();
+            file.hash = ps.value("hash").toByteArray();
+            file.receiving = ps.value("receiving").toBool();
+            resumableFiles.push_back(file);
+        }
+        ps.endArray();
+    }
+    ps.endGroup();
+
     ps.beginGroup("GUI");
     {
         compactLayout = ps.value("compactLayout", true).toBool();
@@ -432,6 +486,9 @@ void Settings::loadPersonal(Profile* profile)
         toxmePass = ps.value("pass", "").toString();
     }
     ps.endGroup();
+
+    publishSnapshot();
+    dirtyPersonalKeys.clear();
 }
 
 void Settings::resetToDefault()
@@ -450,17 +507,35 @@ void Settings::resetToDefault()
 
 /**
  * @brief Asynchronous, saves the global settings.
+ *
+ * Requests within SAVE_DELAY_MS are coalesced into one write, which is skipped if no global
+ * setting changed since the last save.
  */
 void Settings::saveGlobal()
 {
     if (QThread::currentThread() != settingsThread)
         return (void)QMetaObject::invokeMethod(&getInstance(), "saveGlobal");
 
+    QMutexLocker locker{&bigLock};
+    globalSavePending = true;
+    saveTimer->start();
+}
+
+/**
+ * @brief Writes the global settings file if it is missing or any global setting changed.
+ * @note Must be called on the settings thread.
+ */
+void Settings::writeGlobal()
+{
     QMutexLocker locker{&bigLock};
     if (!loaded)
         return;
 
     QString path = getSettingsDirPath() + globalSettingsFile;
+    if (dirtyGlobalKeys.isEmpty() && QFile::exists(path)) {
+        return;
+    }
+
     qDebug() << "Saving global settings at " + path;
 
     QSettings s(path, QSettings::IniFormat);
@@ -503,6 +578,8 @@ void Settings::saveGlobal()
         s.setValue("fauxOfflineMessaging", fauxOfflineMessaging);
         s.setValue("autoSaveEnabled", autoSaveEnabled);
         s.setValue("autoAcceptMaxSize", static_cast<qlonglong>(autoAcceptMaxSize));
+        s.setValue("maxFileTransfersPerFriend", maxFileTransfersPerFriend);
+        s.setValue("fileUploadRateLimit", fileUploadRateLimit);
         s.setValue("globalAutoAcceptDir", globalAutoAcceptDir);
         s.setValue("stylePreference", static_cast<int>(stylePreference));
     }
@@ -595,19 +672,31 @@ void Settings::saveGlobal()
         s.setValue("screenGrabbed", screenGrabbed);
     }
     s.endGroup();
+
+    dirtyGlobalKeys.clear();
 }
 
 /**
  * @brief Asynchronous, saves the current profile.
+ *
+ * Requests within SAVE_DELAY_MS are coalesced into one write, which is skipped if no personal
+ * setting changed since the last save.
  */
 void Settings::savePersonal()
 {
-    savePersonal(Nexus::getProfile());
+    if (QThread::currentThread() != settingsThread)
+        return (void)QMetaObject::invokeMethod(&getInstance(), "savePersonal");
+
+    QMutexLocker locker{&bigLock};
+    personalSavePending = true;
+    saveTimer->start();
 }
 
 /**
  * @brief Asynchronous, saves the profile.
  * @param profile Profile to save.
+ *
+ * Always writes the file, since the profile name or the encryption key may have changed.
  */
 void Settings::savePersonal(Profile* profile)
 {
@@ -644,6 +733,7 @@ void Settings::savePersonal(QString profileName, const ToxEncrypt* passkey)
             ps.setValue("autoAcceptDir", frnd.autoAcceptDir);
             ps.setValue("autoAcceptCall", static_cast<int>(frnd.autoAcceptCall));
             ps.setValue("autoGroupInvite", frnd.autoGroupInvite);
+            ps.setValue("sentAvatarHash", frnd.sentAvatarHash);
             ps.setValue("circle", frnd.circleID);
 
             if (getEnableLogging())
@@ -671,6 +761,27 @@ void Settings::savePersonal(QString profileName, const ToxEncrypt* passkey)
     }
     ps.endGroup();
 
+    ps.beginGroup("FileTransfers");
+    {
+        ps.beginWriteArray("Transfer", resumableFiles.size());
+        int index = 0;
+        for (auto& file : resumableFiles) {
+            ps.setArrayIndex(index);
+            ps.setValue("friendPk", file.friendPk.getKey());
+            ps.setValue("fileId", file.fileId);
+            ps.setValue("fileName", file.fileName);
+            ps.setValue("filePath", file.filePath);
+            ps.setValue("fileSize", file.fileSize);
+            ps.setValue("offset", file.offset);
+            ps.setValue("hash", file.hash);
+            ps.setValue("receiving", file.receiving);
+
+            ++index;
+        }
+        ps.endArray();
+    }
+    ps.endGroup();
+
     ps.beginGroup("GUI");
     {
         ps.setValue("compactLayout", compactLayout);
@@ -717,6 +828,9 @@ void Settings::savePersonal(QString profileName, const ToxEncrypt* passkey)
     ps.endGroup();
 
     ps.save();
+
+    dirtyPersonalKeys.clear();
+    personalSavePending = false;
 }
 
 uint32_t Settings::makeProfileId(const QString& profile)
@@ -825,6 +939,7 @@ void Settings::setDhtServerList(const QList<DhtServer>& servers)
 
     if (servers != dhtServerList) {
         dhtServerList = servers;
+        markDirty("dhtServerListChanged");
         emit dhtServerListChanged(dhtServerList);
     }
 }
@@ -840,6 +955,7 @@ void Settings::setEnableTestSound(bool newValue)
 
     if (newValue != enableTestSound) {
         enableTestSound = newValue;
+        markDirty("enableTestSoundChanged");
         emit enableTestSoundChanged(enableTestSound);
     }
 }
@@ -856,6 +972,7 @@ void Settings::setEnableIPv6(bool enabled)
 
     if (enabled != enableIPv6) {
         enableIPv6 = enabled;
+        markDirty("enableIPv6Changed");
         emit enableIPv6Changed(enableIPv6);
     }
 }
@@ -875,6 +992,7 @@ void Settings::setMakeToxPortable(bool newValue)
         makeToxPortable = newValue;
         saveGlobal();
 
+        markDirty("makeToxPortableChanged");
         emit makeToxPortableChanged(makeToxPortable);
     }
 }
@@ -899,6 +1017,7 @@ void Settings::setAutorun(bool newValue)
 
     if (newValue != autorun) {
         Platform::setAutorun(newValue);
+        markDirty("autorunChanged");
         emit autorunChanged(autorun);
     }
 #else
@@ -924,6 +1043,7 @@ void Settings::setStyle(const QString& newStyle)
 
     if (newStyle != style) {
         style = newStyle;
+        markDirty("styleChanged");
         emit styleChanged(style);
     }
 }
@@ -940,6 +1060,7 @@ void Settings::setShowSystemTray(bool newValue)
 
     if (newValue != showSystemTray) {
         showSystemTray = newValue;
+        markDirty("showSystemTrayChanged");
         emit showSystemTrayChanged(newValue);
     }
 }
@@ -950,14 +1071,15 @@ void Settings::setUseEmoticons(bool newValue)
 
     if (newValue != useEmoticons) {
         useEmoticons = newValue;
+        publishSnapshot();
+        markDirty("useEmoticonsChanged");
         emit useEmoticonsChanged(useEmoticons);
     }
 }
 
 bool Settings::getUseEmoticons() const
 {
-    QMutexLocker locker{&bigLock};
-    return useEmoticons;
+    return std::atomic_load(&snapshot)->useEmoticons;
 }
 
 void Settings::setAutoSaveEnabled(bool newValue)
@@ -966,6 +1088,7 @@ void Settings::setAutoSaveEnabled(bool newValue)
 
     if (newValue != autoSaveEnabled) {
         autoSaveEnabled = newValue;
+        markDirty("autoSaveEnabledChanged");
         emit autoSaveEnabledChanged(autoSaveEnabled);
     }
 }
@@ -982,6 +1105,7 @@ void Settings::setAutostartInTray(bool newValue)
 
     if (newValue != autostartInTray) {
         autostartInTray = newValue;
+        markDirty("autostartInTrayChanged");
         emit autostartInTrayChanged(autostartInTray);
     }
 }
@@ -998,6 +1122,7 @@ void Settings::setCloseToTray(bool newValue)
 
     if (newValue != closeToTray) {
         closeToTray = newValue;
+        markDirty("closeToTrayChanged");
         emit closeToTrayChanged(newValue);
     }
 }
@@ -1014,6 +1139,7 @@ void Settings::setMinimizeToTray(bool newValue)
 
     if (newValue != minimizeToTray) {
         minimizeToTray = newValue;
+        markDirty("minimizeToTrayChanged");
         emit minimizeToTrayChanged(minimizeToTray);
     }
 }
@@ -1030,6 +1156,7 @@ void Settings::setLightTrayIcon(bool newValue)
 
     if (newValue != lightTrayIcon) {
         lightTrayIcon = newValue;
+        markDirty("lightTrayIconChanged");
         emit lightTrayIconChanged(lightTrayIcon);
     }
 }
@@ -1046,6 +1173,7 @@ void Settings::setStatusChangeNotificationEnabled(bool newValue)
 
     if (newValue != statusChangeNotificationEnabled) {
         statusChangeNotificationEnabled = newValue;
+        markDirty("statusChangeNotificationEnabledChanged");
         emit statusChangeNotificationEnabledChanged(statusChangeNotificationEnabled);
     }
 }
@@ -1062,6 +1190,7 @@ void Settings::setSpellCheckingEnabled(bool newValue)
 
     if (newValue != spellCheckingEnabled) {
         spellCheckingEnabled = newValue;
+        markDirty("statusChangeNotificationEnabledChanged");
         emit statusChangeNotificationEnabledChanged(statusChangeNotificationEnabled);
     }
 }
@@ -1078,6 +1207,7 @@ void Settings::setNotifySound(bool newValue)
 
     if (newValue != notifySound) {
         notifySound = newValue;
+        markDirty("notifySoundChanged");
         emit notifySoundChanged(notifySound);
     }
 }
@@ -1094,6 +1224,7 @@ void Settings::setBusySound(bool newValue)
 
     if (newValue != busySound) {
         busySound = newValue;
+        markDirty("busySoundChanged");
         emit busySoundChanged(busySound);
     }
 }
@@ -1110,6 +1241,7 @@ void Settings::setGroupAlwaysNotify(bool newValue)
 
     if (newValue != groupAlwaysNotify) {
         groupAlwaysNotify = newValue;
+        markDirty("groupAlwaysNotifyChanged");
         emit groupAlwaysNotifyChanged(groupAlwaysNotify);
     }
 }
@@ -1126,6 +1258,7 @@ void Settings::setTranslation(const QString& newValue)
 
     if (newValue != translation) {
         translation = newValue;
+        markDirty("translationChanged");
         emit translationChanged(translation);
     }
 }
@@ -1160,6 +1293,7 @@ void Settings::setToxmeInfo(const QString& info)
     if (info != toxmeInfo) {
         if (info.split("@").size() == 2) {
             toxmeInfo = info;
+            markDirty("toxmeInfoChanged");
             emit toxmeInfoChanged(toxmeInfo);
         } else {
             qWarning() << info << "is not a valid toxme string -> value ignored.";
@@ -1179,6 +1313,7 @@ void Settings::setToxmeBio(const QString& bio)
 
     if (bio != toxmeBio) {
         toxmeBio = bio;
+        markDirty("toxmeBioChanged");
         emit toxmeBioChanged(toxmeBio);
     }
 }
@@ -1195,6 +1330,7 @@ void Settings::setToxmePriv(bool priv)
 
     if (priv != toxmePriv) {
         toxmePriv = priv;
+        markDirty("toxmePrivChanged");
         emit toxmePrivChanged(toxmePriv);
     }
 }
@@ -1212,6 +1348,7 @@ void Settings::setToxmePass(const QString& pass)
     if (pass != toxmePass) {
         toxmePass = pass;
 
+        markDirty("toxmePassChanged");
         // password is not exposed for security reasons
         emit toxmePassChanged();
     }
@@ -1229,6 +1366,7 @@ void Settings::setForceTCP(bool enabled)
 
     if (enabled != forceTCP) {
         forceTCP = enabled;
+        markDirty("forceTCPChanged");
         emit forceTCPChanged(forceTCP);
     }
 }
@@ -1245,6 +1383,7 @@ void Settings::setEnableLanDiscovery(bool enabled)
 
     if (enabled != enableLanDiscovery) {
         enableLanDiscovery = enabled;
+        markDirty("enableLanDiscoveryChanged");
         emit enableLanDiscoveryChanged(enableLanDiscovery);
     }
 }
@@ -1287,6 +1426,7 @@ void Settings::setProxyType(ProxyType newValue)
 
     if (newValue != proxyType) {
         proxyType = newValue;
+        markDirty("proxyTypeChanged");
         emit proxyTypeChanged(proxyType);
     }
 }
@@ -1303,6 +1443,7 @@ void Settings::setProxyAddr(const QString& address)
 
     if (address != proxyAddr) {
         proxyAddr = address;
+        markDirty("proxyAddressChanged");
         emit proxyAddressChanged(proxyAddr);
     }
 }
@@ -1319,6 +1460,7 @@ void Settings::setProxyPort(quint16 port)
 
     if (port != proxyPort) {
         proxyPort = port;
+        markDirty("proxyPortChanged");
         emit proxyPortChanged(proxyPort);
     }
 }
@@ -1342,6 +1484,7 @@ void Settings::setCurrentProfile(const QString& profile)
     if (profile != currentProfile) {
         currentProfile = profile;
         currentProfileId = makeProfileId(currentProfile);
+        markDirty("currentProfileChanged");
         emit currentProfileChanged(currentProfile);
         emit currentProfileIdChanged(currentProfileId);
     }
@@ -1359,6 +1502,7 @@ void Settings::setEnableLogging(bool newValue)
 
     if (newValue != enableLogging) {
         enableLogging = newValue;
+        markDirty("enableLoggingChanged");
         emit enableLoggingChanged(enableLogging);
     }
 }
@@ -1383,6 +1527,7 @@ void Settings::setAutoAwayTime(int newValue)
 
     if (newValue != autoAwayTime) {
         autoAwayTime = newValue;
+        markDirty("autoAwayTimeChanged");
         emit autoAwayTimeChanged(autoAwayTime);
     }
 }
@@ -1406,6 +1551,7 @@ void Settings::setAutoAcceptDir(const ToxPk& id, const QString& dir)
 
     if (frnd.autoAcceptDir != dir) {
         frnd.autoAcceptDir = dir;
+        markDirty("autoAcceptDirChanged");
         emit autoAcceptDirChanged(id, dir);
     }
 }
@@ -1429,6 +1575,7 @@ void Settings::setAutoAcceptCall(const ToxPk& id, AutoAcceptCallFlags accept)
 
     if (frnd.autoAcceptCall != accept) {
         frnd.autoAcceptCall = accept;
+        markDirty("autoAcceptCallChanged");
         emit autoAcceptCallChanged(id, accept);
     }
 }
@@ -1453,10 +1600,40 @@ void Settings::setAutoGroupInvite(const ToxPk& id, bool accept)
 
     if (frnd.autoGroupInvite != accept) {
         frnd.autoGroupInvite = accept;
+        markDirty("autoGroupInviteChanged");
         emit autoGroupInviteChanged(id, accept);
     }
 }
 
+/**
+ * @brief Get the tox hash of our avatar that was last sent to a friend.
+ * @param id Public key of the friend.
+ * @return The hash, empty if nothing was sent yet.
+ */
+QByteArray Settings::getSentAvatarHash(const ToxPk& id) const
+{
+    QMutexLocker locker{&bigLock};
+
+    auto it = friendLst.find(id.getKey());
+    if (it != friendLst.end())
+        return it->sentAvatarHash;
+
+    return QByteArray();
+}
+
+void Settings::setSentAvatarHash(const ToxPk& id, const QByteArray& hash)
+{
+    QMutexLocker locker{&bigLock};
+
+    auto& frnd = getOrInsertFriendPropRef(id);
+
+    if (frnd.sentAvatarHash != hash) {
+        frnd.sentAvatarHash = hash;
+        markDirty("sentAvatarHashChanged");
+        emit sentAvatarHashChanged(id, hash);
+    }
+}
+
 QString Settings::getContactNote(const ToxPk& id) const
 {
     QMutexLocker locker{&bigLock};
@@ -1476,6 +1653,7 @@ void Settings::setContactNote(const ToxPk& id, const QString& note)
 
     if (frnd.note != note) {
         frnd.note = note;
+        markDirty("contactNoteChanged");
         emit contactNoteChanged(id, note);
     }
 }
@@ -1492,6 +1670,7 @@ void Settings::setGlobalAutoAcceptDir(const QString& newValue)
 
     if (newValue != globalAutoAcceptDir) {
         globalAutoAcceptDir = newValue;
+        markDirty("globalAutoAcceptDirChanged");
         emit globalAutoAcceptDirChanged(globalAutoAcceptDir);
     }
 }
@@ -1508,14 +1687,54 @@ void Settings::setMaxAutoAcceptSize(size_t size)
 
     if (size != autoAcceptMaxSize) {
         autoAcceptMaxSize = size;
+        markDirty("autoAcceptMaxSizeChanged");
         emit autoAcceptMaxSizeChanged(autoAcceptMaxSize);
     }
 }
 
-const QFont& Settings::getChatMessageFont() const
+/**
+ * @brief Number of outgoing file transfers running at the same time per friend, others wait.
+ */
+int Settings::getMaxFileTransfersPerFriend() const
 {
-    QMutexLocker locker(&bigLock);
-    return chatMessageFont;
+    QMutexLocker locker{&bigLock};
+    return maxFileTransfersPerFriend;
+}
+
+void Settings::setMaxFileTransfersPerFriend(int count)
+{
+    QMutexLocker locker{&bigLock};
+
+    if (count != maxFileTransfersPerFriend) {
+        maxFileTransfersPerFriend = count;
+        markDirty("maxFileTransfersPerFriendChanged");
+        emit maxFileTransfersPerFriendChanged(maxFileTransfersPerFriend);
+    }
+}
+
+/**
+ * @brief Upload limit of file transfers per friend in KiB/s, 0 for no limit.
+ */
+int Settings::getFileUploadRateLimit() const
+{
+    QMutexLocker locker{&bigLock};
+    return fileUploadRateLimit;
+}
+
+void Settings::setFileUploadRateLimit(int kibPerSecond)
+{
+    QMutexLocker locker{&bigLock};
+
+    if (kibPerSecond != fileUploadRateLimit) {
+        fileUploadRateLimit = kibPerSecond;
+        markDirty("fileUploadRateLimitChanged");
+        emit fileUploadRateLimitChanged(fileUploadRateLimit);
+    }
+}
+
+QFont Settings::getChatMessageFont() const
+{
+    return std::atomic_load(&snapshot)->chatMessageFont;
 }
 
 void Settings::setChatMessageFont(const QFont& font)
@@ -1524,6 +1743,8 @@ void Settings::setChatMessageFont(const QFont& font)
 
     if (font != chatMessageFont) {
         chatMessageFont = font;
+        publishSnapshot();
+        markDirty("chatMessageFontChanged");
         emit chatMessageFontChanged(chatMessageFont);
     }
 }
@@ -1534,6 +1755,7 @@ void Settings::setWidgetData(const QString& uniqueName, const QByteArray& data)
 
     if (!widgetSettings.contains(uniqueName) || widgetSettings[uniqueName] != data) {
         widgetSettings[uniqueName] = data;
+        markDirty("widgetDataChanged");
         emit widgetDataChanged(uniqueName);
     }
 }
@@ -1556,6 +1778,7 @@ void Settings::setSmileyPack(const QString& value)
 
     if (value != smileyPack) {
         smileyPack = value;
+        markDirty("smileyPackChanged");
         emit smileyPackChanged(smileyPack);
     }
 }
@@ -1572,14 +1795,14 @@ void Settings::setEmojiFontPointSize(int value)
 
     if (value != emojiFontPointSize) {
         emojiFontPointSize = value;
+        markDirty("emojiFontPointSizeChanged");
         emit emojiFontPointSizeChanged(emojiFontPointSize);
     }
 }
 
-const QString& Settings::getTimestampFormat() const
+QString Settings::getTimestampFormat() const
 {
-    QMutexLocker locker{&bigLock};
-    return timestampFormat;
+    return std::atomic_load(&snapshot)->timestampFormat;
 }
 
 void Settings::setTimestampFormat(const QString& format)
@@ -1588,14 +1811,15 @@ void Settings::setTimestampFormat(const QString& format)
 
     if (format != timestampFormat) {
         timestampFormat = format;
+        publishSnapshot();
+        markDirty("timestampFormatChanged");
         emit timestampFormatChanged(timestampFormat);
     }
 }
 
-const QString& Settings::getDateFormat() const
+QString Settings::getDateFormat() const
 {
-    QMutexLocker locker{&bigLock};
-    return dateFormat;
+    return std::atomic_load(&snapshot)->dateFormat;
 }
 
 void Settings::setDateFormat(const QString& format)
@@ -1604,14 +1828,15 @@ void Settings::setDateFormat(const QString& format)
 
     if (format != dateFormat) {
         dateFormat = format;
+        publishSnapshot();
+        markDirty("dateFormatChanged");
         emit dateFormatChanged(dateFormat);
     }
 }
 
 Settings::StyleType Settings::getStylePreference() const
 {
-    QMutexLocker locker{&bigLock};
-    return stylePreference;
+    return std::atomic_load(&snapshot)->stylePreference;
 }
 
 void Settings::setStylePreference(StyleType newValue)
@@ -1620,6 +1845,8 @@ void Settings::setStylePreference(StyleType newValue)
 
     if (newValue != stylePreference) {
         stylePreference = newValue;
+        publishSnapshot();
+        markDirty("stylePreferenceChanged");
         emit stylePreferenceChanged(stylePreference);
     }
 }
@@ -1636,6 +1863,7 @@ void Settings::setWindowGeometry(const QByteArray& value)
 
     if (value != windowGeometry) {
         windowGeometry = value;
+        markDirty("windowGeometryChanged");
         emit windowGeometryChanged(windowGeometry);
     }
 }
@@ -1652,6 +1880,7 @@ void Settings::setWindowState(const QByteArray& value)
 
     if (value != windowState) {
         windowState = value;
+        markDirty("windowStateChanged");
         emit windowStateChanged(windowState);
     }
 }
@@ -1668,6 +1897,7 @@ void Settings::setCheckUpdates(bool newValue)
 
     if (newValue != checkUpdates) {
         checkUpdates = newValue;
+        markDirty("checkUpdatesChanged");
         emit checkUpdatesChanged(checkUpdates);
     }
 }
@@ -1683,6 +1913,7 @@ void Settings::setNotify(bool newValue)
     QMutexLocker locker{&bigLock};
     if (newValue != notify) {
         notify = newValue;
+        markDirty("notifyChanged");
         emit notifyChanged(notify);
     }
 }
@@ -1699,6 +1930,7 @@ void Settings::setShowWindow(bool newValue)
 
     if (newValue != showWindow) {
         showWindow = newValue;
+        markDirty("showWindowChanged");
         emit showWindowChanged(showWindow);
     }
 }
@@ -1715,6 +1947,7 @@ void Settings::setSplitterState(const QByteArray& value)
 
     if (value != splitterState) {
         splitterState = value;
+        markDirty("splitterStateChanged");
         emit splitterStateChanged(splitterState);
     }
 }
@@ -1731,6 +1964,7 @@ void Settings::setDialogGeometry(const QByteArray& value)
 
     if (value != dialogGeometry) {
         dialogGeometry = value;
+        markDirty("dialogGeometryChanged");
         emit dialogGeometryChanged(dialogGeometry);
     }
 }
@@ -1747,6 +1981,7 @@ void Settings::setDialogSplitterState(const QByteArray& value)
 
     if (value != dialogSplitterState) {
         dialogSplitterState = value;
+        markDirty("dialogSplitterStateChanged");
         emit dialogSplitterStateChanged(dialogSplitterState);
     }
 }
@@ -1763,6 +1998,7 @@ void Settings::setDialogSettingsGeometry(const QByteArray& value)
 
     if (value != dialogSettingsGeometry) {
         dialogSettingsGeometry = value;
+        markDirty("dialogSettingsGeometryChanged");
         emit dialogSettingsGeometryChanged(dialogSettingsGeometry);
     }
 }
@@ -1779,6 +2015,7 @@ void Settings::setMinimizeOnClose(bool newValue)
 
     if (newValue != minimizeOnClose) {
         minimizeOnClose = newValue;
+        markDirty("minimizeOnCloseChanged");
         emit minimizeOnCloseChanged(minimizeOnClose);
     }
 }
@@ -1795,6 +2032,7 @@ void Settings::setTypingNotification(bool enabled)
 
     if (enabled != typingNotification) {
         typingNotification = enabled;
+        markDirty("typingNotificationChanged");
         emit typingNotificationChanged(typingNotification);
     }
 }
@@ -1811,10 +2049,33 @@ void Settings::setBlackList(const QStringList& blist)
 
     if (blist != blackList) {
         blackList = blist;
+        publishSnapshot();
+        markDirty("blackListChanged");
         emit blackListChanged(blackList);
     }
 }
 
+/**
+ * @brief Get the public keys of the muted peers.
+ * @return Snapshot of the black list, doesn't change when the black list is modified.
+ *
+ * Doesn't take the settings lock, so it is cheap enough to call for every received audio frame.
+ */
+std::shared_ptr<const QSet<ToxPk>> Settings::getMutedPeers() const
+{
+    const std::shared_ptr<const Snapshot> current = std::atomic_load(&snapshot);
+    return std::shared_ptr<const QSet<ToxPk>>(current, &current->mutedPeers);
+}
+
+/**
+ * @brief Checks if messages and audio of a peer should be ignored.
+ * @param peerPk Public key of the peer.
+ */
+bool Settings::isPeerMuted(const ToxPk& peerPk) const
+{
+    return getMutedPeers()->contains(peerPk);
+}
+
 QString Settings::getInDev() const
 {
     QMutexLocker locker{&bigLock};
@@ -1827,6 +2088,7 @@ void Settings::setInDev(const QString& deviceSpecifier)
 
     if (deviceSpecifier != inDev) {
         inDev = deviceSpecifier;
+        markDirty("inDevChanged");
         emit inDevChanged(inDev);
     }
 }
@@ -1843,6 +2105,7 @@ void Settings::setAudioInDevEnabled(bool enabled)
 
     if (enabled != audioInDevEnabled) {
         audioInDevEnabled = enabled;
+        markDirty("audioInDevEnabledChanged");
         emit audioInDevEnabledChanged(enabled);
     }
 }
@@ -1859,6 +2122,7 @@ void Settings::setAudioInGainDecibel(qreal dB)
 
     if (dB < audioInGainDecibel || dB > audioInGainDecibel) {
         audioInGainDecibel = dB;
+        markDirty("audioInGainDecibelChanged");
         emit audioInGainDecibelChanged(audioInGainDecibel);
     }
 }
@@ -1875,6 +2139,7 @@ void Settings::setAudioThreshold(qreal percent)
 
     if (percent < audioThreshold || percent > audioThreshold) {
         audioThreshold = percent;
+        markDirty("audioThresholdChanged");
         emit audioThresholdChanged(audioThreshold);
     }
 }
@@ -1891,6 +2156,7 @@ void Settings::setVideoDev(const QString& deviceSpecifier)
 
     if (deviceSpecifier != videoDev) {
         videoDev = deviceSpecifier;
+        markDirty("videoDevChanged");
         emit videoDevChanged(videoDev);
     }
 }
@@ -1907,6 +2173,7 @@ void Settings::setOutDev(const QString& deviceSpecifier)
 
     if (deviceSpecifier != outDev) {
         outDev = deviceSpecifier;
+        markDirty("outDevChanged");
         emit outDevChanged(outDev);
     }
 }
@@ -1923,6 +2190,7 @@ void Settings::setAudioOutDevEnabled(bool enabled)
 
     if (enabled != audioOutDevEnabled) {
         audioOutDevEnabled = enabled;
+        markDirty("audioOutDevEnabledChanged");
         emit audioOutDevEnabledChanged(audioOutDevEnabled);
     }
 }
@@ -1939,6 +2207,7 @@ void Settings::setOutVolume(int volume)
 
     if (volume != outVolume) {
         outVolume = volume;
+        markDirty("outVolumeChanged");
         emit outVolumeChanged(outVolume);
     }
 }
@@ -1955,6 +2224,7 @@ void Settings::setAudioBitrate(int bitrate)
 
     if (bitrate != audioBitrate) {
         audioBitrate = bitrate;
+        markDirty("audioBitrateChanged");
         emit audioBitrateChanged(audioBitrate);
     }
 }
@@ -1971,6 +2241,7 @@ void Settings::setEnableBackend2(bool enabled)
 
     if (enabled != enableBackend2) {
         enableBackend2 = enabled;
+        markDirty("enableBackend2Changed");
         emit enableBackend2Changed(enabled);
     }
 }
@@ -1987,6 +2258,7 @@ void Settings::setScreenRegion(const QRect& value)
 
     if (value != screenRegion) {
         screenRegion = value;
+        markDirty("screenRegionChanged");
         emit screenRegionChanged(screenRegion);
     }
 }
@@ -2003,6 +2275,7 @@ void Settings::setScreenGrabbed(bool value)
 
     if (value != screenGrabbed) {
         screenGrabbed = value;
+        markDirty("screenGrabbedChanged");
         emit screenGrabbedChanged(screenGrabbed);
     }
 }
@@ -2019,6 +2292,7 @@ void Settings::setCamVideoRes(QRect newValue)
 
     if (newValue != camVideoRes) {
         camVideoRes = newValue;
+        markDirty("camVideoResChanged");
         emit camVideoResChanged(camVideoRes);
     }
 }
@@ -2035,6 +2309,7 @@ void Settings::setCamVideoFPS(float newValue)
 
     if (newValue != camVideoFPS) {
         camVideoFPS = newValue;
+        markDirty("camVideoFPSChanged");
         emit camVideoFPSChanged(camVideoFPS);
     }
 }
@@ -2058,16 +2333,12 @@ void Settings::updateFriendAddress(const QString& newAddr)
     auto key = ToxId(newAddr).getPublicKey();
     auto& frnd = getOrInsertFriendPropRef(key);
     frnd.addr = newAddr;
+    markDirty("friends");
 }
 
 QString Settings::getFriendAlias(const ToxPk& id) const
 {
-    QMutexLocker locker{&bigLock};
-    auto it = friendLst.find(id.getKey());
-    if (it != friendLst.end())
-        return it->alias;
-
-    return QString();
+    return std::atomic_load(&snapshot)->friendAliases.value(id.getKey());
 }
 
 void Settings::setFriendAlias(const ToxPk& id, const QString& alias)
@@ -2075,6 +2346,8 @@ void Settings::setFriendAlias(const ToxPk& id, const QString& alias)
     QMutexLocker locker{&bigLock};
     auto& frnd = getOrInsertFriendPropRef(id);
     frnd.alias = alias;
+    publishSnapshot();
+    markDirty("friends");
 }
 
 int Settings::getFriendCircleID(const ToxPk& id) const
@@ -2092,6 +2365,7 @@ void Settings::setFriendCircleID(const ToxPk& id, int circleID)
     QMutexLocker locker{&bigLock};
     auto& frnd = getOrInsertFriendPropRef(id);
     frnd.circleID = circleID;
+    markDirty("friends");
 }
 
 QDate Settings::getFriendActivity(const ToxPk& id) const
@@ -2108,6 +2382,7 @@ void Settings::setFriendActivity(const ToxPk& id, const QDate& activity)
     QMutexLocker locker{&bigLock};
     auto& frnd = getOrInsertFriendPropRef(id);
     frnd.activity = activity;
+    markDirty("friends");
 }
 
 void Settings::saveFriendSettings(const ToxPk& id)
@@ -2120,6 +2395,8 @@ void Settings::removeFriendSettings(const ToxPk& id)
 {
     QMutexLocker locker{&bigLock};
     friendLst.remove(id.getKey());
+    publishSnapshot();
+    markDirty("friends");
 }
 
 bool Settings::getFauxOfflineMessaging() const
@@ -2134,6 +2411,7 @@ void Settings::setFauxOfflineMessaging(bool value)
 
     if (value != fauxOfflineMessaging) {
         fauxOfflineMessaging = value;
+        markDirty("fauxOfflineMessagingChanged");
         emit fauxOfflineMessagingChanged(fauxOfflineMessaging);
     }
 }
@@ -2150,6 +2428,7 @@ void Settings::setCompactLayout(bool value)
 
     if (value != compactLayout) {
         compactLayout = value;
+        markDirty("compactLayoutChanged");
         emit compactLayoutChanged(value);
     }
 }
@@ -2166,6 +2445,7 @@ void Settings::setSeparateWindow(bool value)
 
     if (value != separateWindow) {
         separateWindow = value;
+        markDirty("separateWindowChanged");
         emit separateWindowChanged(value);
     }
 }
@@ -2182,6 +2462,7 @@ void Settings::setDontGroupWindows(bool value)
 
     if (value != dontGroupWindows) {
         dontGroupWindows = value;
+        markDirty("dontGroupWindowsChanged");
         emit dontGroupWindowsChanged(dontGroupWindows);
     }
 }
@@ -2198,6 +2479,7 @@ void Settings::setGroupchatPosition(bool value)
 
     if (value != groupchatPosition) {
         groupchatPosition = value;
+        markDirty("groupchatPositionChanged");
         emit groupchatPositionChanged(value);
     }
 }
@@ -2214,6 +2496,7 @@ void Settings::setShowIdenticons(bool value)
 
     if (value != showIdenticons) {
         showIdenticons = value;
+        markDirty("showIdenticonsChanged");
         emit showIdenticonsChanged(value);
     }
 }
@@ -2234,6 +2517,7 @@ void Settings::setCircleName(int id, const QString& name)
 {
     QMutexLocker locker{&bigLock};
     circleLst[id].name = name;
+    markDirty("circles");
     savePersonal();
 }
 
@@ -2250,6 +2534,7 @@ int Settings::addCircle(const QString& name)
         cp.name = name;
 
     circleLst.append(cp);
+    markDirty("circles");
     savePersonal();
     return circleLst.count() - 1;
 }
@@ -2264,6 +2549,7 @@ void Settings::setCircleExpanded(int id, bool expanded)
 {
     QMutexLocker locker{&bigLock};
     circleLst[id].expanded = expanded;
+    markDirty("circles");
 }
 
 bool Settings::addFriendRequest(const QString& friendAddress, const QString& message)
@@ -2284,6 +2570,7 @@ bool Settings::addFriendRequest(const QString& friendAddress, const QString& mes
     request.read = false;
 
     friendRequests.push_back(request);
+    markDirty("friendRequests");
     return true;
 }
 
@@ -2316,18 +2603,38 @@ void Settings::clearUnreadFriendRequests()
 
     for (auto& request : friendRequests)
         request.read = true;
+
+    markDirty("friendRequests");
 }
 
 void Settings::removeFriendRequest(int index)
 {
     QMutexLocker locker{&bigLock};
     friendRequests.removeAt(index);
+    markDirty("friendRequests");
 }
 
 void Settings::readFriendRequest(int index)
 {
     QMutexLocker locker{&bigLock};
     friendRequests[index].read = true;
+    markDirty("friendRequests");
+}
+
+/**
+ * @brief File transfers that broke off and can be resumed once the friend offers them again.
+ */
+QList<Settings::ResumableFile> Settings::getResumableFiles() const
+{
+    QMutexLocker locker{&bigLock};
+    return resumableFiles;
+}
+
+void Settings::setResumableFiles(const QList<ResumableFile>& files)
+{
+    QMutexLocker locker{&bigLock};
+    resumableFiles = files;
+    markDirty("resumableFiles");
 }
 
 int Settings::removeCircle(int id)
@@ -2336,6 +2643,7 @@ int Settings::removeCircle(int id)
     // This gives you contiguous ids all the time.
     circleLst[id] = circleLst.last();
     circleLst.pop_back();
+    markDirty("circles");
     savePersonal();
     return circleLst.count();
 }
@@ -2352,6 +2660,7 @@ void Settings::setThemeColor(int value)
 
     if (value != themeColor) {
         themeColor = value;
+        markDirty("themeColorChanged");
         emit themeColorChanged(themeColor);
     }
 }
@@ -2368,6 +2677,7 @@ void Settings::setAutoLogin(bool state)
 
     if (state != autoLogin) {
         autoLogin = state;
+        markDirty("autoLoginChanged");
         emit autoLoginChanged(autoLogin);
     }
 }
@@ -2376,11 +2686,13 @@ void Settings::setEnableGroupChatsColor(bool state)
 {
     QMutexLocker locker{&bigLock};
     nameColors = state;
+    publishSnapshot();
+    markDirty("nameColors");
 }
 
 bool Settings::getEnableGroupChatsColor() const
 {
-    return nameColors;
+    return std::atomic_load(&snapshot)->nameColors;
 }
 
 /**
@@ -2432,6 +2744,7 @@ void Settings::sync()
 
     QMutexLocker locker{&bigLock};
     qApp->processEvents();
+    savePending();
 }
 
 Settings::friendProp& Settings::getOrInsertFriendPropRef(const ToxPk& id)
@@ -2446,6 +2759,90 @@ Settings::friendProp& Settings::getOrInsertFriendPropRef(const ToxPk& id)
     return *it;
 }
 
+/**
+ * @brief Check if a setting of the profile .ini changed since it was last saved.
+ * @param key Change signal or mutation name of the setting.
+ * @return True if the next personal save has to write it.
+ */
+bool Settings::isPersonalKeyDirty(const QByteArray& key) const
+{
+    QMutexLocker locker{&bigLock};
+    return dirtyPersonalKeys.contains(key);
+}
+
+/**
+ * @brief Records that a setting changed and has to be written by the next save.
+ * @param key Change signal or mutation name, see personalKeys for the settings file it belongs to.
+ */
+void Settings::markDirty(const QByteArray& key)
+{
+    QMutexLocker locker{&bigLock};
+    if (personalKeys.contains(key)) {
+        dirtyPersonalKeys.insert(key);
+    } else {
+        dirtyGlobalKeys.insert(key);
+    }
+}
+
+/**
+ * @brief Performs the saves requested since the last write, skipping unchanged files.
+ * @note Must be called on the settings thread.
+ */
+void Settings::savePending()
+{
+    QMutexLocker locker{&bigLock};
+    saveTimer->stop();
+
+    if (globalSavePending) {
+        globalSavePending = false;
+        writeGlobal();
+    }
+
+    if (personalSavePending) {
+        personalSavePending = false;
+        Profile* profile = Nexus::getProfile();
+        if (!profile) {
+            qDebug() << "Could not save personal settings because there is no active profile";
+        } else if (!dirtyPersonalKeys.isEmpty()) {
+            savePersonal(profile->getName(), profile->getPasskey());
+        }
+    }
+}
+
+/**
+ * @brief Copy the settings read on hot paths and publish them for lock free reading.
+ * @note Must be called with bigLock held after any of the copied settings changed.
+ *
+ * Readers keep using the previous snapshot until they load the pointer again, so a snapshot is
+ * never modified after it was published.
+ */
+void Settings::publishSnapshot()
+{
+    auto next = std::make_shared<Snapshot>();
+    next->chatMessageFont = chatMessageFont;
+    next->stylePreference = stylePreference;
+    next->timestampFormat = timestampFormat;
+    next->dateFormat = dateFormat;
+    next->useEmoticons = useEmoticons;
+    next->nameColors = nameColors;
+
+    for (auto it = friendLst.constBegin(); it != friendLst.constEnd(); ++it) {
+        if (!it->alias.isEmpty()) {
+            next->friendAliases.insert(it.key(), it->alias);
+        }
+    }
+
+    next->mutedPeers.reserve(blackList.size());
+    for (const QString& entry : blackList) {
+        const ToxPk peerPk{QByteArray::fromHex(entry.toLatin1())};
+        if (!peerPk.isEmpty()) {
+            next->mutedPeers.insert(peerPk);
+        }
+    }
+
+    std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>{std::move(next)});
+}
+
 ICoreSettings::ProxyType Settings::fixInvalidProxyType(ICoreSettings::ProxyType proxyType)
 {
     // Repair uninitialized enum that was saved to settings due to bug (https://github.com/qTox/qTox/issues/5311)
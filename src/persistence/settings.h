@@ -25,6 +25,7 @@
 #include "src/core/icoresettings.h"
 #include "src/core/toxencrypt.h"
 #include "src/core/toxfile.h"
+#include "src/core/toxpk.h"
 #include "src/persistence/ifriendsettings.h"
 #include "src/video/ivideosettings.h"
 
@@ -36,8 +37,12 @@
 #include <QNetworkProxy>
 #include <QObject>
 #include <QPixmap>
+#include <QSet>
+
+#include <memory>
 
 class Profile;
+class QTimer;
 
 namespace Db {
 enum class syncType;
@@ -143,8 +148,6 @@ public:
     void createSettingsDir();
     void createPersonal(QString basename);
 
-    void savePersonal();
-
     void loadGlobal();
     void loadPersonal();
     void loadPersonal(Profile* profile);
@@ -158,8 +161,21 @@ public:
         bool read;
     };
 
+    struct ResumableFile
+    {
+        ToxPk friendPk;
+        QByteArray fileId;
+        QString fileName;
+        QString filePath;
+        quint64 fileSize;
+        quint64 offset;
+        QByteArray hash;
+        bool receiving;
+    };
+
 public slots:
     void saveGlobal();
+    void savePersonal();
     void sync();
 
 signals:
@@ -187,6 +203,9 @@ signals:
     void autoAwayTimeChanged(int minutes);
     void globalAutoAcceptDirChanged(const QString& path);
     void autoAcceptMaxSizeChanged(size_t size);
+    void maxFileTransfersPerFriendChanged(int count);
+    void fileUploadRateLimitChanged(int kibPerSecond);
+    void sentAvatarHashChanged(const ToxPk& id, const QByteArray& hash);
     void checkUpdatesChanged(bool enabled);
     void widgetDataChanged(const QString& key);
 
@@ -442,17 +461,26 @@ public:
     size_t getMaxAutoAcceptSize() const;
     void setMaxAutoAcceptSize(size_t size);
 
+    int getMaxFileTransfersPerFriend() const;
+    void setMaxFileTransfersPerFriend(int count);
+
+    int getFileUploadRateLimit() const;
+    void setFileUploadRateLimit(int kibPerSecond);
+
     bool getAutoGroupInvite(const ToxPk& id) const override;
     void setAutoGroupInvite(const ToxPk& id, bool accept) override;
 
+    QByteArray getSentAvatarHash(const ToxPk& id) const;
+    void setSentAvatarHash(const ToxPk& id, const QByteArray& hash);
+
     // ChatView
-    const QFont& getChatMessageFont() const;
+    QFont getChatMessageFont() const;
     void setChatMessageFont(const QFont& font);
 
-    const QString& getTimestampFormat() const;
+    QString getTimestampFormat() const;
     void setTimestampFormat(const QString& format);
 
-    const QString& getDateFormat() const;
+    QString getDateFormat() const;
     void setDateFormat(const QString& format);
 
     bool getMinimizeOnClose() const;
@@ -469,6 +497,8 @@ public:
     void setTypingNotification(bool enabled);
     QStringList getBlackList() const;
     void setBlackList(const QStringList& blist);
+    std::shared_ptr<const QSet<ToxPk>> getMutedPeers() const;
+    bool isPeerMuted(const ToxPk& peerPk) const;
 
     // State
     QByteArray getWindowGeometry() const;
@@ -549,6 +579,9 @@ public:
     void removeFriendRequest(int index);
     void readFriendRequest(int index);
 
+    QList<ResumableFile> getResumableFiles() const;
+    void setResumableFiles(const QList<ResumableFile>& files);
+
     QByteArray getWidgetData(const QString& uniqueName) const;
     void setWidgetData(const QString& uniqueName, const QByteArray& data);
 
@@ -568,6 +601,7 @@ public:
     }
 
     static uint32_t makeProfileId(const QString& profile);
+    bool isPersonalKeyDirty(const QByteArray& key) const;
 
 private:
     struct friendProp;
@@ -579,11 +613,29 @@ private:
     void savePersonal(QString profileName, const ToxEncrypt* passkey);
     friendProp& getOrInsertFriendPropRef(const ToxPk& id);
     ICoreSettings::ProxyType fixInvalidProxyType(ICoreSettings::ProxyType proxyType);
+    void publishSnapshot();
+    void markDirty(const QByteArray& key);
+    void writeGlobal();
 
 public slots:
     void savePersonal(Profile* profile);
 
+private slots:
+    void savePending();
+
 private:
+    struct Snapshot
+    {
+        QFont chatMessageFont;
+        StyleType stylePreference = StyleType::WITH_CHARS;
+        QString timestampFormat;
+        QString dateFormat;
+        bool useEmoticons = true;
+        bool nameColors = false;
+        QHash<QByteArray, QString> friendAliases;
+        QSet<ToxPk> mutedPeers;
+    };
+
     bool loaded;
 
     bool useCustomDhtList;
@@ -639,8 +691,11 @@ private:
     bool autoSaveEnabled;
     QString globalAutoAcceptDir;
     size_t autoAcceptMaxSize;
+    int maxFileTransfersPerFriend;
+    int fileUploadRateLimit;
 
     QList<Request> friendRequests;
+    QList<ResumableFile> resumableFiles;
 
     // GUI
     QString smileyPack;
@@ -689,6 +744,16 @@ private:
     bool screenGrabbed;
     float camVideoFPS;
 
+    // copy of the settings read on hot paths, replaced as a whole and read without bigLock
+    std::shared_ptr<const Snapshot> snapshot;
+
+    // keys changed since the last save, and saves waiting for saveTimer
+    QSet<QByteArray> dirtyGlobalKeys;
+    QSet<QByteArray> dirtyPersonalKeys;
+    bool globalSavePending = false;
+    bool personalSavePending = false;
+    QTimer* saveTimer = nullptr;
+
     struct friendProp
     {
         friendProp() = delete;
@@ -703,6 +768,7 @@ private:
         QDate activity = QDate();
         AutoAcceptCallFlags autoAcceptCall;
         bool autoGroupInvite = false;
+        QByteArray sentAvatarHash;
     };
 
     struct circleProp
@@ -181,6 +181,7 @@ void SettingsSerializer::setValue(const QString& key, const QVariant& value)
         Value nv{group, array, arrayIndex, key, value};
         if (array >= 0)
             arrays[array].values.append(values.size());
+        valueIndex.insert(makeKey(nv), values.size());
         values.append(nv);
     }
 }
@@ -194,25 +195,50 @@ QVariant SettingsSerializer::value(const QString& key, const QVariant& defaultVa
         return defaultValue;
 }
 
+/**
+ * @brief Find a value in the current group, and the current array index when inside an array.
+ * @param key Key of the value.
+ * @return Pointer to the value, nullptr if it doesn't exist.
+ *
+ * Array values are matched by the group of their array, so any array of the current group
+ * provides the value for the current array index.
+ */
 const SettingsSerializer::Value* SettingsSerializer::findValue(const QString& key) const
 {
-    if (array != -1) {
-        for (const Array& a : arrays) {
-            if (a.group != group)
-                continue;
+    const bool inArray = array != -1;
+    const ValueKey k{group, inArray, inArray ? arrayIndex : -1, key};
+    const auto it = valueIndex.constFind(k);
+    if (it == valueIndex.constEnd())
+        return nullptr;
 
-            for (int vi : a.values) {
-                const Value& v = values[vi];
-                if (v.arrayIndex == arrayIndex && v.key == key)
-                    return &v;
-            }
-        }
-    } else {
-        for (const Value& v : values)
-            if (v.group == group && v.array == -1 && v.key == key)
-                return &v;
+    return &values[*it];
+}
+
+/**
+ * @brief Get the index key of a stored value.
+ */
+SettingsSerializer::ValueKey SettingsSerializer::makeKey(const Value& v) const
+{
+    if (v.array < 0)
+        return {v.group, false, -1, v.key};
+
+    return {arrays[static_cast<int>(v.array)].group, true, v.arrayIndex, v.key};
+}
+
+/**
+ * @brief Index all values again, after values, arrays or groups were renumbered.
+ *
+ * If several values share a key, the first one is found, as a linear search would.
+ */
+void SettingsSerializer::rebuildIndex()
+{
+    valueIndex.clear();
+    valueIndex.reserve(values.size());
+    for (int i = 0; i < values.size(); ++i) {
+        const ValueKey k = makeKey(values[i]);
+        if (!valueIndex.contains(k))
+            valueIndex.insert(k, i);
     }
-    return nullptr;
 }
 
 SettingsSerializer::Value* SettingsSerializer::findValue(const QString& key)
@@ -525,6 +551,7 @@ void SettingsSerializer::readIni()
         removeGroup(g);
     }
 
+    rebuildIndex();
     group = array = -1;
 }
 
@@ -23,6 +23,7 @@
 #include "src/core/toxencrypt.h"
 
 #include <QDataStream>
+#include <QHash>
 #include <QSettings>
 #include <QString>
 #include <QVector>
@@ -85,6 +86,25 @@ private:
         QVariant value;
     };
 
+    struct ValueKey
+    {
+        qint64 group;
+        bool inArray;
+        int arrayIndex;
+        QString key;
+
+        bool operator==(const ValueKey& other) const
+        {
+            return group == other.group && inArray == other.inArray
+                   && arrayIndex == other.arrayIndex && key == other.key;
+        }
+
+        friend uint qHash(const ValueKey& k, uint seed = 0)
+        {
+            return qHash(k.key, seed) ^ qHash(k.group) ^ qHash(k.arrayIndex) ^ k.inArray;
+        }
+    };
+
     struct Array
     {
         qint64 group;
@@ -96,6 +116,8 @@ private:
 private:
     const Value* findValue(const QString& key) const;
     Value* findValue(const QString& key);
+    ValueKey makeKey(const Value& v) const;
+    void rebuildIndex();
     void readSerialized();
     void readIni();
     void removeValue(const QString& key);
@@ -109,6 +131,7 @@ private:
     QStringList groups;
     QVector<Array> arrays;
     QVector<Value> values;
+    QHash<ValueKey, int> valueIndex;
     static const char magic[];
 };
 
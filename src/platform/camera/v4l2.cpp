@@ -37,9 +37,15 @@
  * stdout and is not part of the public API for some reason.
  */
 
+/**
+ * Raw planar formats are ranked highest, they need no decoding at all and YUV420
+ * can even be handed to toxav as-is. Compressed formats need a CPU decoder.
+ */
 static std::map<uint32_t, uint8_t> createPixFmtToQuality()
 {
     std::map<uint32_t, uint8_t> m;
+    m[V4L2_PIX_FMT_YUV420] = 5;
+    m[V4L2_PIX_FMT_NV12] = 4;
     m[V4L2_PIX_FMT_H264] = 3;
     m[V4L2_PIX_FMT_MJPEG] = 2;
     m[V4L2_PIX_FMT_YUYV] = 1;
@@ -50,6 +56,8 @@ const std::map<uint32_t, uint8_t> pixFmtToQuality = createPixFmtToQuality();
 static std::map<uint32_t, QString> createPixFmtToName()
 {
     std::map<uint32_t, QString> m;
+    m[V4L2_PIX_FMT_YUV420] = QString("yuv420p");
+    m[V4L2_PIX_FMT_NV12] = QString("nv12");
     m[V4L2_PIX_FMT_H264] = QString("h264");
     m[V4L2_PIX_FMT_MJPEG] = QString("mjpeg");
     m[V4L2_PIX_FMT_YUYV] = QString("yuyv422");
@@ -190,7 +190,8 @@ CameraDevice* CameraDevice::open(QString devName, VideoMode mode)
     } else if (iformat->name == QString("video4linux2,v4l2") && mode) {
         av_dict_set(&options, "video_size", videoSize.c_str(), 0);
         av_dict_set(&options, "framerate", framerate.c_str(), 0);
-        const std::string pixelFormatStr = v4l2::getPixelFormatString(mode.pixel_format).toStdString();
+        const uint32_t pixelFormat = getBestPixelFormat(devName, mode);
+        const std::string pixelFormatStr = v4l2::getPixelFormatString(pixelFormat).toStdString();
         // don't try to set a format string that doesn't exist
         if (pixelFormatStr != "unknown" && pixelFormatStr != "invalid") {
             const char* pixel_format = pixelFormatStr.c_str();
@@ -498,6 +499,33 @@ bool CameraDevice::betterPixelFormat(uint32_t a, uint32_t b)
 #endif
 }
 
+/**
+ * @brief Picks the cheapest pixel format to capture a mode in.
+ *
+ * Cameras often offer the same resolution both compressed (MJPEG) and raw (YUV420, NV12).
+ * Raw modes skip the decoder entirely, so we prefer them whenever the device provides one at
+ * the requested resolution and at least the requested framerate.
+ *
+ * @param devName Device name to query.
+ * @param mode Requested mode, its pixel format is used if nothing better is found.
+ * @return Pixel format to open the device with.
+ */
+uint32_t CameraDevice::getBestPixelFormat(const QString& devName, const VideoMode& mode)
+{
+    uint32_t best = mode.pixel_format;
+    for (const VideoMode& m : getVideoModes(devName)) {
+        if (m.width != mode.width || m.height != mode.height || m.FPS < mode.FPS) {
+            continue;
+        }
+
+        if (!best || betterPixelFormat(m.pixel_format, best)) {
+            best = m.pixel_format;
+        }
+    }
+
+    return best;
+}
+
 /**
  * @brief Sets CameraDevice::iformat to default.
  * @return True if success, false if failure.
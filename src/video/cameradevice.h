@@ -56,6 +56,7 @@ private:
     static bool getDefaultInputFormat();
     static QVector<QPair<QString, QString>> getRawDeviceListGeneric();
     static QVector<VideoMode> getScreenModes();
+    static uint32_t getBestPixelFormat(const QString& devName, const VideoMode& mode);
 
 public:
     const QString devName;
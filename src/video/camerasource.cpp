@@ -26,6 +26,7 @@ extern "C" {
 #include "cameradevice.h"
 #include "camerasource.h"
 #include "videoframe.h"
+#include "videostats.h"
 #include "src/persistence/settings.h"
 #include <QDebug>
 #include <QReadLocker>
@@ -89,6 +90,11 @@ extern "C" {
 
 CameraSource* CameraSource::instance{nullptr};
 
+/**
+ * @brief Upper bound for decoder threads, more only adds latency for webcam resolutions
+ */
+static constexpr int maxDecodeThreads = 4;
+
 CameraSource::CameraSource()
     : deviceThread{new QThread}
     , deviceName{"none"}
@@ -349,6 +355,18 @@ void CameraSource::openDevice()
     }
 #endif
 
+    // Raw modes are basically free to decode, but compressed ones like MJPEG easily max out a
+    // single core at high resolutions, so let the decoder spread the work over a few threads.
+    // Slice threading doesn't add latency, frame threading delays output by one frame per thread.
+    if (codecId != AV_CODEC_ID_RAWVIDEO) {
+        cctx->thread_count = qMin(QThread::idealThreadCount(), maxDecodeThreads);
+        if (codec->capabilities & AV_CODEC_CAP_SLICE_THREADS) {
+            cctx->thread_type = FF_THREAD_SLICE;
+        } else {
+            cctx->thread_type = FF_THREAD_FRAME;
+        }
+    }
+
     // Open codec
     if (avcodec_open2(cctx, codec, nullptr) < 0) {
         qWarning() << "Can't open codec";
@@ -386,6 +404,7 @@ void CameraSource::closeDevice()
     }
 
     qDebug() << "Closing device" << deviceName << "subscriptions:" << subscriptions;
+    qDebug().noquote() << "Video pipeline stats:\n" << VideoStats::report();
 
     // Free all remaining VideoFrame
     VideoFrame::untrackFrames(id, true);
@@ -414,6 +433,9 @@ void CameraSource::stream()
             return;
         }
 
+        // Don't count waiting for the device, only what we do with its data
+        const qint64 decodeStart = VideoStats::now();
+
 #if LIBAVCODEC_VERSION_INT < 3747941
         AVFrame* frame = av_frame_alloc();
         if (!frame) {
@@ -430,6 +452,8 @@ void CameraSource::stream()
             }
 
             VideoFrame* vframe = new VideoFrame(id, frame);
+            vframe->setStageTime(VideoStats::Stage::Capture, vframe->getCreationTime());
+            VideoStats::record(VideoStats::Stage::Capture, vframe->getCreationTime() - decodeStart);
             emit frameAvailable(vframe->trackFrame());
         }
 #else
@@ -442,6 +466,9 @@ void CameraSource::stream()
             AVFrame* frame = av_frame_alloc();
             if (frame && !avcodec_receive_frame(cctx, frame)) {
                 VideoFrame* vframe = new VideoFrame(id, frame);
+                vframe->setStageTime(VideoStats::Stage::Capture, vframe->getCreationTime());
+                VideoStats::record(VideoStats::Stage::Capture,
+                                   vframe->getCreationTime() - decodeStart);
                 emit frameAvailable(vframe->trackFrame());
             } else {
                 av_frame_free(&frame);
@@ -24,6 +24,7 @@ extern "C" {
 
 #include "corevideosource.h"
 #include "videoframe.h"
+#include "videostats.h"
 
 /**
  * @class CoreVideoSource
@@ -59,6 +60,7 @@ void CoreVideoSource::pushFrame(const vpx_image_t* vpxframe)
     if (stopped)
         return;
 
+    const qint64 receiveStart = VideoStats::now();
     QMutexLocker locker(&biglock);
 
     std::shared_ptr<VideoFrame> vframe;
@@ -99,6 +101,8 @@ void CoreVideoSource::pushFrame(const vpx_image_t* vpxframe)
     }
 
     vframe = std::make_shared<VideoFrame>(id, avframe, true);
+    vframe->setStageTime(VideoStats::Stage::Receive, vframe->getCreationTime());
+    VideoStats::record(VideoStats::Stage::Receive, vframe->getCreationTime() - receiveStart);
     emit frameAvailable(vframe);
 }
 
@@ -34,6 +34,14 @@
 #include <QTimer>
 
 #include <QDebug>
+
+namespace {
+// Peer tiles are small, no need to repaint them at the full camera framerate
+const int peerTileMaxFps = 15;
+// size peer avatars are decoded at, the tiles stay smaller than that
+const QSize peerAvatarSize{128, 128};
+}
+
 class LabeledVideo : public QFrame
 {
 public:
@@ -135,6 +143,7 @@ GroupNetCamView::GroupNetCamView(int group, QWidget* parent)
     horLayout->addStretch(1);
 
     selfVideoSurface = new LabeledVideo(Nexus::getProfile()->loadAvatar(), this);
+    selfVideoSurface->getVideoSurface()->setMaxFps(peerTileMaxFps);
     horLayout->addWidget(selfVideoSurface);
 
     horLayout->addStretch(1);
@@ -157,6 +166,7 @@ GroupNetCamView::GroupNetCamView(int group, QWidget* parent)
 
     connect(Nexus::getProfile(), &Profile::friendAvatarChanged, this,
             &GroupNetCamView::friendAvatarChanged);
+    connect(Nexus::getProfile(), &Profile::avatarLoaded, this, &GroupNetCamView::onAvatarLoaded);
 
     selfVideoSurface->setText(Core::getInstance()->getUsername());
 }
@@ -170,9 +180,11 @@ void GroupNetCamView::clearPeers()
 
 void GroupNetCamView::addPeer(const ToxPk& peer, const QString& name)
 {
-    QPixmap groupAvatar = Nexus::getProfile()->loadAvatar(peer);
+    // decoded in the background if it's not cached yet, shows the default avatar until then
+    QPixmap groupAvatar = Nexus::getProfile()->loadAvatar(peer, peerAvatarSize);
     LabeledVideo* labeledVideo = new LabeledVideo(groupAvatar, this);
     labeledVideo->setText(name);
+    labeledVideo->getVideoSurface()->setMaxFps(peerTileMaxFps);
     horLayout->insertWidget(horLayout->count() - 1, labeledVideo);
     PeerVideo peerVideo;
     peerVideo.video = labeledVideo;
@@ -231,6 +243,13 @@ void GroupNetCamView::setActive(const ToxPk& peer)
 #endif
 }
 
+void GroupNetCamView::onAvatarLoaded(const ToxPk& peer, const QPixmap& pixmap, const QSize& size)
+{
+    if (size == peerAvatarSize) {
+        friendAvatarChanged(peer, pixmap);
+    }
+}
+
 void GroupNetCamView::friendAvatarChanged(ToxPk friendPk, const QPixmap& pixmap)
 {
     auto peerVideo = videoList.find(friendPk);
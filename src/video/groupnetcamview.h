@@ -40,6 +40,7 @@ public:
 private slots:
     void onUpdateActivePeer();
     void friendAvatarChanged(ToxPk friendPk, const QPixmap& pixmap);
+    void onAvatarLoaded(const ToxPk& peer, const QPixmap& pixmap, const QSize& size);
 
 private:
     struct PeerVideo
@@ -97,7 +97,11 @@ VideoFrame::VideoFrame(IDType sourceID, AVFrame* sourceFrame, QRect dimensions,
     , sourceDimensions(dimensions)
     , sourceFrameKey(getFrameKey(dimensions.size(), pixFmt, sourceFrame->linesize[0]))
     , freeSourceFrame(freeSourceFrame)
+    , creationTime(VideoStats::now())
 {
+    for (std::atomic<qint64>& stageTime : stageTimes) {
+        stageTime = 0;
+    }
 
     // We override the pixel format in the case a deprecated one is used
     switch (pixFmt) {
@@ -410,6 +414,38 @@ int VideoFrame::getSourcePixelFormat() const
     return sourcePixelFormat;
 }
 
+/**
+ * @brief Returns when this VideoFrame was constructed.
+ *
+ * @return timestamp in VideoStats::now() microseconds.
+ */
+qint64 VideoFrame::getCreationTime() const
+{
+    return creationTime;
+}
+
+/**
+ * @brief Returns when the frame passed through the given pipeline stage.
+ *
+ * @param stage the stage to query.
+ * @return timestamp in VideoStats::now() microseconds, 0 if the frame didn't pass it (yet).
+ */
+qint64 VideoFrame::getStageTime(VideoStats::Stage stage) const
+{
+    return stageTimes[static_cast<int>(stage)].load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Remembers when the frame passed through the given pipeline stage.
+ *
+ * @param stage the stage the frame passed.
+ * @param usec timestamp in VideoStats::now() microseconds.
+ */
+void VideoFrame::setStageTime(VideoStats::Stage stage, qint64 usec)
+{
+    stageTimes[static_cast<int>(stage)].store(usec, std::memory_order_relaxed);
+}
+
 
 /**
  * @brief Constructs a new FrameBufferKey with the given attributes.
@@ -590,6 +626,21 @@ AVFrame* VideoFrame::generateAVFrame(const QSize& dimensions, const int pixelFor
         return nullptr;
     }
 
+    AVFrame* source = frameBuffer[sourceFrameKey];
+    const qint64 convertStart = VideoStats::now();
+
+    // Bypass swscale if only the linesize differs, e.g. raw YUV420P from a camera that toxav
+    // needs frame aligned; a plain plane copy is much cheaper than a scaler pass
+    if (pixelFormat == sourcePixelFormat && dimensions == sourceDimensions.size()) {
+        av_image_copy(ret->data, ret->linesize, const_cast<const uint8_t**>(source->data),
+                      source->linesize, static_cast<AVPixelFormat>(pixelFormat),
+                      dimensions.width(), dimensions.height());
+        const qint64 convertEnd = VideoStats::now();
+        VideoStats::record(VideoStats::Stage::Convert, convertEnd - convertStart);
+        setStageTime(VideoStats::Stage::Convert, convertEnd);
+        return ret;
+    }
+
     // Bilinear is better for shrinking, bicubic better for upscaling
     int resizeAlgo = sourceDimensions.width() > dimensions.width() ? SWS_BILINEAR : SWS_BICUBIC;
 
@@ -608,12 +659,14 @@ AVFrame* VideoFrame::generateAVFrame(const QSize& dimensions, const int pixelFor
         return nullptr;
     }
 
-    AVFrame* source = frameBuffer[sourceFrameKey];
-
     sws_scale(swsCtx, source->data, source->linesize, 0, sourceDimensions.height(), ret->data,
               ret->linesize);
     sws_freeContext(swsCtx);
 
+    const qint64 convertEnd = VideoStats::now();
+    VideoStats::record(VideoStats::Stage::Convert, convertEnd - convertStart);
+    setStageTime(VideoStats::Stage::Convert, convertEnd);
+
     return ret;
 }
 
@@ -26,6 +26,8 @@
 #include <QRect>
 #include <QSize>
 
+#include "videostats.h"
+
 extern "C" {
 #include <libavcodec/avcodec.h>
 }
@@ -89,6 +91,10 @@ public:
     QRect getSourceDimensions() const;
     int getSourcePixelFormat() const;
 
+    qint64 getCreationTime() const;
+    qint64 getStageTime(VideoStats::Stage stage) const;
+    void setStageTime(VideoStats::Stage stage, qint64 usec);
+
     static constexpr int dataAlignment = 32;
 
 private:
@@ -150,6 +156,10 @@ private:
     const FrameBufferKey sourceFrameKey;
     const bool freeSourceFrame;
 
+    // Pipeline timestamps
+    const qint64 creationTime;
+    std::atomic<qint64> stageTimes[VideoStats::stageCount];
+
     // Reference store
     static AtomicIDType frameIDs;
 
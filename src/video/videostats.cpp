@@ -0,0 +1,160 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "videostats.h"
+
+#include <QStringList>
+
+#include <chrono>
+
+/**
+ * @class VideoStats
+ * @brief Lock-free latency histograms for the stages of the video pipeline.
+ *
+ * Every stage keeps a PowerOfTwoHistogram of microseconds. Recording is a couple of relaxed atomic
+ * increments, so it is safe to call from the camera, toxav and GUI threads.
+ *
+ * @enum VideoStats::Stage
+ * @brief Measured parts of the pipeline.
+ *
+ * @var Capture
+ * @brief Reading and decoding a camera frame, in CameraSource::stream.
+ * @var Convert
+ * @brief Scaling or converting a frame to another size or pixel format.
+ * @var EncodeSubmit
+ * @brief Handing a frame to toxav_video_send_frame, which encodes it synchronously.
+ * @var Receive
+ * @brief Copying a frame received from toxav into a VideoFrame.
+ * @var Render
+ * @brief Age of a frame when it gets painted by a VideoSurface.
+ */
+
+VideoStats::Histogram VideoStats::histograms[VideoStats::stageCount];
+
+/**
+ * @brief Monotonic timestamp used for all pipeline measurements.
+ * @return Microseconds since an unspecified epoch.
+ */
+qint64 VideoStats::now()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Adds a sample to the histogram of a stage.
+ * @param stage Stage the sample belongs to.
+ * @param usec Duration in microseconds, negative values are ignored.
+ */
+void VideoStats::record(Stage stage, qint64 usec)
+{
+    if (usec < 0) {
+        return;
+    }
+
+    Histogram& hist = histograms[static_cast<int>(stage)];
+    hist.buckets.add(static_cast<uint64_t>(usec));
+    hist.count.fetch_add(1, std::memory_order_relaxed);
+    hist.total.fetch_add(static_cast<quint64>(usec), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Clears all histograms.
+ */
+void VideoStats::reset()
+{
+    for (Histogram& hist : histograms) {
+        hist.buckets.reset();
+        hist.count = 0;
+        hist.total = 0;
+    }
+}
+
+/**
+ * @brief Get a copy of the buckets of a stage.
+ * @param stage Stage to get the histogram of.
+ * @return Sample count per bucket.
+ */
+QVector<uint64_t> VideoStats::getHistogram(Stage stage)
+{
+    return histograms[static_cast<int>(stage)].buckets.getBuckets();
+}
+
+quint64 VideoStats::getCount(Stage stage)
+{
+    return histograms[static_cast<int>(stage)].count.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get the mean duration of a stage.
+ * @param stage Stage to average.
+ * @return Mean in microseconds, 0 if there are no samples.
+ */
+qint64 VideoStats::getAverage(Stage stage)
+{
+    const Histogram& hist = histograms[static_cast<int>(stage)];
+    const quint64 count = hist.count.load(std::memory_order_relaxed);
+    if (count == 0) {
+        return 0;
+    }
+
+    return static_cast<qint64>(hist.total.load(std::memory_order_relaxed) / count);
+}
+
+QString VideoStats::getStageName(Stage stage)
+{
+    switch (stage) {
+    case Stage::Capture:
+        return QStringLiteral("capture");
+    case Stage::Convert:
+        return QStringLiteral("convert");
+    case Stage::EncodeSubmit:
+        return QStringLiteral("encode-submit");
+    case Stage::Receive:
+        return QStringLiteral("receive");
+    case Stage::Render:
+        return QStringLiteral("render");
+    }
+
+    return QString{};
+}
+
+/**
+ * @brief Formats all non-empty histograms for logging.
+ * @return One line per stage with sample count, mean and bucket counts.
+ */
+QString VideoStats::report()
+{
+    QStringList lines;
+    for (int i = 0; i < stageCount; ++i) {
+        const Stage stage = static_cast<Stage>(i);
+        const quint64 count = getCount(stage);
+        if (count == 0) {
+            continue;
+        }
+
+        lines << QStringLiteral("%1: n=%2 avg=%3us [%4]")
+                     .arg(getStageName(stage))
+                     .arg(count)
+                     .arg(getAverage(stage))
+                     .arg(histograms[i].buckets.toString());
+    }
+
+    return lines.join('\n');
+}
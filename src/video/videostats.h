@@ -0,0 +1,66 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef VIDEOSTATS_H
+#define VIDEOSTATS_H
+
+#include "src/core/poweroftwohistogram.h"
+
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <cstdint>
+
+class VideoStats
+{
+public:
+    enum class Stage
+    {
+        Capture,
+        Convert,
+        EncodeSubmit,
+        Receive,
+        Render
+    };
+
+    static constexpr int stageCount = static_cast<int>(Stage::Render) + 1;
+
+    static qint64 now();
+    static void record(Stage stage, qint64 usec);
+    static void reset();
+
+    static QVector<uint64_t> getHistogram(Stage stage);
+    static quint64 getCount(Stage stage);
+    static qint64 getAverage(Stage stage);
+    static QString getStageName(Stage stage);
+    static QString report();
+
+private:
+    struct Histogram
+    {
+        PowerOfTwoHistogram buckets;
+        std::atomic<quint64> count;
+        std::atomic<quint64> total;
+    };
+
+    static Histogram histograms[stageCount];
+};
+
+#endif // VIDEOSTATS_H
@@ -23,16 +23,24 @@
 #include "src/friendlist.h"
 #include "src/persistence/settings.h"
 #include "src/video/videoframe.h"
+#include "src/video/videostats.h"
 #include "src/widget/friendwidget.h"
 #include "src/widget/style.h"
 
 #include <QDebug>
 #include <QLabel>
 #include <QPainter>
+#include <QTimer>
 
 /**
  * @var std::atomic_bool VideoSurface::frameLock
  * @brief Fast lock for lastFrame.
+ *
+ * @var int VideoSurface::frameInterval
+ * @brief Minimum time between two repaints in ms, 0 means every frame is painted.
+ *
+ * @var QTimer* VideoSurface::updateTimer
+ * @brief Delivers a postponed repaint once the frame interval has passed.
  */
 
 float getSizeRatio(const QSize size)
@@ -48,7 +56,11 @@ VideoSurface::VideoSurface(const QPixmap& avatar, QWidget* parent, bool expandin
     , avatar{avatar}
     , ratio{1.0f}
     , expanding{expanding}
+    , frameInterval{0}
+    , updateTimer{new QTimer(this)}
 {
+    updateTimer->setSingleShot(true);
+    connect(updateTimer, &QTimer::timeout, this, &VideoSurface::onUpdateTimeout);
     recalulateBounds();
 }
 
@@ -108,6 +120,18 @@ QPixmap VideoSurface::getAvatar() const
     return avatar;
 }
 
+/**
+ * @brief Limits how often new frames are painted.
+ * @param fps Maximum repaints per second, 0 to paint every frame.
+ *
+ * Frames arriving faster than that replace the pending one and are painted together with the
+ * next scheduled repaint.
+ */
+void VideoSurface::setMaxFps(int fps)
+{
+    frameInterval = fps > 0 ? 1000 / fps : 0;
+}
+
 void VideoSurface::subscribe()
 {
     if (source && hasSubscribed++ == 0) {
@@ -157,6 +181,28 @@ void VideoSurface::onNewFrameAvailable(const std::shared_ptr<VideoFrame>& newFra
         emit boundaryChanged();
     }
 
+    // Nothing to paint, we'll be repainted with the latest frame once exposed again
+    if (!isExposed()) {
+        return;
+    }
+
+    // A repaint is already pending and will pick up the latest frame
+    if (updateTimer->isActive()) {
+        return;
+    }
+
+    const qint64 elapsed = lastUpdate.isValid() ? lastUpdate.elapsed() : frameInterval;
+    if (elapsed < frameInterval) {
+        updateTimer->start(frameInterval - elapsed);
+        return;
+    }
+
+    onUpdateTimeout();
+}
+
+void VideoSurface::onUpdateTimeout()
+{
+    lastUpdate.start();
     update();
 }
 
@@ -174,10 +220,20 @@ void VideoSurface::paintEvent(QPaintEvent*)
     QPainter painter(this);
     painter.fillRect(painter.viewport(), Qt::black);
     if (lastFrame) {
-        QImage frame = lastFrame->toQImage(rect().size());
-        if (frame.isNull())
-            lastFrame.reset();
-        painter.drawImage(boundingRect, frame, frame.rect(), Qt::NoFormatConversion);
+        // Convert straight to the displayed size, small tiles shouldn't pay for big frames
+        if (!boundingRect.isEmpty()) {
+            QImage frame = lastFrame->toQImage(boundingRect.size());
+            if (frame.isNull()) {
+                lastFrame.reset();
+            } else if (!lastFrame->getStageTime(VideoStats::Stage::Render)) {
+                // Only the first paint of a frame tells us how long it took to show up
+                const qint64 renderTime = VideoStats::now();
+                lastFrame->setStageTime(VideoStats::Stage::Render, renderTime);
+                VideoStats::record(VideoStats::Stage::Render,
+                                   renderTime - lastFrame->getCreationTime());
+            }
+            painter.drawImage(boundingRect, frame, frame.rect(), Qt::NoFormatConversion);
+        }
     } else {
         painter.fillRect(boundingRect, Qt::white);
         QPixmap drawnAvatar = avatar;
@@ -205,6 +261,15 @@ void VideoSurface::showEvent(QShowEvent* e)
     // emit ratioChanged();
 }
 
+/**
+ * @brief Checks if any part of the surface can currently be seen.
+ * @return False if the surface is hidden, scrolled out of view or its window is minimized.
+ */
+bool VideoSurface::isExposed() const
+{
+    return isVisible() && !window()->isMinimized() && !visibleRegion().isEmpty();
+}
+
 void VideoSurface::recalulateBounds()
 {
     if (expanding) {
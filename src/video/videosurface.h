@@ -21,6 +21,7 @@
 #define SELFCAMVIEW_H
 
 #include "src/video/videosource.h"
+#include <QElapsedTimer>
 #include <QWidget>
 #include <atomic>
 #include <memory>
@@ -40,6 +41,7 @@ public:
     float getRatio() const;
     void setAvatar(const QPixmap& pixmap);
     QPixmap getAvatar() const;
+    void setMaxFps(int fps);
 
 signals:
     void ratioChanged();
@@ -56,8 +58,10 @@ protected:
 private slots:
     void onNewFrameAvailable(const std::shared_ptr<VideoFrame>& newFrame);
     void onSourceStopped();
+    void onUpdateTimeout();
 
 private:
+    bool isExposed() const;
     void recalulateBounds();
     void lock();
     void unlock();
@@ -70,6 +74,9 @@ private:
     QPixmap avatar;
     float ratio;
     bool expanding;
+    int frameInterval;
+    QElapsedTimer lastUpdate;
+    QTimer* updateTimer;
 };
 
 #endif // SELFCAMVIEW_H
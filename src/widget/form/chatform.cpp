@@ -157,7 +157,7 @@ ChatForm::ChatForm(Friend* chatFriend, History* history)
         menu.addAction(QIcon::fromTheme("document-save"), QString(), this, SLOT(onExportChat()));
 
     const Core* core = Core::getInstance();
-    const Profile* profile = Nexus::getProfile();
+    Profile* profile = Nexus::getProfile();
     connect(core, &Core::fileReceiveRequested, this, &ChatForm::onFileRecvRequest);
     connect(profile, &Profile::friendAvatarChanged, this, &ChatForm::onAvatarChanged);
     connect(core, &Core::fileSendStarted, this, &ChatForm::startFileSend);
@@ -165,12 +165,18 @@ ChatForm::ChatForm(Friend* chatFriend, History* history)
     connect(core, &Core::fileTransferCancelled, this, &ChatForm::onFileTransferCancelled);
     connect(core, &Core::fileTransferBrokenUnbroken, this, &ChatForm::onFileTransferBrokenUnbroken);
     connect(core, &Core::fileSendFailed, this, &ChatForm::onFileSendFailed);
-    connect(core, &Core::receiptRecieved, this, &ChatForm::onReceiptReceived);
+    connect(core, &Core::receiptsReceived, this, &ChatForm::onReceiptsReceived);
     connect(core, &Core::friendMessageReceived, this, &ChatForm::onFriendMessageReceived);
     connect(core, &Core::friendTypingChanged, this, &ChatForm::onFriendTypingChanged);
     connect(core, &Core::friendStatusChanged, this, &ChatForm::onFriendStatusChanged);
     connect(core, &Core::fileNameChanged, this, &ChatForm::onFileNameChanged);
 
+    // decoded in the background if it's not cached yet, Widget passes it to onAvatarLoaded
+    const QPixmap avatar = profile->loadAvatar(f->getPublicKey(), headWidget->getAvatarSize());
+    if (!avatar.isNull()) {
+        onAvatarChanged(f->getPublicKey(), avatar);
+    }
+
 
     const CoreAV* av = core->getAv();
     connect(av, &CoreAV::avInvite, this, &ChatForm::onAvInvite);
@@ -329,19 +335,28 @@ void ChatForm::startFileSend(ToxFile file)
 
 void ChatForm::onFileTransferFinished(ToxFile file)
 {
-    history->setFileFinished(file.resumeFileId, true, file.filePath, file.hashGenerator->result());
+    // every chat form gets the signal, only one may update the history entry
+    if (file.friendId != f->getId()) {
+        return;
+    }
+
+    history->setFileFinished(file.resumeFileId, true, file.filePath, file.getHash());
 }
 
 void ChatForm::onFileTransferBrokenUnbroken(ToxFile file, bool broken)
 {
-    if (broken) {
-        history->setFileFinished(file.resumeFileId, false, file.filePath, file.hashGenerator->result());
+    if (broken && file.friendId == f->getId()) {
+        history->setFileFinished(file.resumeFileId, false, file.filePath, file.getHash());
     }
 }
 
 void ChatForm::onFileTransferCancelled(ToxFile file)
 {
-    history->setFileFinished(file.resumeFileId, false, file.filePath, file.hashGenerator->result());
+    if (file.friendId != f->getId()) {
+        return;
+    }
+
+    history->setFileFinished(file.resumeFileId, false, file.filePath, file.getHash());
 }
 
 void ChatForm::onFileRecvRequest(ToxFile file)
@@ -684,9 +699,13 @@ void ChatForm::onStatusMessage(const QString& message)
     }
 }
 
-void ChatForm::onReceiptReceived(quint32 friendId, int receipt)
+void ChatForm::onReceiptsReceived(quint32 friendId, const QVector<int>& receipts)
 {
-    if (friendId == f->getId()) {
+    if (friendId != f->getId()) {
+        return;
+    }
+
+    for (int receipt : receipts) {
         offlineEngine->dischargeReceipt(receipt);
     }
 }
@@ -700,6 +719,13 @@ void ChatForm::onAvatarChanged(const ToxPk& friendPk, const QPixmap& pic)
     headWidget->setAvatar(pic);
 }
 
+void ChatForm::onAvatarLoaded(const ToxPk& friendPk, const QPixmap& pic, const QSize& size)
+{
+    if (size == headWidget->getAvatarSize()) {
+        onAvatarChanged(friendPk, pic);
+    }
+}
+
 GenericNetCamView* ChatForm::createNetcam()
 {
     qDebug() << "creating netcam";
@@ -907,7 +933,15 @@ ChatMessage::Ptr ChatForm::chatMessageFromHistMessage(History::HistMessage const
         break;
     }
     case HistMessageContentType::file: {
-        auto& file = histMessage.content.asFile();
+        ToxFile file = histMessage.content.asFile();
+        // a transfer resumed from a previous session continues in its history entry
+        const QString fileId = QString::fromUtf8(file.resumeFileId);
+        ToxFile transfer;
+        if (file.status != ToxFile::FINISHED
+            && Core::getInstance()->findFileTransfer(f->getId(), fileId, transfer)) {
+            file = transfer;
+        }
+
         bool isMe = file.direction == ToxFile::SENDING;
         msg = ChatMessage::createFileTransferMessage(authorStr, file, isMe, dateTime);
         break;
@@ -76,6 +76,7 @@ public slots:
     void onAvStart(uint32_t friendId, bool video);
     void onAvEnd(uint32_t friendId, bool error);
     void onAvatarChanged(const ToxPk& friendPk, const QPixmap& pic);
+    void onAvatarLoaded(const ToxPk& friendPk, const QPixmap& pic, const QSize& size);
     void onFileNameChanged(const ToxPk& friendPk);
     void clearChatArea();
 
@@ -103,7 +104,7 @@ private slots:
     void onFriendNameChanged(const QString& name);
     void onFriendMessageReceived(quint32 friendId, const QString& message, bool isAction);
     void onStatusMessage(const QString& message);
-    void onReceiptReceived(quint32 friendId, int receipt);
+    void onReceiptsReceived(quint32 friendId, const QVector<int>& receipts);
     void onLoadHistory();
     void onUpdateTime();
     void sendImage(const QPixmap& pixmap);
@@ -260,6 +260,7 @@ void GroupChatForm::updateUserNames()
      * needs it in alphabetical order, so we first create and store the labels
      * and then sort them by their text and add them to the layout in that order */
     const auto selfPk = Core::getInstance()->getSelfPublicKey();
+    const auto mutedPeers = Settings::getInstance().getMutedPeers();
     for (const auto& peerPk : peers.keys()) {
         const QString fullName = peers.value(peerPk);
         const QString editedName = editName(fullName).append(QLatin1String(", "));
@@ -270,12 +271,11 @@ void GroupChatForm::updateUserNames()
         label->setTextFormat(Qt::PlainText);
         label->setContextMenuPolicy(Qt::CustomContextMenu);
 
-        const Settings& s = Settings::getInstance();
         connect(label, &QLabel::customContextMenuRequested, this, &GroupChatForm::onLabelContextMenuRequested);
 
         if (peerPk == selfPk) {
             label->setProperty("peerType", LABEL_PEER_TYPE_OUR);
-        } else if (s.getBlackList().contains(peerPk.toString())) {
+        } else if (mutedPeers->contains(peerPk)) {
             label->setProperty("peerType", LABEL_PEER_TYPE_MUTED);
         } else if (netcam != nullptr) {
             static_cast<GroupNetCamView*>(netcam)->addPeer(peerPk, fullName);
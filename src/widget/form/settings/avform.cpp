@@ -580,7 +580,7 @@ void AVForm::on_playbackSlider_valueChanged(int sliderSteps)
         audio->setOutputVolume(volume);
 
         if (cbEnableTestSound->isChecked())
-            audio->playMono16Sound(Audio::getSound(Audio::Sound::Test));
+            audio->playSound(Audio::Sound::Test);
     }
 }
 
@@ -589,7 +589,7 @@ void AVForm::on_cbEnableTestSound_stateChanged()
     audioSettings->setEnableTestSound(cbEnableTestSound->isChecked());
 
     if (cbEnableTestSound->isChecked() && audio->isOutputReady())
-        audio->playMono16Sound(Audio::getSound(Audio::Sound::Test));
+        audio->playSound(Audio::Sound::Test);
 }
 
 void AVForm::on_microphoneSlider_valueChanged(int sliderSteps)
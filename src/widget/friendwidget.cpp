@@ -403,6 +403,14 @@ void FriendWidget::onAvatarSet(const ToxPk& friendPk, const QPixmap& pic)
     avatar->setPixmap(pic);
 }
 
+void FriendWidget::onAvatarLoaded(const ToxPk& friendPk, const QPixmap& pic, const QSize& size)
+{
+    // also delivered for the other sizes the avatar is shown in
+    if (size == getAvatarSize()) {
+        onAvatarSet(friendPk, pic);
+    }
+}
+
 void FriendWidget::onAvatarRemoved(const ToxPk& friendPk)
 {
     const auto frnd = chatroom->getFriend();
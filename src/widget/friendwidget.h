@@ -53,6 +53,7 @@ signals:
 
 public slots:
     void onAvatarSet(const ToxPk& friendPk, const QPixmap& pic);
+    void onAvatarLoaded(const ToxPk& friendPk, const QPixmap& pic, const QSize& size);
     void onAvatarRemoved(const ToxPk& friendPk);
     void onContextMenuCalled(QContextMenuEvent* event);
     void setActive(bool active);
@@ -158,6 +158,11 @@ QString GenericChatroomWidget::getTitle() const
     return title;
 }
 
+QSize GenericChatroomWidget::getAvatarSize() const
+{
+    return avatar->size();
+}
+
 void GenericChatroomWidget::reloadTheme()
 {
     QPalette p;
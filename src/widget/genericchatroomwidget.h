@@ -59,6 +59,7 @@ public slots:
     void setStatusMsg(const QString& status);
     QString getStatusMsg() const;
     QString getTitle() const;
+    QSize getAvatarSize() const;
 
     void reloadTheme();
 
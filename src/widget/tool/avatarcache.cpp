@@ -0,0 +1,192 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "avatarcache.h"
+#include "src/widget/tool/identicon.h"
+
+#include <QBuffer>
+#include <QGuiApplication>
+#include <QImageReader>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+// memory cache size in KiB
+const int MEMORY_CACHE_SIZE = 32 * 1024;
+} // namespace
+
+/**
+ * @class AvatarCache
+ * @brief Decoded avatars of contacts, scaled to the size they are shown in.
+ *
+ * Avatars are read, decoded and scaled on a worker thread, so showing many contacts at once
+ * doesn't block the GUI. They are scaled for the highest device pixel ratio of the screens.
+ * Cached pixmaps are keyed by owner, size and device pixel ratio, and dropped when the avatar of
+ * their owner changes.
+ *
+ * Must only be used from the GUI thread.
+ */
+
+AvatarCache::AvatarCache()
+{
+    avatars.setMaxCost(MEMORY_CACHE_SIZE);
+}
+
+/**
+ * @brief Returns the singleton instance.
+ */
+AvatarCache& AvatarCache::getInstance()
+{
+    static AvatarCache instance;
+    return instance;
+}
+
+/**
+ * @brief Get an avatar scaled to fit into a size.
+ * @param owner PK of the avatar owner.
+ * @param loadData Returns the avatar image data, called on the worker thread. An Identicon is
+ * used if it's empty and identicon is true.
+ * @param identicon True if Identicons are shown for contacts without avatar.
+ * @param size Size in device independent pixels.
+ * @return The avatar if it's cached, a null pixmap otherwise. It's loaded in the background
+ * then and delivered by avatarLoaded, if there is one.
+ */
+QPixmap AvatarCache::getAvatar(const ToxPk& owner, std::function<QByteArray()> loadData,
+                               bool identicon, const QSize& size)
+{
+    const qreal dpr = qApp->devicePixelRatio();
+    const QString key = QString("%1|%2x%3|%4|%5")
+                            .arg(QString::fromLatin1(owner.getKey().toHex()))
+                            .arg(size.width())
+                            .arg(size.height())
+                            .arg(dpr)
+                            .arg(identicon);
+    if (QPixmap* cached = avatars.object(key)) {
+        return *cached;
+    }
+
+    if (pending.contains(key)) {
+        return QPixmap{};
+    }
+
+    pending.insert(key);
+    const quint64 requestedAt = changeCount;
+    QtConcurrent::run(&pool, [this, owner, loadData, identicon, size, dpr, key, requestedAt] {
+        const QImage image = decode(owner, loadData(), identicon, size * dpr);
+        QMetaObject::invokeMethod(this, "onAvatarDecoded", Qt::QueuedConnection,
+                                  Q_ARG(ToxPk, owner), Q_ARG(QString, key), Q_ARG(QImage, image),
+                                  Q_ARG(QSize, size), Q_ARG(qreal, dpr),
+                                  Q_ARG(quint64, requestedAt));
+    });
+
+    return QPixmap{};
+}
+
+/**
+ * @brief Drop the cached avatars of a contact, and ignore those still being decoded.
+ * @param owner PK of the avatar owner.
+ */
+void AvatarCache::invalidate(const ToxPk& owner)
+{
+    changedAt[owner] = ++changeCount;
+
+    const QString prefix = QString::fromLatin1(owner.getKey().toHex()) + '|';
+    for (const QString& key : avatars.keys()) {
+        if (key.startsWith(prefix)) {
+            avatars.remove(key);
+        }
+    }
+
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (it->startsWith(prefix)) {
+            it = pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/**
+ * @brief Drop all cached avatars, used when the profile is unloaded or its password changes.
+ *
+ * Drops the avatars that are still queued and waits for those being loaded, so the data
+ * loaders they use can be released after.
+ */
+void AvatarCache::clear()
+{
+    pool.clear();
+    pool.waitForDone();
+    clearedAt = ++changeCount;
+    changedAt.clear();
+    avatars.clear();
+    pending.clear();
+}
+
+void AvatarCache::onAvatarDecoded(const ToxPk& owner, const QString& key, const QImage& image,
+                                  const QSize& size, qreal dpr, quint64 requestedAt)
+{
+    // outdated by a change of the avatar since it was requested
+    if (requestedAt < clearedAt || requestedAt < changedAt.value(owner)) {
+        return;
+    }
+
+    pending.remove(key);
+    if (image.isNull()) {
+        return;
+    }
+
+    QPixmap avatar = QPixmap::fromImage(image);
+    avatar.setDevicePixelRatio(dpr);
+    const int cost = qMax(1, image.width() * image.height() * 4 / 1024);
+    avatars.insert(key, new QPixmap{avatar}, cost);
+    emit avatarLoaded(owner, avatar, size);
+}
+
+QImage AvatarCache::decode(const ToxPk& owner, const QByteArray& data, bool identicon,
+                           const QSize& pixelSize)
+{
+    QImage image;
+    if (data.isEmpty()) {
+        if (!identicon) {
+            return image;
+        }
+
+        image = Identicon(owner.getKey()).toImage(16);
+    } else {
+        QBuffer buffer;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader{&buffer};
+        const QSize imageSize = reader.size();
+        if (imageSize.width() > pixelSize.width() || imageSize.height() > pixelSize.height()) {
+            // the decoder only produces the pixels needed for that size
+            reader.setScaledSize(imageSize.scaled(pixelSize, Qt::KeepAspectRatio));
+        }
+
+        image = reader.read();
+        if (image.isNull()) {
+            return image;
+        }
+    }
+
+    if (image.size() != pixelSize) {
+        image = image.scaled(pixelSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    return image;
+}
@@ -0,0 +1,74 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AVATARCACHE_H
+#define AVATARCACHE_H
+
+#include "src/core/toxpk.h"
+
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+
+#include <functional>
+
+class AvatarCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static AvatarCache& getInstance();
+
+    QPixmap getAvatar(const ToxPk& owner, std::function<QByteArray()> loadData, bool identicon,
+                      const QSize& size);
+    void invalidate(const ToxPk& owner);
+    void clear();
+
+signals:
+    void avatarLoaded(const ToxPk& owner, const QPixmap& avatar, const QSize& size);
+
+private slots:
+    void onAvatarDecoded(const ToxPk& owner, const QString& key, const QImage& image,
+                         const QSize& size, qreal dpr, quint64 requestedAt);
+
+private:
+    AvatarCache();
+    AvatarCache(AvatarCache&) = delete;
+    AvatarCache& operator=(const AvatarCache&) = delete;
+
+    static QImage decode(const ToxPk& owner, const QByteArray& data, bool identicon,
+                         const QSize& pixelSize);
+
+private:
+    QThreadPool pool;
+    QCache<QString, QPixmap> avatars;
+    QSet<QString> pending;
+    QHash<ToxPk, quint64> changedAt;
+    quint64 changeCount = 0;
+    quint64 clearedAt = 0;
+};
+
+#endif // AVATARCACHE_H
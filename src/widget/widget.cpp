@@ -242,6 +242,7 @@ void Widget::init()
     connect(actionLogout, &QAction::triggered, profileForm, &ProfileForm::onLogoutClicked);
 
     connect(profile, &Profile::selfAvatarChanged, profileForm, &ProfileForm::onSelfAvatarLoaded);
+    connect(profile, &Profile::avatarLoaded, this, &Widget::onFriendAvatarLoaded);
 
     const Settings& s = Settings::getInstance();
 
@@ -946,21 +947,19 @@ void Widget::incomingNotification(uint32_t friendId)
     newFriendMessageAlert(friendId, false);
 
     Audio& audio = Audio::getInstance();
-    audio.startLoop();
-    audio.playMono16Sound(Audio::getSound(Audio::Sound::IncomingCall));
+    audio.startLoop(Audio::Sound::IncomingCall);
 }
 
 void Widget::outgoingNotification()
 {
     Audio& audio = Audio::getInstance();
-    audio.startLoop();
-    audio.playMono16Sound(Audio::getSound(Audio::Sound::OutgoingCall));
+    audio.startLoop(Audio::Sound::OutgoingCall);
 }
 
 void Widget::onCallEnd()
 {
     Audio& audio = Audio::getInstance();
-    audio.playMono16Sound(Audio::getSound(Audio::Sound::CallEnd));
+    audio.playSound(Audio::Sound::CallEnd);
 }
 
 /**
@@ -1022,10 +1021,9 @@ void Widget::addFriend(uint32_t friendId, const ToxPk& friendPk)
     connect(profile, &Profile::friendAvatarSet, widget, &FriendWidget::onAvatarSet);
     connect(profile, &Profile::friendAvatarRemoved, widget, &FriendWidget::onAvatarRemoved);
 
-    // Try to get the avatar from the cache
-    QPixmap avatar = Nexus::getProfile()->loadAvatar(friendPk);
+    // Try to get the avatar from the cache, it's decoded in the background otherwise
+    QPixmap avatar = profile->loadAvatar(friendPk, widget->getAvatarSize());
     if (!avatar.isNull()) {
-        friendForm->onAvatarChanged(friendPk, avatar);
         widget->onAvatarSet(friendPk, avatar);
     }
 
@@ -1282,8 +1280,10 @@ void Widget::addFriendDialog(const Friend* frnd, ContentDialog* dialog)
     Profile* profile = Nexus::getProfile();
     connect(profile, &Profile::friendAvatarSet, friendWidget, &FriendWidget::onAvatarSet);
     connect(profile, &Profile::friendAvatarRemoved, friendWidget, &FriendWidget::onAvatarRemoved);
+    dialogFriendWidgets.remove(frnd->getPublicKey(), QPointer<FriendWidget>{});
+    dialogFriendWidgets.insert(frnd->getPublicKey(), friendWidget);
 
-    QPixmap avatar = Nexus::getProfile()->loadAvatar(frnd->getPublicKey());
+    QPixmap avatar = profile->loadAvatar(frnd->getPublicKey(), friendWidget->getAvatarSize());
     if (!avatar.isNull()) {
         friendWidget->onAvatarSet(frnd->getPublicKey(), avatar);
     }
@@ -1460,8 +1460,7 @@ bool Widget::newMessageAlert(QWidget* currentWindow, bool isActive, bool sound,
             bool notifySound = Settings::getInstance().getNotifySound();
 
             if (notifySound && sound && (!isBusy || busySound)) {
-                QString soundPath = Audio::getSound(Audio::Sound::NewMessage);
-                Audio::getInstance().playMono16Sound(soundPath);
+                Audio::getInstance().playSound(Audio::Sound::NewMessage);
             }
         }
     }
@@ -1521,6 +1520,7 @@ void Widget::removeFriend(Friend* f, bool fake)
         lastDialog->removeFriend(friendId);
     }
 
+    dialogFriendWidgets.remove(f->getPublicKey());
     FriendList::removeFriend(friendId, fake);
     Nexus::getCore()->removeFriend(friendId, fake);
 
@@ -1740,7 +1740,7 @@ void Widget::onGroupMessageReceived(int groupnumber, int peernumber, const QStri
     bool isSelf = author == core->getSelfId().getPublicKey();
 
     const Settings& s = Settings::getInstance();
-    if (s.getBlackList().contains(author.toString())) {
+    if (s.isPeerMuted(author)) {
         qDebug() << "onGroupMessageReceived: Filtered:" << author.toString();
         return;
     }
@@ -2134,6 +2134,35 @@ void Widget::onSplitterMoved(int pos, int index)
     saveSplitterGeometry();
 }
 
+/**
+ * @brief Pass an avatar decoded in the background to the widgets of its owner.
+ *
+ * Routed here once instead of every friend widget filtering every decoded avatar, which would
+ * take quadratic time while the avatars of a long friend list are loaded.
+ */
+void Widget::onFriendAvatarLoaded(const ToxPk& friendPk, const QPixmap& pic, const QSize& size)
+{
+    const Friend* f = FriendList::findFriend(friendPk);
+    if (!f) {
+        return;
+    }
+
+    const uint32_t friendId = f->getId();
+    if (FriendWidget* widget = friendWidgets.value(friendId)) {
+        widget->onAvatarLoaded(friendPk, pic, size);
+    }
+
+    if (ChatForm* form = chatForms.value(friendId)) {
+        form->onAvatarLoaded(friendPk, pic, size);
+    }
+
+    for (const QPointer<FriendWidget>& widget : dialogFriendWidgets.values(friendPk)) {
+        if (widget) {
+            widget->onAvatarLoaded(friendPk, pic, size);
+        }
+    }
+}
+
 void Widget::cycleContacts(bool forward)
 {
     contactListWidget->cycleContacts(activeChatroomWidget, forward);
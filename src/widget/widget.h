@@ -23,6 +23,7 @@
 #include "ui_mainwindow.h"
 
 #include <QFileInfo>
+#include <QHash>
 #include <QMainWindow>
 #include <QPointer>
 #include <QSystemTrayIcon>
@@ -213,6 +214,7 @@ private slots:
     void onTryCreateTrayIcon();
     void onSetShowSystemTray(bool newValue);
     void onSplitterMoved(int pos, int index);
+    void onFriendAvatarLoaded(const ToxPk& friendPk, const QPixmap& pic, const QSize& size);
     void friendListContextMenu(const QPoint& pos);
     void friendRequestsUpdate();
     void groupInvitesUpdate();
@@ -307,6 +309,8 @@ private:
     QMap<uint32_t, FriendWidget*> friendWidgets;
     QMap<uint32_t, std::shared_ptr<FriendChatroom>> friendChatrooms;
     QMap<uint32_t, ChatForm*> chatForms;
+    // friend widgets of content dialogs, which delete them
+    QMultiHash<ToxPk, QPointer<FriendWidget>> dialogFriendWidgets;
 
     QMap<uint32_t, GroupWidget*> groupWidgets;
     QMap<uint32_t, std::shared_ptr<GroupChatroom>> groupChatrooms;
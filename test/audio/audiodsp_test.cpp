@@ -0,0 +1,186 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "src/audio/dsp/audiodsp.h"
+
+#include <QtTest/QtTest>
+#include <QVector>
+
+#include <cstring>
+#include <random>
+
+using namespace AudioDsp;
+
+namespace {
+// odd sizes to exercise the scalar tails of the vector kernels
+const int sizes[] = {0, 1, 7, 8, 15, 16, 17, 33, 960, 1920, 4097};
+const float gains[] = {0.0f, 0.5f, 1.0f, 1.37f, 31.6f, -2.0f};
+
+QVector<int16_t> randomSamples(std::mt19937& rng, int count)
+{
+    std::uniform_int_distribution<int> dist(-32768, 32767);
+    QVector<int16_t> samples(count);
+    for (int16_t& s : samples) {
+        s = static_cast<int16_t>(dist(rng));
+    }
+
+    // make sure the extremes are covered
+    if (count > 3) {
+        samples[0] = -32768;
+        samples[1] = 32767;
+        samples[2] = 0;
+    }
+
+    return samples;
+}
+
+QVector<const Kernels*> vectorKernels()
+{
+    QVector<const Kernels*> result;
+    for (Isa isa : {Isa::Sse2, Isa::Avx2, Isa::Neon}) {
+        if (const Kernels* k = getKernels(isa)) {
+            result.append(k);
+        }
+    }
+    return result;
+}
+}
+
+class TestAudioDsp : public QObject
+{
+    Q_OBJECT
+private slots:
+    void gainTest();
+    void meterTest();
+    void floatTest();
+    void mixTest();
+    void scalarValuesTest();
+};
+
+void TestAudioDsp::gainTest()
+{
+    std::mt19937 rng(1);
+    const Kernels* ref = getKernels(Isa::Scalar);
+    for (const Kernels* k : vectorKernels()) {
+        for (int n : sizes) {
+            const QVector<int16_t> samples = randomSamples(rng, n);
+            for (float gain : gains) {
+                QVector<int16_t> expected = samples;
+                QVector<int16_t> actual = samples;
+                ref->applyGain(expected.data(), n, gain);
+                k->applyGain(actual.data(), n, gain);
+                QCOMPARE(actual, expected);
+            }
+        }
+    }
+}
+
+void TestAudioDsp::meterTest()
+{
+    std::mt19937 rng(2);
+    const Kernels* ref = getKernels(Isa::Scalar);
+    for (const Kernels* k : vectorKernels()) {
+        for (int n : sizes) {
+            const QVector<int16_t> samples = randomSamples(rng, n);
+            QCOMPARE(k->sumOfSquares(samples.data(), n), ref->sumOfSquares(samples.data(), n));
+            QCOMPARE(k->peak(samples.data(), n), ref->peak(samples.data(), n));
+        }
+    }
+}
+
+void TestAudioDsp::floatTest()
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+    const Kernels* ref = getKernels(Isa::Scalar);
+    for (const Kernels* k : vectorKernels()) {
+        for (int n : sizes) {
+            const QVector<int16_t> samples = randomSamples(rng, n);
+            QVector<float> expected(n);
+            QVector<float> actual(n);
+            ref->toFloat(samples.data(), expected.data(), n);
+            k->toFloat(samples.data(), actual.data(), n);
+            QVERIFY(std::memcmp(expected.data(), actual.data(), n * sizeof(float)) == 0);
+
+            QVector<float> floats(n);
+            for (float& f : floats) {
+                f = dist(rng);
+            }
+            // rounding ties and the clipping boundaries
+            if (n > 3) {
+                floats[0] = 0.5f / 32768.0f;
+                floats[1] = 1.5f / 32768.0f;
+                floats[2] = 1.0f;
+                floats[3] = -1.0f;
+            }
+            QVector<int16_t> expectedSamples(n);
+            QVector<int16_t> actualSamples(n);
+            ref->fromFloat(floats.data(), expectedSamples.data(), n);
+            k->fromFloat(floats.data(), actualSamples.data(), n);
+            QCOMPARE(actualSamples, expectedSamples);
+        }
+    }
+}
+
+void TestAudioDsp::mixTest()
+{
+    std::mt19937 rng(4);
+    const Kernels* ref = getKernels(Isa::Scalar);
+    for (const Kernels* k : vectorKernels()) {
+        for (int n : sizes) {
+            const QVector<int16_t> a = randomSamples(rng, n);
+            const QVector<int16_t> b = randomSamples(rng, n);
+            QVector<int32_t> expectedAcc(n, 0);
+            QVector<int32_t> actualAcc(n, 0);
+            ref->mixAccumulate(expectedAcc.data(), a.data(), n);
+            ref->mixAccumulate(expectedAcc.data(), b.data(), n);
+            k->mixAccumulate(actualAcc.data(), a.data(), n);
+            k->mixAccumulate(actualAcc.data(), b.data(), n);
+            QCOMPARE(actualAcc, expectedAcc);
+
+            QVector<int16_t> expected(n);
+            QVector<int16_t> actual(n);
+            ref->mixSaturate(expectedAcc.data(), expected.data(), n);
+            k->mixSaturate(actualAcc.data(), actual.data(), n);
+            QCOMPARE(actual, expected);
+        }
+    }
+}
+
+void TestAudioDsp::scalarValuesTest()
+{
+    QVector<int16_t> samples{1000, -1000, 30000, -30000, 3, -3};
+    applyGain(samples.data(), samples.size(), 2.0f);
+    QCOMPARE(samples, (QVector<int16_t>{2000, -2000, 32767, -32768, 6, -6}));
+
+    const QVector<int16_t> constant(100, -20000);
+    QCOMPARE(peak(constant.data(), constant.size()), 20000);
+    QCOMPARE(rms(constant.data(), constant.size()), 20000.0f);
+
+    const QVector<int16_t> a(100, 20000);
+    const QVector<int16_t> b(100, -5000);
+    const int16_t* inputs[] = {a.data(), a.data(), b.data()};
+    QVector<int16_t> out(100);
+    mix(out.data(), inputs, 3, out.size());
+    QCOMPARE(out, QVector<int16_t>(100, 32767));
+    mix(out.data(), inputs + 1, 2, out.size());
+    QCOMPARE(out, QVector<int16_t>(100, 15000));
+}
+
+QTEST_GUILESS_MAIN(TestAudioDsp)
+#include "audiodsp_test.moc"
@@ -0,0 +1,198 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/audio/audioframequeue.h"
+
+#include <QtTest/QtTest>
+#include <QThread>
+#include <QVector>
+
+namespace {
+const size_t maxFrameSamples = 16;
+const size_t capacity = 4;
+
+QVector<int16_t> makeFrame(int16_t first, int samples)
+{
+    QVector<int16_t> frame(samples);
+    for (int i = 0; i < samples; ++i) {
+        frame[i] = static_cast<int16_t>(first + i);
+    }
+
+    return frame;
+}
+
+class Producer : public QThread
+{
+public:
+    Producer(AudioFrameQueue& queue, int frames)
+        : queue(queue)
+        , frames(frames)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        for (int i = 0; i < frames; ++i) {
+            int16_t data[maxFrameSamples];
+            for (size_t j = 0; j < maxFrameSamples; ++j) {
+                data[j] = static_cast<int16_t>(i + static_cast<int>(j));
+            }
+
+            while (!queue.push(data, maxFrameSamples, 1, 48000)) {
+                QThread::yieldCurrentThread();
+            }
+        }
+    }
+
+private:
+    AudioFrameQueue& queue;
+    const int frames;
+};
+}
+
+class TestAudioFrameQueue : public QObject
+{
+    Q_OBJECT
+private slots:
+    void emptyTest();
+    void fullTest();
+    void wraparoundTest();
+    void threadTest();
+};
+
+/**
+ * @brief An empty queue has no front frame, frames come out as they were pushed.
+ */
+void TestAudioFrameQueue::emptyTest()
+{
+    AudioFrameQueue queue{maxFrameSamples, capacity};
+    AudioFrameQueue::Frame frame;
+    QVERIFY(!queue.front(frame));
+    QCOMPARE(queue.size(), size_t{0});
+
+    const QVector<int16_t> stereo = makeFrame(100, 8);
+    QVERIFY(queue.push(stereo.constData(), 4, 2, 48000));
+    QCOMPARE(queue.size(), size_t{1});
+    QVERIFY(queue.front(frame));
+    QCOMPARE(frame.samples, size_t{4});
+    QCOMPARE(frame.channels, uint8_t{2});
+    QCOMPARE(frame.sampleRate, uint32_t{48000});
+    QCOMPARE(QVector<int16_t>(frame.pcm, frame.pcm + 8), stereo);
+
+    queue.pop();
+    QVERIFY(!queue.front(frame));
+    QCOMPARE(queue.size(), size_t{0});
+    QCOMPARE(queue.getDropped(), uint64_t{0});
+}
+
+/**
+ * @brief Frames pushed to a full queue are dropped and counted, queued ones are kept.
+ */
+void TestAudioFrameQueue::fullTest()
+{
+    AudioFrameQueue queue{maxFrameSamples, capacity};
+    for (size_t i = 0; i < capacity; ++i) {
+        const QVector<int16_t> frame = makeFrame(static_cast<int16_t>(i * 100), 4);
+        QVERIFY(queue.push(frame.constData(), 4, 1, 48000));
+    }
+
+    const QVector<int16_t> extra = makeFrame(-1, 4);
+    QVERIFY(!queue.push(extra.constData(), 4, 1, 48000));
+    QVERIFY(!queue.push(extra.constData(), 4, 1, 48000));
+    QCOMPARE(queue.size(), capacity);
+    QCOMPARE(queue.getDropped(), uint64_t{2});
+
+    AudioFrameQueue::Frame frame;
+    QVERIFY(queue.front(frame));
+    QCOMPARE(frame.pcm[0], int16_t{0});
+
+    // one free slot again
+    queue.pop();
+    QVERIFY(queue.push(extra.constData(), 4, 1, 48000));
+    QVERIFY(!queue.push(extra.constData(), 4, 1, 48000));
+    QCOMPARE(queue.getDropped(), uint64_t{3});
+}
+
+/**
+ * @brief Slots are reused in order when the positions wrap around the capacity.
+ */
+void TestAudioFrameQueue::wraparoundTest()
+{
+    AudioFrameQueue queue{maxFrameSamples, capacity};
+    AudioFrameQueue::Frame frame;
+    int16_t next = 0;
+    int16_t expected = 0;
+
+    // keep the queue partly filled so reads and writes hit different slots
+    for (int round = 0; round < 10 * static_cast<int>(capacity); ++round) {
+        while (queue.size() < capacity - 1) {
+            const int samples = 1 + next % static_cast<int>(maxFrameSamples);
+            const QVector<int16_t> data = makeFrame(next, samples);
+            QVERIFY(queue.push(data.constData(), static_cast<size_t>(samples), 1, 48000));
+            ++next;
+        }
+
+        QVERIFY(queue.front(frame));
+        const int samples = 1 + expected % static_cast<int>(maxFrameSamples);
+        QCOMPARE(frame.samples, static_cast<size_t>(samples));
+        QCOMPARE(frame.pcm[0], expected);
+        QCOMPARE(frame.pcm[frame.samples - 1], static_cast<int16_t>(expected + frame.samples - 1));
+        queue.pop();
+        ++expected;
+    }
+
+    QCOMPARE(queue.getDropped(), uint64_t{0});
+}
+
+/**
+ * @brief A producer and a consumer thread pass every frame intact and in order.
+ */
+void TestAudioFrameQueue::threadTest()
+{
+    AudioFrameQueue queue{maxFrameSamples, capacity};
+    const int frames = 100000;
+
+    Producer producer{queue, frames};
+    producer.start();
+
+    int received = 0;
+    bool intact = true;
+    AudioFrameQueue::Frame frame;
+    while (received < frames) {
+        if (!queue.front(frame)) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+
+        for (size_t j = 0; j < frame.samples; ++j) {
+            intact = intact && frame.pcm[j] == static_cast<int16_t>(received + static_cast<int>(j));
+        }
+
+        queue.pop();
+        ++received;
+    }
+
+    producer.wait();
+    QVERIFY(intact);
+    QCOMPARE(queue.size(), size_t{0});
+}
+
+QTEST_GUILESS_MAIN(TestAudioFrameQueue)
+#include "audioframequeue_test.moc"
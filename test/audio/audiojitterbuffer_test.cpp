@@ -0,0 +1,134 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/audio/audiojitterbuffer.h"
+
+#include <QtTest/QtTest>
+#include <QVector>
+
+namespace {
+const int frameSamples = 960;
+
+void pushFrames(AudioJitterBuffer& buffer, int count, int16_t value = 1000)
+{
+    const QVector<int16_t> frame(frameSamples, value);
+    for (int i = 0; i < count; ++i) {
+        QVERIFY(buffer.push(frame.constData(), frameSamples, 1, 48000));
+    }
+}
+}
+
+class TestAudioJitterBuffer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void concealTest();
+    void lateDropTest();
+    void stretchTest();
+    void resampleTest();
+};
+
+/**
+ * @brief Missing audio is concealed with a fading copy of the last frame before rebuffering.
+ */
+void TestAudioJitterBuffer::concealTest()
+{
+    AudioJitterBuffer buffer;
+    QVector<int16_t> out(frameSamples);
+    QVERIFY(!buffer.pull(out.data(), frameSamples));
+
+    pushFrames(buffer, 3);
+    QVector<int16_t> played;
+    while (buffer.pull(out.data(), frameSamples)) {
+        played.append(out.first());
+        QVERIFY(played.size() < 10);
+    }
+
+    QVERIFY(played.size() > 3);
+    QCOMPARE(played.first(), static_cast<int16_t>(1000));
+    QCOMPARE(played.mid(played.size() - 3),
+             (QVector<int16_t>{500, 250, 125}));
+
+    const AudioJitterBuffer::Stats stats = buffer.getStats();
+    QCOMPARE(stats.underruns, static_cast<uint64_t>(1));
+    QCOMPARE(stats.concealed, static_cast<uint64_t>(3));
+}
+
+/**
+ * @brief Audio arriving after its slot was concealed is dropped to keep the latency down.
+ */
+void TestAudioJitterBuffer::lateDropTest()
+{
+    AudioJitterBuffer buffer;
+    QVector<int16_t> out(frameSamples);
+
+    pushFrames(buffer, 3);
+    do {
+        QVERIFY(buffer.pull(out.data(), frameSamples));
+    } while (out.first() == 1000);
+    QCOMPARE(out.first(), static_cast<int16_t>(500));
+
+    pushFrames(buffer, 4);
+    const int depth = buffer.getStats().depthMs;
+    QVERIFY(buffer.pull(out.data(), frameSamples));
+    QCOMPARE(out.first(), static_cast<int16_t>(1000));
+    QCOMPARE(buffer.getStats().lateDrops, static_cast<uint64_t>(1));
+    QVERIFY(buffer.getStats().depthMs < depth - 20);
+}
+
+/**
+ * @brief Excess latency is drained by playing slightly faster.
+ */
+void TestAudioJitterBuffer::stretchTest()
+{
+    AudioJitterBuffer buffer;
+    QVector<int16_t> out(frameSamples);
+
+    pushFrames(buffer, 8);
+    const int depth = buffer.getStats().depthMs;
+    QVERIFY(buffer.pull(out.data(), frameSamples));
+    QCOMPARE(out.first(), static_cast<int16_t>(1000));
+    QCOMPARE(out.last(), static_cast<int16_t>(1000));
+
+    const AudioJitterBuffer::Stats stats = buffer.getStats();
+    QCOMPARE(stats.stretched, static_cast<uint64_t>(1));
+    QVERIFY(stats.depthMs < depth - 20);
+}
+
+/**
+ * @brief Frames with other sample rates or stereo are converted to mono 48 kHz.
+ */
+void TestAudioJitterBuffer::resampleTest()
+{
+    AudioJitterBuffer buffer;
+    const QVector<int16_t> frame(frameSamples * 2, 2000);
+
+    QVERIFY(buffer.push(frame.constData(), frameSamples / 2, 2, 24000));
+    QCOMPARE(buffer.getStats().depthMs, 20);
+
+    QVERIFY(buffer.push(frame.constData(), frameSamples * 2, 1, 96000));
+    QCOMPARE(buffer.getStats().depthMs, 40);
+
+    QVector<int16_t> out(frameSamples);
+    QVERIFY(buffer.pull(out.data(), frameSamples));
+    QCOMPARE(out.first(), static_cast<int16_t>(2000));
+}
+
+QTEST_GUILESS_MAIN(TestAudioJitterBuffer)
+#include "audiojitterbuffer_test.moc"
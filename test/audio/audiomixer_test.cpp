@@ -0,0 +1,217 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/audio/audiomixer.h"
+
+#include <QtTest/QtTest>
+#include <QVector>
+
+namespace {
+const int frameSamples = 960;
+// enough to start playing whatever jitter the first frames measured
+const int bufferedFrames = 12;
+
+QVector<int16_t> constantFrame(int16_t value, int channels = 1)
+{
+    return QVector<int16_t>(frameSamples * channels, value);
+}
+
+void pushFrames(AudioMixer& mixer, int peer, const QVector<int16_t>& frame, int channels = 1)
+{
+    for (int i = 0; i < bufferedFrames; ++i) {
+        QVERIFY(mixer.push(peer, frame.constData(), frameSamples, channels, 48000));
+    }
+}
+}
+
+class TestAudioMixer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void bufferingTest();
+    void mixTest();
+    void downmixTest();
+    void stereoTest();
+    void muteTest();
+    void removeTest();
+    void overrunTest();
+};
+
+/**
+ * @brief Only added peers are mixed, nothing is played before audio arrives.
+ */
+void TestAudioMixer::bufferingTest()
+{
+    AudioMixer mixer;
+    QVector<int16_t> out(frameSamples);
+    const QVector<int16_t> frame = constantFrame(1000);
+
+    QVERIFY(!mixer.push(1, frame.constData(), frameSamples, 1, 48000));
+    mixer.addPeer(1);
+    QVERIFY(mixer.hasPeer(1));
+    QVERIFY(!mixer.mix(out.data(), frameSamples));
+
+    pushFrames(mixer, 1, frame);
+    QVERIFY(mixer.mix(out.data(), frameSamples));
+    QCOMPARE(out.first(), static_cast<int16_t>(1000));
+    QCOMPARE(out.last(), static_cast<int16_t>(1000));
+}
+
+/**
+ * @brief Peers are summed after applying their gain and clipped only once.
+ */
+void TestAudioMixer::mixTest()
+{
+    AudioMixer mixer;
+    QVector<int16_t> out(frameSamples);
+
+    mixer.addPeer(1);
+    mixer.addPeer(2);
+    mixer.setPeerGain(2, 0.5f);
+    pushFrames(mixer, 1, constantFrame(1000));
+    pushFrames(mixer, 2, constantFrame(1000));
+
+    QVERIFY(mixer.mix(out.data(), frameSamples));
+    QCOMPARE(out.first(), static_cast<int16_t>(1500));
+    QCOMPARE(out.last(), static_cast<int16_t>(1500));
+
+    mixer.setPeerGain(2, 1.0f);
+    mixer.addPeer(3);
+    pushFrames(mixer, 3, constantFrame(30000));
+    QVERIFY(mixer.mix(out.data(), frameSamples));
+    QCOMPARE(out.first(), static_cast<int16_t>(32000));
+}
+
+/**
+ * @brief Stereo frames are mixed as the average of both channels.
+ */
+void TestAudioMixer::downmixTest()
+{
+    AudioMixer mixer;
+    QVector<int16_t> out(frameSamples);
+    QVector<int16_t> frame = constantFrame(0, 2);
+    for (int i = 0; i < frameSamples; ++i) {
+        frame[2 * i] = 3000;
+        frame[2 * i + 1] = -1000;
+    }
+
+    mixer.addPeer(1);
+    pushFrames(mixer, 1, frame, 2);
+    QVERIFY(mixer.mix(out.data(), frameSamples));
+    QCOMPARE(out.first(), static_cast<int16_t>(1000));
+    QCOMPARE(out.last(), static_cast<int16_t>(1000));
+}
+
+/**
+ * @brief A stereo mixer keeps both channels of stereo peers and plays mono peers on both.
+ */
+void TestAudioMixer::stereoTest()
+{
+    AudioMixer mixer{2};
+    QCOMPARE(mixer.getChannels(), 2u);
+    QVector<int16_t> out(frameSamples * 2);
+    QVector<int16_t> frame = constantFrame(0, 2);
+    for (int i = 0; i < frameSamples; ++i) {
+        frame[2 * i] = 3000;
+        frame[2 * i + 1] = -1000;
+    }
+
+    mixer.addPeer(1);
+    mixer.addPeer(2);
+    pushFrames(mixer, 1, frame, 2);
+    pushFrames(mixer, 2, constantFrame(500));
+    QVERIFY(mixer.mix(out.data(), frameSamples));
+    QCOMPARE(out[0], static_cast<int16_t>(3500));
+    QCOMPARE(out[1], static_cast<int16_t>(-500));
+    QCOMPARE(out[frameSamples * 2 - 2], static_cast<int16_t>(3500));
+    QCOMPARE(out[frameSamples * 2 - 1], static_cast<int16_t>(-500));
+}
+
+/**
+ * @brief A muted peer keeps consuming its audio without being heard.
+ */
+void TestAudioMixer::muteTest()
+{
+    AudioMixer mixer;
+    QVector<int16_t> out(frameSamples);
+
+    mixer.addPeer(1);
+    mixer.setPeerMuted(1, true);
+    pushFrames(mixer, 1, constantFrame(1000));
+
+    AudioJitterBuffer::Stats before;
+    QVERIFY(mixer.getPeerStats(1, before));
+    QVERIFY(!mixer.mix(out.data(), frameSamples));
+    AudioJitterBuffer::Stats after;
+    QVERIFY(mixer.getPeerStats(1, after));
+    QVERIFY(after.depthMs < before.depthMs);
+
+    mixer.setPeerMuted(1, false);
+    QVERIFY(mixer.mix(out.data(), frameSamples));
+}
+
+/**
+ * @brief Removed peers are not played anymore and their slots can be reused.
+ */
+void TestAudioMixer::removeTest()
+{
+    AudioMixer mixer;
+    QVector<int16_t> out(frameSamples);
+
+    mixer.addPeer(1);
+    pushFrames(mixer, 1, constantFrame(1000));
+    mixer.removePeer(1);
+    QVERIFY(!mixer.hasPeer(1));
+    QVERIFY(!mixer.mix(out.data(), frameSamples));
+
+    for (int peer = 0; peer < static_cast<int>(AudioMixer::MAX_STREAMS); ++peer) {
+        mixer.addPeer(peer);
+        QVERIFY(mixer.hasPeer(peer));
+    }
+
+    mixer.clearPeers();
+    QVERIFY(!mixer.hasPeer(0));
+    mixer.mix(out.data(), frameSamples);
+    mixer.addPeer(42);
+    QVERIFY(mixer.hasPeer(42));
+}
+
+/**
+ * @brief Frames are dropped instead of blocking when a peer's buffer is full.
+ */
+void TestAudioMixer::overrunTest()
+{
+    AudioMixer mixer;
+    const QVector<int16_t> frame = constantFrame(1000);
+
+    mixer.addPeer(1);
+    int pushed = 0;
+    while (mixer.push(1, frame.constData(), frameSamples, 1, 48000)) {
+        ++pushed;
+        QVERIFY(pushed < 100);
+    }
+
+    AudioJitterBuffer::Stats stats;
+    QVERIFY(mixer.getPeerStats(1, stats));
+    QVERIFY(pushed > 0);
+    QCOMPARE(stats.overruns, static_cast<uint64_t>(1));
+}
+
+QTEST_GUILESS_MAIN(TestAudioMixer)
+#include "audiomixer_test.moc"
@@ -0,0 +1,52 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/coreloopstats.h"
+
+#include <QtTest/QtTest>
+
+class TestCoreLoopStats : public QObject
+{
+    Q_OBJECT
+private slots:
+    void addIterationTest();
+};
+
+void TestCoreLoopStats::addIterationTest()
+{
+    CoreLoopStats stats;
+    stats.addIteration(0, 50, false);
+    stats.addIteration(300, 0, true);
+
+    QCOMPARE(stats.getIterations(), uint64_t{2});
+    QCOMPARE(stats.getWakeups(), uint64_t{1});
+
+    const QVector<uint64_t> durations = stats.getDurations();
+    QCOMPARE(durations[0], uint64_t{1});
+    QCOMPARE(durations[9], uint64_t{1});
+
+    const QVector<uint64_t> sleeps = stats.getSleeps();
+    QCOMPARE(sleeps[0], uint64_t{1});
+    QCOMPARE(sleeps[6], uint64_t{1});
+
+    QCOMPARE(durations.size(), 12);
+}
+
+QTEST_GUILESS_MAIN(TestCoreLoopStats)
+#include "coreloopstats_test.moc"
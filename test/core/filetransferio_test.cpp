@@ -0,0 +1,232 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/filetransferio.h"
+
+#include <QtTest/QtTest>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <memory>
+
+class TestFileTransferIO : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void writeTest();
+    void readTest_data();
+    void readTest();
+    void mappedTest();
+    void restartTest();
+    void truncatedTest();
+    void resumeTest();
+
+private:
+    static qint64 readChunk(FileTransferIO& io, quint64 position, char* data, qint64 length);
+
+    QTemporaryDir dir;
+    QByteArray content;
+};
+
+void TestFileTransferIO::initTestCase()
+{
+    QVERIFY(dir.isValid());
+
+    // a few blocks and a partial one
+    content.resize(3 * FileTransferIO::BLOCK_SIZE + 1234);
+    for (int i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>(i % 251);
+    }
+
+    QFile file{dir.filePath("content")};
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(content), static_cast<qint64>(content.size()));
+}
+
+qint64 TestFileTransferIO::readChunk(FileTransferIO& io, quint64 position, char* data,
+                                     qint64 length)
+{
+    // the data is read on a worker thread, wait until it's there
+    QElapsedTimer timer;
+    timer.start();
+    qint64 nread = io.read(position, data, length);
+    while (nread == 0 && timer.elapsed() < 5000) {
+        QTest::qWait(1);
+        nread = io.read(position, data, length);
+    }
+
+    return nread;
+}
+
+void TestFileTransferIO::writeTest()
+{
+    auto file = std::make_shared<QFile>(dir.filePath("written"));
+    QVERIFY(file->open(QIODevice::ReadWrite));
+
+    FileTransferIO io{file};
+    const int chunkSize = 1371;
+    for (int pos = 0; pos < content.size(); pos += chunkSize) {
+        const QByteArray chunk = content.mid(pos, chunkSize);
+        io.write(chunk.constData(), chunk.size());
+    }
+
+    io.close();
+    QTRY_VERIFY(io.isClosed());
+    QVERIFY(!io.hasError());
+    QCOMPARE(io.getHash(), QCryptographicHash::hash(content, QCryptographicHash::Sha256));
+
+    QFile written{dir.filePath("written")};
+    QVERIFY(written.open(QIODevice::ReadOnly));
+    QCOMPARE(written.readAll(), content);
+}
+
+void TestFileTransferIO::readTest_data()
+{
+    QTest::addColumn<bool>("readOnly");
+
+    // files opened for writing are read through buffers instead of being mapped
+    QTest::newRow("mapped") << true;
+    QTest::newRow("buffered") << false;
+}
+
+void TestFileTransferIO::readTest()
+{
+    QFETCH(bool, readOnly);
+
+    auto file = std::make_shared<QFile>(dir.filePath("content"));
+    QVERIFY(file->open(readOnly ? QIODevice::ReadOnly : QIODevice::ReadWrite));
+
+    FileTransferIO io{file};
+    io.startReading(0);
+
+    const qint64 chunkSize = 1371;
+    QByteArray chunk(chunkSize, Qt::Uninitialized);
+    QByteArray result;
+    while (result.size() < content.size()) {
+        const qint64 length = qMin(chunkSize, static_cast<qint64>(content.size() - result.size()));
+        QCOMPARE(readChunk(io, result.size(), chunk.data(), length), length);
+        result.append(chunk.constData(), static_cast<int>(length));
+    }
+
+    QCOMPARE(result, content);
+    QVERIFY(!io.hasError());
+
+    io.close();
+    QTRY_VERIFY(io.isClosed());
+    QCOMPARE(io.getHash(), QCryptographicHash::hash(content, QCryptographicHash::Sha256));
+}
+
+void TestFileTransferIO::mappedTest()
+{
+    auto file = std::make_shared<QFile>(dir.filePath("content"));
+    QVERIFY(file->open(QIODevice::ReadOnly));
+
+    FileTransferIO io{file};
+    io.startReading(0);
+
+    // chunks of a local file are taken from the mapping once they are paged in
+    const qint64 chunkSize = 1371;
+    QByteArray result;
+    while (result.size() < content.size()) {
+        const qint64 length = qMin(chunkSize, static_cast<qint64>(content.size() - result.size()));
+        const char* chunk = nullptr;
+        QTRY_VERIFY((chunk = io.mapped(static_cast<quint64>(result.size()), length)) != nullptr);
+        result.append(chunk, static_cast<int>(length));
+    }
+
+    QCOMPARE(result, content);
+
+    io.close();
+    QTRY_VERIFY(io.isClosed());
+    QCOMPARE(io.getHash(), QCryptographicHash::hash(content, QCryptographicHash::Sha256));
+}
+
+void TestFileTransferIO::restartTest()
+{
+    auto file = std::make_shared<QFile>(dir.filePath("content"));
+    QVERIFY(file->open(QIODevice::ReadOnly));
+
+    FileTransferIO io{file};
+    QByteArray chunk(100, Qt::Uninitialized);
+
+    const quint64 position = 2 * FileTransferIO::BLOCK_SIZE + 10;
+    QCOMPARE(readChunk(io, position, chunk.data(), chunk.size()), qint64{100});
+    QCOMPARE(chunk, content.mid(static_cast<int>(position), 100));
+
+    // seeking back restarts reading ahead
+    QCOMPARE(readChunk(io, 10, chunk.data(), chunk.size()), qint64{100});
+    QCOMPARE(chunk, content.mid(10, 100));
+
+    // blocks were read out of order, so the whole file is hashed on close
+    io.close();
+    QTRY_VERIFY(io.isClosed());
+    QCOMPARE(io.getHash(), QCryptographicHash::hash(content, QCryptographicHash::Sha256));
+}
+
+void TestFileTransferIO::truncatedTest()
+{
+    auto file = std::make_shared<QFile>(dir.filePath("content"));
+    QVERIFY(file->open(QIODevice::ReadOnly));
+
+    FileTransferIO io{file};
+    QByteArray chunk(100, Qt::Uninitialized);
+    const quint64 position = static_cast<quint64>(content.size() - 50);
+    QCOMPARE(readChunk(io, position, chunk.data(), chunk.size()), qint64{-1});
+}
+
+void TestFileTransferIO::resumeTest()
+{
+    // received data of a broken transfer, with data after it that wasn't written completely
+    const int offset = FileTransferIO::BLOCK_SIZE + 4321;
+    {
+        QFile partial{dir.filePath("partial")};
+        QVERIFY(partial.open(QIODevice::WriteOnly));
+        partial.write(content.left(offset));
+        partial.write(QByteArray(500, 'x'));
+    }
+
+    auto file = std::make_shared<QFile>(dir.filePath("partial"));
+    QVERIFY(file->open(QIODevice::ReadWrite));
+
+    FileTransferIO io{file};
+    io.hashFile(offset);
+    QTRY_VERIFY(io.isHashed());
+    QCOMPARE(io.getHashedSize(), static_cast<quint64>(offset));
+    QCOMPARE(io.getHash(),
+             QCryptographicHash::hash(content.left(offset), QCryptographicHash::Sha256));
+
+    io.startWriting(offset);
+    const QByteArray rest = content.mid(offset);
+    io.write(rest.constData(), rest.size());
+    io.close();
+    QTRY_VERIFY(io.isClosed());
+    QVERIFY(!io.hasError());
+    QCOMPARE(io.getHash(), QCryptographicHash::hash(content, QCryptographicHash::Sha256));
+
+    QFile written{dir.filePath("partial")};
+    QVERIFY(written.open(QIODevice::ReadOnly));
+    QCOMPARE(written.readAll(), content);
+}
+
+QTEST_GUILESS_MAIN(TestFileTransferIO)
+#include "filetransferio_test.moc"
@@ -0,0 +1,102 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/grouppeertable.h"
+
+#include <QtTest/QtTest>
+#include <QByteArray>
+#include <QString>
+
+const QByteArray testPk = QByteArray::fromHex(
+    QByteArrayLiteral("C7719C6808C14B77348004956D1D98046CE09A34370E7608150EAD74C3815D30"));
+const QByteArray echoPk = QByteArray::fromHex(
+    QByteArrayLiteral("76518406F6A9F2217E8DC487CC783C25CC16A15EB36FF32E335A235342C48A39"));
+
+class TestGroupPeerTable : public QObject
+{
+    Q_OBJECT
+private slots:
+    void unknownGroupTest();
+    void setPeersTest();
+    void setPeerNameTest();
+    void snapshotTest();
+    void removeGroupTest();
+};
+
+void TestGroupPeerTable::unknownGroupTest()
+{
+    GroupPeerTable table;
+    QVERIFY(!table.hasGroup(0));
+    QVERIFY(table.getPeers(0)->isEmpty());
+    QVERIFY(!table.setPeerName(0, 0, QStringLiteral("name")));
+}
+
+void TestGroupPeerTable::setPeersTest()
+{
+    GroupPeerTable table;
+    table.setPeers(3, {{ToxPk(testPk), QStringLiteral("test"), 0},
+                       {ToxPk(echoPk), QStringLiteral("echo"), 1}});
+    QVERIFY(table.hasGroup(3));
+    QVERIFY(!table.hasGroup(0));
+
+    const GroupPeerTable::PeersPtr peers = table.getPeers(3);
+    QCOMPARE(peers->size(), 2);
+    QVERIFY(peers->at(0).pk == ToxPk(testPk));
+    QCOMPARE(peers->at(1).name, QStringLiteral("echo"));
+    QCOMPARE(peers->at(1).number, 1u);
+}
+
+void TestGroupPeerTable::setPeerNameTest()
+{
+    GroupPeerTable table;
+    table.setPeers(0, {{ToxPk(testPk), QStringLiteral("test"), 0}});
+    QVERIFY(table.setPeerName(0, 0, QStringLiteral("renamed")));
+    QVERIFY(!table.setPeerName(0, 1, QStringLiteral("unknown")));
+    QCOMPARE(table.getPeers(0)->at(0).name, QStringLiteral("renamed"));
+}
+
+void TestGroupPeerTable::snapshotTest()
+{
+    GroupPeerTable table;
+    table.setPeers(0, {{ToxPk(testPk), QStringLiteral("test"), 0}});
+    const GroupPeerTable::PeersPtr before = table.getPeers(0);
+
+    table.setPeerName(0, 0, QStringLiteral("renamed"));
+    table.setPeers(0, {});
+
+    QCOMPARE(before->size(), 1);
+    QCOMPARE(before->at(0).name, QStringLiteral("test"));
+    QVERIFY(table.getPeers(0)->isEmpty());
+}
+
+void TestGroupPeerTable::removeGroupTest()
+{
+    GroupPeerTable table;
+    table.setPeers(0, {{ToxPk(testPk), QStringLiteral("test"), 0}});
+    table.setPeers(1, {{ToxPk(echoPk), QStringLiteral("echo"), 0}});
+    table.removeGroup(0);
+    QVERIFY(!table.hasGroup(0));
+    QCOMPARE(table.getPeers(1)->size(), 1);
+
+    table.clear();
+    QVERIFY(!table.hasGroup(1));
+}
+
+QTEST_GUILESS_MAIN(TestGroupPeerTable)
+#include "grouppeertable_test.moc"
@@ -0,0 +1,136 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/outgoingmessagequeue.h"
+
+#include <QtTest/QtTest>
+
+class TestOutgoingMessageQueue : public QObject
+{
+    Q_OBJECT
+private slots:
+    void orderTest();
+    void inFlightLimitTest();
+    void expiryTest();
+    void readReceiptTest();
+    void clearFriendTest();
+};
+
+void TestOutgoingMessageQueue::orderTest()
+{
+    OutgoingMessageQueue queue;
+    const int first = queue.enqueue(0, QStringLiteral("first"), false);
+    const int second = queue.enqueue(0, QStringLiteral("second"), true);
+    QVERIFY(first != 0);
+    QVERIFY(first != second);
+    QCOMPARE(queue.getPendingCount(0), 2);
+
+    OutgoingMessageQueue::Message message;
+    QVERIFY(queue.peek(0, 0, message));
+    QCOMPARE(message.receipt, first);
+    QCOMPARE(message.text, QStringLiteral("first"));
+    queue.markSent(0, 1, 0);
+
+    QVERIFY(queue.peek(0, 0, message));
+    QCOMPARE(message.receipt, second);
+    QVERIFY(message.isAction);
+    queue.dropFront(0);
+
+    QVERIFY(!queue.peek(0, 0, message));
+    QCOMPARE(queue.getPendingCount(0), 0);
+}
+
+void TestOutgoingMessageQueue::inFlightLimitTest()
+{
+    OutgoingMessageQueue queue;
+    for (int i = 0; i <= OutgoingMessageQueue::MAX_IN_FLIGHT; ++i) {
+        queue.enqueue(0, QString::number(i), false);
+    }
+
+    for (int i = 0; i < OutgoingMessageQueue::MAX_IN_FLIGHT; ++i) {
+        queue.markSent(0, static_cast<uint32_t>(i), 0);
+    }
+
+    OutgoingMessageQueue::Message message;
+    QVERIFY(!queue.hasSendable(0));
+    QVERIFY(!queue.peek(0, 0, message));
+    QVERIFY(queue.getSendableFriends(0).isEmpty());
+
+    // unconfirmed messages stop blocking after the timeout
+    QVERIFY(queue.hasSendable(OutgoingMessageQueue::IN_FLIGHT_TIMEOUT_MS));
+
+    queue.addReadReceipt(0, 0);
+    QVERIFY(queue.peek(0, 0, message));
+    QCOMPARE(queue.getSendableFriends(0), QVector<uint32_t>{0});
+}
+
+void TestOutgoingMessageQueue::expiryTest()
+{
+    OutgoingMessageQueue queue;
+    const int late = queue.enqueue(0, QStringLiteral("late"), false);
+    const int confirmed = queue.enqueue(0, QStringLiteral("confirmed"), false);
+    queue.markSent(0, 0, 0);
+    queue.markSent(0, 1, OutgoingMessageQueue::IN_FLIGHT_TIMEOUT_MS / 2);
+    QVERIFY(late != confirmed);
+
+    // an expired message doesn't block sending, but its late receipt is still reported
+    queue.enqueue(0, QStringLiteral("queued"), false);
+    QVERIFY(queue.hasSendable(OutgoingMessageQueue::IN_FLIGHT_TIMEOUT_MS));
+    queue.addReadReceipt(0, 1);
+    queue.addReadReceipt(0, 0);
+    QCOMPARE(queue.takeReadReceipts().value(0), (QVector<int>{confirmed, late}));
+}
+
+void TestOutgoingMessageQueue::readReceiptTest()
+{
+    OutgoingMessageQueue queue;
+    const int first = queue.enqueue(3, QStringLiteral("first"), false);
+    const int second = queue.enqueue(3, QStringLiteral("second"), false);
+    queue.markSent(3, 10, 0);
+    queue.markSent(3, 11, 0);
+
+    queue.addReadReceipt(3, 11);
+    queue.addReadReceipt(3, 12);
+    queue.addReadReceipt(4, 10);
+    queue.addReadReceipt(3, 10);
+
+    const QHash<uint32_t, QVector<int>> receipts = queue.takeReadReceipts();
+    QCOMPARE(receipts.size(), 1);
+    QCOMPARE(receipts.value(3), (QVector<int>{second, first}));
+    QVERIFY(queue.takeReadReceipts().isEmpty());
+}
+
+void TestOutgoingMessageQueue::clearFriendTest()
+{
+    OutgoingMessageQueue queue;
+    queue.enqueue(0, QStringLiteral("sent"), false);
+    queue.enqueue(0, QStringLiteral("queued"), false);
+    queue.enqueue(1, QStringLiteral("other"), false);
+    queue.markSent(0, 0, 0);
+
+    queue.clearFriend(0);
+    QCOMPARE(queue.getPendingCount(0), 0);
+    QCOMPARE(queue.getPendingCount(1), 1);
+
+    queue.addReadReceipt(0, 0);
+    QVERIFY(queue.takeReadReceipts().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestOutgoingMessageQueue)
+#include "outgoingmessagequeue_test.moc"
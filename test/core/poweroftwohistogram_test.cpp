@@ -0,0 +1,86 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "src/core/poweroftwohistogram.h"
+
+#include <QtTest/QtTest>
+
+class TestPowerOfTwoHistogram : public QObject
+{
+    Q_OBJECT
+private slots:
+    void bucketTest();
+    void addTest();
+    void toStringTest();
+};
+
+void TestPowerOfTwoHistogram::bucketTest()
+{
+    const PowerOfTwoHistogram histogram{12};
+    QCOMPARE(histogram.bucketFor(0), 0);
+    QCOMPARE(histogram.bucketFor(1), 1);
+    QCOMPARE(histogram.bucketFor(2), 2);
+    QCOMPARE(histogram.bucketFor(3), 2);
+    QCOMPARE(histogram.bucketFor(50), 6);
+    QCOMPARE(histogram.bucketFor(1023), 10);
+    QCOMPARE(histogram.bucketFor(1024), 11);
+    QCOMPARE(histogram.bucketFor(UINT64_MAX), 11);
+
+    const PowerOfTwoHistogram large;
+    QCOMPARE(large.getBucketCount(), 24);
+    QCOMPARE(large.bucketFor(1024), 11);
+    QCOMPARE(large.bucketFor(UINT64_MAX), 23);
+}
+
+void TestPowerOfTwoHistogram::addTest()
+{
+    PowerOfTwoHistogram histogram{4};
+    histogram.add(0);
+    histogram.add(3);
+    histogram.add(3);
+    histogram.add(1000);
+
+    QVector<uint64_t> buckets = histogram.getBuckets();
+    QCOMPARE(buckets.size(), 4);
+    QCOMPARE(buckets[0], uint64_t{1});
+    QCOMPARE(buckets[1], uint64_t{0});
+    QCOMPARE(buckets[2], uint64_t{2});
+    QCOMPARE(buckets[3], uint64_t{1});
+
+    histogram.reset();
+    buckets = histogram.getBuckets();
+    for (uint64_t bucket : buckets) {
+        QCOMPARE(bucket, uint64_t{0});
+    }
+}
+
+void TestPowerOfTwoHistogram::toStringTest()
+{
+    PowerOfTwoHistogram histogram;
+    QCOMPARE(histogram.toString(), QString{});
+
+    histogram.add(0);
+    histogram.add(300);
+    histogram.add(400);
+    QCOMPARE(histogram.toString(), QStringLiteral("0+:1 256+:2"));
+}
+
+QTEST_GUILESS_MAIN(TestPowerOfTwoHistogram)
+#include "poweroftwohistogram_test.moc"
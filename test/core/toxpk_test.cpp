@@ -21,6 +21,7 @@
 
 #include <QtTest/QtTest>
 #include <QByteArray>
+#include <QSet>
 #include <QString>
 
 const uint8_t testPkArray[32] = {0xC7, 0x71, 0x9C, 0x68, 0x08, 0xC1, 0x4B, 0x77, 0x34, 0x80, 0x04,
@@ -44,6 +45,7 @@ private slots:
     void clearTest();
     void copyTest();
     void publicKeyTest();
+    void hashTest();
 };
 
 void TestToxPk::toStringTest()
@@ -86,6 +88,15 @@ void TestToxPk::publicKeyTest()
     }
 }
 
+void TestToxPk::hashTest()
+{
+    QSet<ToxPk> set{ToxPk(testPk)};
+    QVERIFY(set.contains(ToxPk(testPk)));
+    QVERIFY(!set.contains(ToxPk(echoPk)));
+    QVERIFY(!set.contains(ToxPk()));
+    QCOMPARE(qHash(ToxPk(testPk)), qHash(ToxPk(testPk)));
+}
+
 QTEST_GUILESS_MAIN(TestToxPk)
 #include "toxpk_test.moc"
 
@@ -0,0 +1,122 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/transferscheduler.h"
+
+#include <QtTest/QtTest>
+
+class TestTransferScheduler : public QObject
+{
+    Q_OBJECT
+private slots:
+    void concurrencyTest();
+    void priorityTest();
+    void uploadLimitTest();
+    void statsTest();
+};
+
+void TestTransferScheduler::concurrencyTest()
+{
+    TransferScheduler scheduler;
+    scheduler.setMaxActive(2);
+    for (uint32_t i = 0; i < 5; ++i) {
+        scheduler.enqueue(0, 100 + i, TransferScheduler::SMALL_FILE_SIZE);
+    }
+
+    QCOMPARE(scheduler.getWaitingFriends(), QVector<uint32_t>{0});
+
+    uint32_t fileId;
+    QVERIFY(scheduler.takeNext(0, fileId));
+    QCOMPARE(fileId, uint32_t{100});
+    scheduler.start(0, 1, 0);
+    QVERIFY(scheduler.takeNext(0, fileId));
+    QCOMPARE(fileId, uint32_t{101});
+    scheduler.start(0, 2, 0);
+
+    // both slots are taken
+    QVERIFY(!scheduler.takeNext(0, fileId));
+    QVERIFY(scheduler.getWaitingFriends().isEmpty());
+    QCOMPARE(scheduler.getActiveCount(0), 2);
+    QCOMPARE(scheduler.getQueuedCount(0), 3);
+
+    // cancelling a queued transfer doesn't free a slot
+    scheduler.finish(0, 103);
+    QVERIFY(!scheduler.takeNext(0, fileId));
+
+    scheduler.finish(0, 1);
+    QVERIFY(scheduler.takeNext(0, fileId));
+    QCOMPARE(fileId, uint32_t{102});
+}
+
+void TestTransferScheduler::priorityTest()
+{
+    TransferScheduler scheduler;
+    scheduler.setMaxActive(10);
+    scheduler.enqueue(0, 1, 100 * TransferScheduler::SMALL_FILE_SIZE);
+    scheduler.enqueue(0, 2, 100);
+    scheduler.enqueue(0, 3, 2 * TransferScheduler::SMALL_FILE_SIZE);
+    scheduler.enqueue(0, 4, 200);
+
+    QVector<uint32_t> order;
+    uint32_t fileId;
+    while (scheduler.takeNext(0, fileId)) {
+        order.append(fileId);
+    }
+
+    // small files first, otherwise in order
+    QCOMPARE(order, (QVector<uint32_t>{2, 4, 1, 3}));
+}
+
+void TestTransferScheduler::uploadLimitTest()
+{
+    TransferScheduler scheduler;
+    QVERIFY(scheduler.canSend(0, 0));
+
+    scheduler.setUploadLimit(1000);
+    QVERIFY(scheduler.canSend(0, 0));
+    scheduler.addSent(0, 1, 1500, 0);
+    QVERIFY(!scheduler.canSend(0, 0));
+
+    // 500 bytes in debt, paid back after half a second
+    QVERIFY(!scheduler.canSend(0, 500));
+    QVERIFY(scheduler.canSend(0, 501));
+
+    // other friends have their own limit
+    QVERIFY(scheduler.canSend(1, 501));
+}
+
+void TestTransferScheduler::statsTest()
+{
+    TransferScheduler scheduler;
+    scheduler.addReceived(0, 1, 1000, 10000);
+    scheduler.addReceived(0, 1, 1000, 10500);
+    QCOMPARE(scheduler.getStats(0, 1).bytesPerSecond, quint64{0});
+
+    scheduler.addReceived(0, 1, 2000, 12000);
+    const TransferScheduler::Stats stats = scheduler.getStats(0, 1);
+    QCOMPARE(stats.bytes, quint64{4000});
+    QCOMPARE(stats.startTime, qint64{10000});
+    QCOMPARE(stats.bytesPerSecond, quint64{2000});
+
+    QCOMPARE(scheduler.finish(0, 1).bytes, quint64{4000});
+    QCOMPARE(scheduler.getStats(0, 1).bytes, quint64{0});
+}
+
+QTEST_GUILESS_MAIN(TestTransferScheduler)
+#include "transferscheduler_test.moc"
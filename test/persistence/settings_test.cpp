@@ -0,0 +1,101 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/persistence/settings.h"
+#include "src/core/toxpk.h"
+
+#include <QtTest/QtTest>
+#include <QApplication>
+#include <QByteArray>
+#include <QStandardPaths>
+#include <QThread>
+
+namespace {
+const QByteArray friendKey(32, 1);
+
+class NoteSetter : public QThread
+{
+protected:
+    void run() override
+    {
+        Settings::getInstance().setContactNote(ToxPk{friendKey}, "note");
+    }
+};
+}
+
+class TestSettings : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void personalKeyTest();
+    void otherThreadTest();
+};
+
+void TestSettings::initTestCase()
+{
+    // don't touch the settings of the user running the test
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TestSettings::cleanupTestCase()
+{
+    Settings::destroyInstance();
+}
+
+/**
+ * @brief Changing a setting of the profile marks it for the next personal save.
+ */
+void TestSettings::personalKeyTest()
+{
+    Settings& s = Settings::getInstance();
+    QVERIFY(!s.isPersonalKeyDirty("sentAvatarHashChanged"));
+
+    s.setSentAvatarHash(ToxPk{friendKey}, QByteArray(32, 2));
+    QVERIFY(s.isPersonalKeyDirty("sentAvatarHashChanged"));
+}
+
+/**
+ * @brief Settings changed from another thread than the settings thread are marked as well.
+ */
+void TestSettings::otherThreadTest()
+{
+    Settings& s = Settings::getInstance();
+    QVERIFY(!s.isPersonalKeyDirty("contactNoteChanged"));
+
+    NoteSetter setter;
+    setter.start();
+    setter.wait();
+    QVERIFY(s.isPersonalKeyDirty("contactNoteChanged"));
+}
+
+int main(int argc, char* argv[])
+{
+    // loading the settings measures fonts, which needs a GUI application, but no display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    TestSettings test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "settings_test.moc"
@@ -0,0 +1,127 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/persistence/settingsserializer.h"
+
+#include <QtTest/QtTest>
+#include <QString>
+#include <QTemporaryDir>
+
+class TestSettingsSerializer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void groupValueTest();
+    void arrayValueTest();
+    void roundTripTest();
+
+private:
+    static void writeFriends(SettingsSerializer& ps, int count);
+    static void verifyFriends(SettingsSerializer& ps, int count);
+};
+
+void TestSettingsSerializer::writeFriends(SettingsSerializer& ps, int count)
+{
+    ps.beginGroup("Friends");
+    ps.beginWriteArray("Friend", count);
+    for (int i = 0; i < count; ++i) {
+        ps.setArrayIndex(i);
+        ps.setValue("addr", QString::number(i));
+        ps.setValue("alias", QString("alias %1").arg(i));
+    }
+    ps.endArray();
+    ps.endGroup();
+}
+
+void TestSettingsSerializer::verifyFriends(SettingsSerializer& ps, int count)
+{
+    ps.beginGroup("Friends");
+    QCOMPARE(ps.beginReadArray("Friend"), count);
+    for (int i = 0; i < count; ++i) {
+        ps.setArrayIndex(i);
+        QCOMPARE(ps.value("addr").toString(), QString::number(i));
+        QCOMPARE(ps.value("alias").toString(), QString("alias %1").arg(i));
+    }
+    ps.endArray();
+    ps.endGroup();
+}
+
+void TestSettingsSerializer::groupValueTest()
+{
+    SettingsSerializer ps{QString()};
+    ps.beginGroup("Privacy");
+    ps.setValue("typingNotification", true);
+    ps.endGroup();
+    ps.beginGroup("GUI");
+    ps.setValue("typingNotification", false);
+    ps.setValue("compactLayout", true);
+    ps.setValue("compactLayout", false);
+    ps.endGroup();
+
+    ps.beginGroup("Privacy");
+    QCOMPARE(ps.value("typingNotification").toBool(), true);
+    QCOMPARE(ps.value("compactLayout", 42).toInt(), 42);
+    ps.endGroup();
+    ps.beginGroup("GUI");
+    QCOMPARE(ps.value("typingNotification").toBool(), false);
+    QCOMPARE(ps.value("compactLayout").toBool(), false);
+    ps.endGroup();
+}
+
+void TestSettingsSerializer::arrayValueTest()
+{
+    SettingsSerializer ps{QString()};
+    writeFriends(ps, 100);
+    verifyFriends(ps, 100);
+
+    // values outside of the array are separate from the array elements
+    ps.beginGroup("Friends");
+    QVERIFY(!ps.value("addr").isValid());
+    ps.setValue("addr", "outside");
+    ps.beginReadArray("Friend");
+    ps.setArrayIndex(0);
+    QCOMPARE(ps.value("addr").toString(), QString("0"));
+    ps.endArray();
+    QCOMPARE(ps.value("addr").toString(), QString("outside"));
+    ps.endGroup();
+}
+
+void TestSettingsSerializer::roundTripTest()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + "/profile.ini";
+
+    SettingsSerializer out{path};
+    writeFriends(out, 1000);
+    out.beginGroup("Privacy");
+    out.setValue("blackList", "key");
+    out.endGroup();
+    out.save();
+
+    SettingsSerializer in{path};
+    in.load();
+    verifyFriends(in, 1000);
+    in.beginGroup("Privacy");
+    QCOMPARE(in.value("blackList").toString(), QString("key"));
+    in.endGroup();
+}
+
+QTEST_GUILESS_MAIN(TestSettingsSerializer)
+#include "settingsserializer_test.moc"
@@ -0,0 +1,231 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Headless benchmark for the video pipeline: feeds synthetic frames through a VideoSource and
+ * VideoFrame the same way a call does (decode, convert for toxav, convert for a preview tile)
+ * and reports throughput, CPU time, allocations and the VideoStats histograms.
+ *
+ * Usage: bench_videoframe [--width W] [--height H] [--frames N] [--mjpeg]
+ */
+
+#include "src/video/videoframe.h"
+#include "src/video/videosource.h"
+#include "src/video/videostats.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+}
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+
+static std::atomic<quint64> allocations{0};
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        std::abort();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+class BenchSource : public VideoSource
+{
+public:
+    void subscribe() override {}
+    void unsubscribe() override {}
+
+    void push(AVFrame* frame, bool freeSourceFrame)
+    {
+        VideoFrame* vframe = new VideoFrame(id, frame, freeSourceFrame);
+        vframe->setStageTime(VideoStats::Stage::Capture, vframe->getCreationTime());
+        emit frameAvailable(vframe->trackFrame());
+    }
+};
+
+AVFrame* makeYuvFrame(int width, int height, int index)
+{
+    AVFrame* frame = av_frame_alloc();
+    frame->width = width;
+    frame->height = height;
+    frame->format = AV_PIX_FMT_YUV420P;
+    av_image_alloc(frame->data, frame->linesize, width, height, AV_PIX_FMT_YUV420P,
+                   VideoFrame::dataAlignment);
+
+    // Moving gradient, so nothing in the pipeline can get away with caching
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            frame->data[0][y * frame->linesize[0] + x] = static_cast<uint8_t>(x + y + index);
+        }
+    }
+    for (int y = 0; y < height / 2; ++y) {
+        memset(frame->data[1] + y * frame->linesize[1], 128 + index % 64, width / 2);
+        memset(frame->data[2] + y * frame->linesize[2], 128 - index % 64, width / 2);
+    }
+
+    return frame;
+}
+
+AVPacket* encodeMjpeg(int width, int height)
+{
+    AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    if (!codec) {
+        return nullptr;
+    }
+
+    AVCodecContext* ctx = avcodec_alloc_context3(codec);
+    ctx->width = width;
+    ctx->height = height;
+    ctx->pix_fmt = AV_PIX_FMT_YUVJ420P;
+    ctx->time_base = {1, 30};
+    if (avcodec_open2(ctx, codec, nullptr) < 0) {
+        avcodec_free_context(&ctx);
+        return nullptr;
+    }
+
+    AVFrame* frame = makeYuvFrame(width, height, 0);
+    frame->format = AV_PIX_FMT_YUVJ420P;
+    AVPacket* packet = av_packet_alloc();
+    bool ok = !avcodec_send_frame(ctx, frame) && !avcodec_receive_packet(ctx, packet);
+
+    av_freep(&frame->data[0]);
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+    if (!ok) {
+        av_packet_free(&packet);
+    }
+
+    return packet;
+}
+
+AVCodecContext* openMjpegDecoder()
+{
+    AVCodec* codec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
+    if (!codec) {
+        return nullptr;
+    }
+
+    AVCodecContext* ctx = avcodec_alloc_context3(codec);
+    if (avcodec_open2(ctx, codec, nullptr) < 0) {
+        avcodec_free_context(&ctx);
+    }
+
+    return ctx;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption widthOpt("width", "Frame width", "W", "1280");
+    QCommandLineOption heightOpt("height", "Frame height", "H", "720");
+    QCommandLineOption framesOpt("frames", "Number of frames", "N", "300");
+    QCommandLineOption mjpegOpt("mjpeg", "Decode frames from MJPEG like a webcam would");
+    parser.addOptions({widthOpt, heightOpt, framesOpt, mjpegOpt});
+    parser.process(app);
+
+    const int width = parser.value(widthOpt).toInt();
+    const int height = parser.value(heightOpt).toInt();
+    const int frames = parser.value(framesOpt).toInt();
+    const bool mjpeg = parser.isSet(mjpegOpt);
+
+    QTextStream out(stdout);
+
+    AVPacket* packet = nullptr;
+    AVCodecContext* decoder = nullptr;
+    if (mjpeg) {
+        packet = encodeMjpeg(width, height);
+        decoder = openMjpegDecoder();
+        if (!packet || !decoder) {
+            out << "MJPEG codec not available\n";
+            return 1;
+        }
+    }
+
+    BenchSource source;
+    QObject::connect(&source, &VideoSource::frameAvailable,
+                     [](std::shared_ptr<VideoFrame> frame) {
+                         // What a call does with every frame: send it and show a preview
+                         frame->toToxYUVFrame();
+                         const QSize tile = frame->getSourceDimensions().size() / 4;
+                         frame->toQImage(tile);
+                     });
+
+    VideoStats::reset();
+    allocations = 0;
+    const std::clock_t cpuStart = std::clock();
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < frames; ++i) {
+        if (mjpeg) {
+            const qint64 decodeStart = VideoStats::now();
+            AVFrame* frame = av_frame_alloc();
+            if (avcodec_send_packet(decoder, packet) || avcodec_receive_frame(decoder, frame)) {
+                av_frame_free(&frame);
+                continue;
+            }
+            VideoStats::record(VideoStats::Stage::Capture, VideoStats::now() - decodeStart);
+            source.push(frame, false);
+        } else {
+            source.push(makeYuvFrame(width, height, i), true);
+        }
+    }
+
+    const qint64 elapsed = timer.nsecsElapsed();
+    const double cpuMs = 1000.0 * (std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    VideoFrame::untrackFrames(source.id, true);
+    av_packet_free(&packet);
+    avcodec_free_context(&decoder);
+
+    out << QString("%1x%2 %3, %4 frames\n").arg(width).arg(height).arg(mjpeg ? "mjpeg" : "yuv420p").arg(frames);
+    out << QString("fps: %1\n").arg(frames * 1e9 / elapsed, 0, 'f', 1);
+    out << QString("cpu per frame: %1 ms\n").arg(cpuMs / frames, 0, 'f', 3);
+    out << QString("allocations per frame: %1\n").arg(static_cast<double>(allocations) / frames, 0, 'f', 1);
+    out << VideoStats::report() << '\n';
+
+    return 0;
+}